@@ -0,0 +1,84 @@
+// Array benchmark
+// Runs the sum, max and find builtins over an array of 1M numbers, packed
+// (int32 lanes scanned by the SIMD kernels) and generic (one tagged Value per
+// element, which the builtins check and copy before scanning), and reports the
+// memory each representation holds. Then times clone() followed by one store,
+// which copies a single path of the persistent trie whatever the size, for a
+// generic array as well: its clone copies the arrays and maps in a leaf only
+// when it stores into that leaf.
+
+#include <algorithm>
+#include <chrono>
+#include <string>
+#include <vector>
+#include <fmt/format.h>
+#include <repl/builtins.h>
+#include <repl/object.h>
+
+template<typename Run>
+static double best(Run run) {
+    auto best = std::chrono::duration<double>::max();
+    for (int round = 0; round < 5; round++) {
+        const auto start = std::chrono::steady_clock::now();
+        run();
+        best = std::min<std::chrono::duration<double> >(best, std::chrono::steady_clock::now() - start);
+    }
+    return best.count();
+}
+
+static volatile int sink;
+
+static void measure(const char *label, const Value &array, const std::size_t count) {
+    fmt::print("{}\n", label);
+    for (const auto builtin: {Builtin::SUM, Builtin::MAX, Builtin::FIND}) {
+        // searching for a number that is absent scans the whole array
+        const Value arguments[] = {array, Value::number(-1)};
+        const auto argc = builtin == Builtin::FIND ? 2 : 1;
+        const auto seconds = best([&] {
+            const auto result = callBuiltin(builtin, std::span(arguments, argc));
+            sink = result.isNumber() ? result.asNumber() : 0;
+        });
+        fmt::print("  {:<6} {:8.3f} ms   {:6.2f} ns/element\n", toString(builtin), seconds * 1e3,
+                   seconds / static_cast<double>(count) * 1e9);
+    }
+}
+
+static void measureClone(const char *label, const Value &array) {
+    const auto seconds = best([&] {
+        for (int i = 0; i < 1000; i++) {
+            const auto snapshot = callBuiltin(Builtin::CLONE, std::span(&array, 1));
+            snapshot.as<Array>()->set(static_cast<std::size_t>(i), Value::number(i));
+        }
+    });
+    fmt::print("  {:<8} {:8.3f} us per clone and store\n", label, seconds * 1e3);
+}
+
+int main(int argc, char **argv) {
+    const std::size_t count = argc > 1 ? std::stoul(argv[1]) : 1000000;
+
+    auto numbers = std::vector<std::int32_t>(count);
+    for (std::size_t i = 0; i < count; i++) {
+        numbers[i] = static_cast<std::int32_t>(i % 1000);
+    }
+    const auto packed = Value::make<Array>(numbers);
+
+    // a trailing nil keeps the array generic; it is overwritten in place so
+    // the elements match the packed array's
+    auto elements = std::vector<Value>();
+    elements.reserve(count);
+    for (const auto number: numbers) {
+        elements.push_back(Value::number(number));
+    }
+    const auto last = elements.back();
+    elements.back() = Value::nil();
+    const auto generic = Value::make<Array>(std::move(elements));
+    generic.as<Array>()->set(count - 1, last);
+
+    fmt::print("{} elements: packed {} bytes, generic {} bytes\n", count, count * sizeof(std::int32_t),
+               count * sizeof(Value));
+    measure("packed", packed, count);
+    measure("generic", generic, count);
+    fmt::print("clone\n");
+    measureClone("packed", packed);
+    measureClone("generic", generic);
+}
@@ -0,0 +1,108 @@
+// Evaluation throughput benchmark
+// Runs the same accessor-heavy statements through the Visitor tree walk and
+// through the bytecode VM, and reports statements/sec for each. A second pass
+// reads from a session holding many globals, where the tree walk looks each
+// name up and the VM indexes a pre-resolved slot.
+
+#include <algorithm>
+#include <chrono>
+#include <memory>
+#include <string>
+#include <vector>
+#include <fmt/format.h>
+#include <repl/bytecode.h>
+#include <repl/interpreter.h>
+#include <repl/lexer.h>
+#include <repl/parser.h>
+
+static const char *SETUP[] = {
+    "$cfg = @{limits = @{max = 10, min = 1,}, names = @[1, 2, 3,],}",
+    "$orders = @[@{status = 1, items = @[4, 5,],}, @{status = 2, items = @[6,],},]",
+};
+
+static const char *STATEMENTS[] = {
+    "cfg.limits.max",
+    "orders[1].items[0]",
+    "orders[0].status = cfg.names[2]",
+    "@[orders[0].status, cfg.limits.min, nil,]",
+    "@{a = 1, b = cfg.limits,}",
+};
+
+static std::unique_ptr<Expr> parse(const char *text) {
+    auto lexer = std::make_unique<Lexer>(text);
+    return Parser(lexer).parse();
+}
+
+template<typename Run>
+static double best(const std::size_t rounds, Run run) {
+    auto best = std::chrono::duration<double>::max();
+    for (int round = 0; round < 5; round++) {
+        const auto start = std::chrono::steady_clock::now();
+        for (std::size_t i = 0; i < rounds; i++) {
+            run();
+        }
+        best = std::min<std::chrono::duration<double> >(best, std::chrono::steady_clock::now() - start);
+    }
+    return best.count();
+}
+
+int main(int argc, char **argv) {
+    const std::size_t rounds = argc > 1 ? std::stoul(argv[1]) : 200000;
+    const auto statements = std::size(STATEMENTS);
+
+    Interpreter interpreter;
+    for (const auto *setup: SETUP) {
+        interpreter.visit(*parse(setup));
+    }
+
+    std::vector<std::unique_ptr<Expr> > trees;
+    std::vector<Chunk> chunks;
+    for (const auto *statement: STATEMENTS) {
+        trees.push_back(parse(statement));
+        auto lexer = std::make_unique<Lexer>(statement);
+        const auto ast = Parser(lexer).parse_flat();
+        chunks.push_back(Compiler::compile(ast, ast.root(), interpreter.global_scope()));
+    }
+
+    const auto walk = best(rounds, [&] {
+        for (const auto &tree: trees) {
+            interpreter.visit(*tree);
+        }
+    });
+    const auto vm = best(rounds, [&] {
+        for (const auto &chunk: chunks) {
+            interpreter.run(chunk);
+        }
+    });
+
+    const auto total = static_cast<double>(rounds * statements);
+    fmt::print("input:  {} statements x {} rounds\n", statements, rounds);
+    fmt::print("visit:  {:.3f} s, {:.2f} Mstatements/s\n", walk, total / walk / 1e6);
+    fmt::print("vm:     {:.3f} s, {:.2f} Mstatements/s\n", vm, total / vm / 1e6);
+
+    // many globals, each read through a 64-element array of variables
+    constexpr int global_count = 300000;
+    constexpr int stride = 4099;
+    for (int i = 0; i < global_count; i++) {
+        const auto name = fmt::format("g{}", i);
+        interpreter.global_scope().global_set(Atom(name), interpreter.visit(*parse("nil")));
+    }
+    std::string reads = "@[";
+    for (int i = 0; i < 64; i++) {
+        reads += fmt::format("g{},", i * stride % global_count);
+    }
+    reads += "]";
+    const auto read_tree = parse(reads.c_str());
+    auto lexer = std::make_unique<Lexer>(reads);
+    const auto read_ast = Parser(lexer).parse_flat();
+    const auto read_chunk = Compiler::compile(read_ast, read_ast.root(), interpreter.global_scope());
+
+    const auto read_rounds = rounds / 10;
+    const auto by_name = best(read_rounds, [&] { interpreter.visit(*read_tree); });
+    const auto by_slot = best(read_rounds, [&] { interpreter.run(read_chunk); });
+    const auto lookups = static_cast<double>(read_rounds * 64);
+    fmt::print("globals: {} defined, {} reads x {} rounds\n", global_count, 64, read_rounds);
+    fmt::print("by name: {:.3f} s, {:.1f} Mreads/s\n", by_name, lookups / by_name / 1e6);
+    fmt::print("by slot: {:.3f} s, {:.1f} Mreads/s\n", by_slot, lookups / by_slot / 1e6);
+    return 0;
+}
@@ -0,0 +1,101 @@
+// Hash map benchmark
+// Builds maps of 10, 1k and 1M names and reports insert and lookup throughput
+// for std::map (what Map and the globals used originally), std::unordered_map,
+// and FlatHashMap. String keys are looked up through std::string_view slices
+// of one buffer, the way the lexer hands out names; Atom keys are the form the
+// interpreter actually stores.
+
+#include <algorithm>
+#include <chrono>
+#include <map>
+#include <random>
+#include <string>
+#include <string_view>
+#include <unordered_map>
+#include <vector>
+#include <fmt/format.h>
+#include <repl/flat_hash_map.h>
+#include <repl/interner.h>
+
+template<typename Run>
+static double best(Run run) {
+    auto best = std::chrono::duration<double>::max();
+    for (int round = 0; round < 3; round++) {
+        const auto start = std::chrono::steady_clock::now();
+        run();
+        best = std::min<std::chrono::duration<double> >(best, std::chrono::steady_clock::now() - start);
+    }
+    return best.count();
+}
+
+static volatile std::size_t sink;
+
+template<typename Map, typename Keys, typename Probe>
+static void measure(const char *label, const Keys &keys, const Probe &probes) {
+    const auto insert = best([&] {
+        Map map;
+        for (std::size_t i = 0; i < keys.size(); i++) {
+            map.emplace(keys[i], i);
+        }
+        sink = map.size();
+    });
+    Map map;
+    for (std::size_t i = 0; i < keys.size(); i++) {
+        map.emplace(keys[i], i);
+    }
+    const auto lookup = best([&] {
+        std::size_t total = 0;
+        for (const auto &probe: probes) {
+            total += map.find(probe)->second;
+        }
+        sink = total;
+    });
+    fmt::print("  {:<28} insert {:8.1f} ns/key   lookup {:8.1f} ns/key\n", label,
+               insert / static_cast<double>(keys.size()) * 1e9, lookup / static_cast<double>(probes.size()) * 1e9);
+}
+
+int main(int argc, char **argv) {
+    const std::size_t lookups = argc > 1 ? std::stoul(argv[1]) : 2000000;
+
+    for (const std::size_t count: {std::size_t{10}, std::size_t{1000}, std::size_t{1000000}}) {
+        std::string buffer;
+        std::vector<std::pair<std::size_t, std::size_t> > spans;
+        for (std::size_t i = 0; i < count; i++) {
+            const auto name = fmt::format("name{} ", i * 2654435761u % 1000003);
+            spans.emplace_back(buffer.size(), name.size() - 1);
+            buffer += name;
+        }
+        std::vector<std::string_view> views;
+        std::vector<std::string> strings;
+        std::vector<Atom> atoms;
+        for (const auto &[offset, length]: spans) {
+            views.push_back(std::string_view(buffer).substr(offset, length));
+            strings.emplace_back(views.back());
+            atoms.emplace_back(views.back());
+        }
+
+        std::mt19937 random(42);
+        std::uniform_int_distribution<std::size_t> pick(0, count - 1);
+        std::vector<std::string_view> view_probes;
+        std::vector<Atom> atom_probes;
+        for (std::size_t i = 0; i < lookups; i++) {
+            const auto index = pick(random);
+            view_probes.push_back(views[index]);
+            atom_probes.push_back(atoms[index]);
+        }
+
+        // std::map<std::string> without a transparent comparator must copy
+        // each probe into a std::string
+        std::vector<std::string> string_probes(view_probes.begin(), view_probes.end());
+
+        fmt::print("{} keys, {} lookups\n", count, lookups);
+        measure<std::map<std::string, std::size_t> >("std::map<string>", strings, string_probes);
+        measure<std::map<std::string, std::size_t, std::less<> > >("std::map<string, less<>>", strings, view_probes);
+        measure<FlatHashMap<std::string, std::size_t, StringHash, std::equal_to<> > >(
+            "FlatHashMap<string>", strings, view_probes);
+        measure<std::map<Atom, std::size_t> >("std::map<Atom>", atoms, atom_probes);
+        measure<std::unordered_map<Atom, std::size_t> >("std::unordered_map<Atom>", atoms, atom_probes);
+        measure<FlatHashMap<Atom, std::size_t> >("FlatHashMap<Atom>", atoms, atom_probes);
+    }
+    return 0;
+}
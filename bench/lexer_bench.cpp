@@ -0,0 +1,44 @@
+// Lexer throughput benchmark
+// Tokenizes a large, literal-heavy generated script and reports bytes/sec.
+
+#include <algorithm>
+#include <chrono>
+#include <string>
+#include <fmt/format.h>
+#include <repl/lexer.h>
+#include <repl/token.h>
+
+static std::string literalHeavyScript(const std::size_t target_bytes) {
+    std::string script;
+    script.reserve(target_bytes + 256);
+    for (int i = 0; script.size() < target_bytes; i++) {
+        script += "$record" + std::to_string(i) + " = @{identifier = " + std::to_string(i % 100000 * 7919) +
+                ", values = @[1, 22, 333, 4444, 55555, nil,],    nested = @{left = leftValue, right = rightValue,},}\n";
+        script += "    print record" + std::to_string(i) + ".values[3]\n";
+    }
+    return script;
+}
+
+int main(int argc, char **argv) {
+    const std::size_t megabytes = argc > 1 ? std::stoul(argv[1]) : 64;
+    const auto script = literalHeavyScript(megabytes << 20);
+
+    auto best = std::chrono::duration<double>::max();
+    std::size_t tokens = 0;
+    for (int round = 0; round < 5; round++) {
+        const auto start = std::chrono::steady_clock::now();
+        Lexer lexer{std::string_view(script)};
+        tokens = 0;
+        for (auto token = lexer.nextToken(); token.type != TokenType::EOF_; token = lexer.nextToken()) {
+            tokens++;
+        }
+        best = std::min<std::chrono::duration<double> >(best, std::chrono::steady_clock::now() - start);
+    }
+
+    fmt::print("input:  {} bytes, {} tokens\n", script.size(), tokens);
+    fmt::print("best:   {:.3f} s\n", best.count());
+    fmt::print("lexer:  {:.1f} MB/s, {:.1f} Mtokens/s\n",
+               static_cast<double>(script.size()) / best.count() / 1e6,
+               static_cast<double>(tokens) / best.count() / 1e6);
+    return 0;
+}
@@ -0,0 +1,46 @@
+// Literal construction benchmark
+// Compiles one statement holding a large nested literal (an array of small
+// maps, each with a small array of its own) and runs it repeatedly on the VM,
+// so nearly all the time goes to creating and freeing arrays and maps.
+
+#include <algorithm>
+#include <chrono>
+#include <memory>
+#include <string>
+#include <fmt/format.h>
+#include <repl/bytecode.h>
+#include <repl/heap.h>
+#include <repl/interpreter.h>
+#include <repl/lexer.h>
+#include <repl/parser.h>
+
+int main(int argc, char **argv) {
+    const std::size_t count = argc > 1 ? std::stoul(argv[1]) : 10000;
+    const std::size_t rounds = argc > 2 ? std::stoul(argv[2]) : 50;
+
+    std::string literal = "@[";
+    for (std::size_t i = 0; i < count; i++) {
+        literal += fmt::format("@{{id = {}, tags = @[{}, nil,], next = nil,}}, ", i, i % 7);
+    }
+    literal += "]";
+
+    Interpreter interpreter;
+    auto lexer = std::make_unique<Lexer>(literal);
+    const auto ast = Parser(lexer).parse_flat();
+    const auto chunk = Compiler::compile(ast, ast.root(), interpreter.global_scope());
+
+    auto best = std::chrono::duration<double>::max();
+    for (std::size_t round = 0; round < rounds; round++) {
+        const auto start = std::chrono::steady_clock::now();
+        {
+            const auto result = interpreter.run(chunk);
+        }
+        best = std::min<std::chrono::duration<double> >(best, std::chrono::steady_clock::now() - start);
+    }
+
+    // an array, and per element a map and its tags array
+    const auto objects = static_cast<double>(1 + 2 * count);
+    fmt::print("{} maps: build and free {:.3f} ms, {:.1f} ns/object\n", count, best.count() * 1e3,
+               best.count() / objects * 1e9);
+    fmt::print("{}", Heap::local().describePools());
+}
@@ -0,0 +1,76 @@
+// Pipeline benchmark
+// Writes a literal-heavy script of distinct lines, so that every line misses
+// the parse cache. Times parsing it alone, cut into chunks, on 1, 2, 4 and 8
+// threads of a WorkStealingPool, which is the part that scales with cores,
+// then REPL::RunFile on it with 0 (one line at a time), 1 (pipelined) and 2,
+// 4 and 8 parsing threads. Output goes to /dev/null.
+
+#include <algorithm>
+#include <chrono>
+#include <cstdio>
+#include <filesystem>
+#include <fstream>
+#include <string>
+#include <fmt/format.h>
+#include <repl/arena.h>
+#include <repl/mapped_file.h>
+#include <repl/parse_cache.h>
+#include <repl/repl.h>
+#include <repl/work_pool.h>
+
+int main(int argc, char **argv) {
+    const int lines = argc > 1 ? std::stoi(argv[1]) : 100000;
+    const auto path = std::filesystem::temp_directory_path() / "repl_pipeline_bench.repl";
+    {
+        std::ofstream script(path, std::ios::binary);
+        for (int i = 0; i < lines; i++) {
+            script << fmt::format("$v{} = @[{}, {}, {}, @{{id = {}, tags = @[{}, {}, nil,],}}, @[{}, {},],]\n",
+                                  i, i, i + 1, i + 2, i, i * 3, i * 5, i * 7, i * 11);
+        }
+    }
+
+    {
+        const MappedFile file(path.string());
+        const auto script = file.contents();
+        for (const std::size_t threads: {1, 2, 4, 8}) {
+            auto best = std::chrono::duration<double>::max();
+            for (int round = 0; round < 5; round++) {
+                const auto start = std::chrono::steady_clock::now();
+                {
+                    WorkStealingPool pool(threads);
+                    for (std::size_t chunk_start = 0; chunk_start < script.size();) {
+                        const auto newline = script.find('\n', std::min(chunk_start + (64 << 10), script.size() - 1));
+                        const auto chunk = script.substr(chunk_start, newline + 1 - chunk_start);
+                        pool.submit([chunk] {
+                            AstArena arena;
+                            for (std::size_t line_start = 0; line_start < chunk.size();) {
+                                const auto line_end = chunk.find('\n', line_start);
+                                static_cast<void>(ParseCache::parse(chunk.substr(line_start, line_end - line_start),
+                                                                    arena));
+                                line_start = line_end + 1;
+                            }
+                        });
+                        chunk_start = newline + 1;
+                    }
+                }
+                best = std::min<std::chrono::duration<double> >(best, std::chrono::steady_clock::now() - start);
+            }
+            fmt::print(stderr, "parsing alone on {} threads: {:.1f} ms\n", threads, best.count() * 1e3);
+        }
+    }
+
+    if (!std::freopen("/dev/null", "w", stdout)) {
+        return 1;
+    }
+    for (const std::size_t jobs: {0, 1, 2, 4, 8}) {
+        auto best = std::chrono::duration<double>::max();
+        for (int round = 0; round < 5; round++) {
+            const auto start = std::chrono::steady_clock::now();
+            REPL::RunFile(path.string(), ParseCache::DEFAULT_CAPACITY, jobs);
+            best = std::min<std::chrono::duration<double> >(best, std::chrono::steady_clock::now() - start);
+        }
+        fmt::print(stderr, "run with {} parsing threads: {} lines in {:.1f} ms, {:.0f} lines/s\n", jobs, lines,
+                   best.count() * 1e3, lines / best.count());
+    }
+    std::filesystem::remove(path);
+}
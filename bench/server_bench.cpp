@@ -0,0 +1,83 @@
+// Server benchmark
+// Serves a dataset of maps over a Unix domain socket and measures the
+// request rate of 1, 2, 4 and 8 clients each sending access-path reads one at
+// a time, first alone and then while another client keeps writing.
+
+#include <atomic>
+#include <chrono>
+#include <string>
+#include <thread>
+#include <vector>
+#include <fmt/format.h>
+#include <repl/server.h>
+
+#ifdef __linux__
+#include <unistd.h>
+
+int main(int argc, char **argv) {
+    const int maps = argc > 1 ? std::stoi(argv[1]) : 1000;
+    const auto path = fmt::format("/tmp/repl_server_bench_{}.sock", getpid());
+
+    Server server(path, std::thread::hardware_concurrency(), 4096);
+    std::thread loop([&] { server.run(); });
+    {
+        std::string rows = "$rows = @[";
+        for (int i = 0; i < maps; i++) {
+            rows += fmt::format("@{{id = {}, limits = @{{max = {}, min = 1,}},}}, ", i, i * 2);
+        }
+        static_cast<void>(Client(path).request(rows + "]"));
+    }
+
+    const auto read = fmt::format("rows[{}].limits.max", maps - 1);
+    for (const bool writing: {false, true}) {
+        for (const int clients: {1, 2, 4, 8}) {
+            std::atomic<bool> done{false};
+            std::atomic<long> reads{0};
+            std::atomic<long> writes{0};
+            auto threads = std::vector<std::thread>();
+            for (int i = 0; i < clients; i++) {
+                threads.emplace_back([&] {
+                    const Client client(path);
+                    long count = 0;
+                    while (!done.load(std::memory_order_relaxed)) {
+                        static_cast<void>(client.request(read));
+                        count++;
+                    }
+                    reads += count;
+                });
+            }
+            if (writing) {
+                threads.emplace_back([&] {
+                    const Client client(path);
+                    long count = 0;
+                    while (!done.load(std::memory_order_relaxed)) {
+                        static_cast<void>(client.request(fmt::format("rows[0].id = {}", count)));
+                        count++;
+                    }
+                    writes += count;
+                });
+            }
+            const auto start = std::chrono::steady_clock::now();
+            std::this_thread::sleep_for(std::chrono::milliseconds(500));
+            done = true;
+            for (auto &thread: threads) {
+                thread.join();
+            }
+            const auto seconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+            fmt::print("{} clients{}: {:.0f} reads/s", clients, writing ? " and a writer" : "",
+                       static_cast<double>(reads.load()) / seconds);
+            if (writing) {
+                fmt::print(", {:.0f} writes/s", static_cast<double>(writes.load()) / seconds);
+            }
+            fmt::print("\n");
+        }
+    }
+
+    server.stop();
+    loop.join();
+}
+#else
+int main() {
+    fmt::print("the server needs Linux\n");
+}
+#endif
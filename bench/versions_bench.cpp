@@ -0,0 +1,88 @@
+// Versions benchmark
+// Builds a dataset of maps and a large packed array in the globals, then
+// times the first commit() (freezing every map, sharing the array), a commit
+// after one nested store (copying just the path to it) and snapshot reads of
+// an access path from 1, 2 and 4 reader threads while the writer keeps
+// storing and committing.
+
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <memory>
+#include <string>
+#include <thread>
+#include <vector>
+#include <fmt/format.h>
+#include <repl/bytecode.h>
+#include <repl/interpreter.h>
+#include <repl/lexer.h>
+#include <repl/parser.h>
+
+static void run(Interpreter &interpreter, const std::string &input) {
+    auto lexer = std::make_unique<Lexer>(input);
+    const auto ast = Parser(lexer).parse_flat();
+    interpreter.run(Compiler::compile(ast, ast.root(), interpreter.global_scope()));
+}
+
+int main(int argc, char **argv) {
+    const int maps = argc > 1 ? std::stoi(argv[1]) : 1000;
+
+    Interpreter interpreter;
+    std::string rows = "$rows = @[";
+    for (int i = 0; i < maps; i++) {
+        rows += fmt::format("@{{id = {}, limits = @{{max = {}, min = 1,}},}}, ", i, i * 2);
+    }
+    run(interpreter, rows + "]");
+    std::string numbers = "$numbers = @[";
+    for (int i = 0; i < 100000; i++) {
+        numbers += fmt::format("{}, ", i);
+    }
+    run(interpreter, numbers + "]");
+
+    const auto first = std::chrono::steady_clock::now();
+    interpreter.commit();
+    fmt::print("first commit: {} maps and 100000 numbers in {:.3f} ms\n", 2 * maps,
+               std::chrono::duration<double>(std::chrono::steady_clock::now() - first).count() * 1e3);
+
+    auto best = std::chrono::duration<double>::max();
+    for (int round = 0; round < 20; round++) {
+        run(interpreter, fmt::format("rows[{}].limits.max = {}", round, round));
+        const auto start = std::chrono::steady_clock::now();
+        interpreter.commit();
+        best = std::min<std::chrono::duration<double> >(best, std::chrono::steady_clock::now() - start);
+    }
+    fmt::print("commit after one store: {:.3f} ms\n", best.count() * 1e3);
+
+    const auto path = fmt::format("rows[{}].limits.max", maps - 1);
+    for (const int threads: {1, 2, 4}) {
+        std::atomic<bool> done{false};
+        std::atomic<long> reads{0};
+        auto readers = std::vector<std::thread>();
+        for (int i = 0; i < threads; i++) {
+            readers.emplace_back([&] {
+                long count = 0;
+                while (!done.load(std::memory_order_relaxed)) {
+                    const auto snapshot = interpreter.versions().pin();
+                    static_cast<void>(snapshot.read(path));
+                    count++;
+                }
+                reads += count;
+            });
+        }
+        const auto start = std::chrono::steady_clock::now();
+        int commits = 0;
+        while (std::chrono::steady_clock::now() - start < std::chrono::milliseconds(500)) {
+            run(interpreter, fmt::format("rows[0].id = {}", commits));
+            interpreter.commit();
+            commits++;
+        }
+        done = true;
+        for (auto &reader: readers) {
+            reader.join();
+        }
+        const auto seconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+        fmt::print("{} readers: {:.2f} Mreads/s alongside {} commits/s, {} versions retained\n", threads,
+                   static_cast<double>(reads.load()) / seconds / 1e6, static_cast<int>(commits / seconds),
+                   interpreter.versions().retained());
+    }
+}
@@ -0,0 +1,67 @@
+//
+// Created by mizuk on 2025/3/10.
+//
+
+#ifndef ARENA_H
+#define ARENA_H
+#include <cstddef>
+#include <memory>
+#include <vector>
+
+// Bump-pointer arena for AST nodes. While an AstArena::Scope is active on a
+// thread, every Expr allocated on that thread is carved out of the arena and
+// its delete becomes a no-op; reset() then reclaims the whole tree at once and
+// keeps the blocks for the next statement.
+class AstArena {
+    struct Block {
+        std::unique_ptr<std::byte[]> memory;
+        std::size_t size;
+    };
+
+    std::vector<Block> blocks;
+    std::size_t block_index{0};
+    std::size_t offset{0};
+    // nodes handed out and not yet deleted; reset() refuses while any remain
+    std::size_t live{0};
+
+public:
+    static constexpr std::size_t BLOCK_SIZE = 64 * 1024;
+
+    AstArena() = default;
+
+    AstArena(const AstArena &) = delete;
+
+    AstArena &operator=(const AstArena &) = delete;
+
+    ~AstArena() = default;
+
+    [[nodiscard]] void *allocate(std::size_t size, std::size_t alignment);
+
+    void deallocate() noexcept;
+
+    // O(1): rewinds to the first block. Every node must already be deleted.
+    void reset();
+
+    [[nodiscard]] std::size_t live_nodes() const;
+
+    [[nodiscard]] std::size_t reserved_bytes() const;
+
+    [[nodiscard]] static AstArena *current();
+
+    // Routes Expr allocations on this thread to `arena` (or back to the heap
+    // for nullptr) until the scope ends.
+    class Scope {
+        AstArena *previous;
+
+    public:
+        explicit Scope(AstArena *arena);
+
+        Scope(const Scope &) = delete;
+
+        Scope &operator=(const Scope &) = delete;
+
+        ~Scope();
+    };
+};
+
+#endif //ARENA_H
@@ -9,21 +9,29 @@
 #include <utility>
 #include <vector>
 
+#include "repl/interner.h"
+
 // Forward declaration so we can use Visitor* in the accept method.
 class Visitor;
 
-class Object;
+class Value;
 
 class Expr {
 public:
     virtual ~Expr() = default;
 
+    // Nodes come from the thread's active AstArena if there is one (see
+    // AstArena::Scope), otherwise from the heap; delete handles both.
+    static void *operator new(std::size_t size);
+
+    static void operator delete(void *ptr) noexcept;
+
     virtual bool operator==(const Expr &other) const = 0;
 
     bool operator!=(const Expr &other) const;
 
     // New: accept method for the Visitor pattern.
-    virtual std::shared_ptr<Object> accept(Visitor *visitor) const = 0;
+    virtual Value accept(Visitor *visitor) const = 0;
 };
 
 class Literal : public Expr {
@@ -40,40 +48,40 @@ public:
     bool operator==(const Expr &other) const override;
 
     // New: Declaration for the accept method.
-    std::shared_ptr<Object> accept(Visitor *visitor) const override;
+    Value accept(Visitor *visitor) const override;
 };
 
 class NilLiteral final : public Literal {
 public:
     bool operator==(const Expr &other) const override;
 
-    std::shared_ptr<Object> accept(Visitor *visitor) const override;
+    Value accept(Visitor *visitor) const override;
 };
 
 class Variable final : public Expr {
 public:
-    std::string name;
+    Atom name;
 
-    explicit Variable(std::string name) : name(std::move(name)) {
+    explicit Variable(const Atom name) : name(name) {
     }
 
     ~Variable() override = default;
 
     bool operator==(const Expr &other) const override;
 
-    std::shared_ptr<Object> accept(Visitor *visitor) const override;
+    Value accept(Visitor *visitor) const override;
 };
 
 class Symbol final : public Expr {
 public:
-    std::string name;
+    Atom name;
 
-    explicit Symbol(std::string name) : name(std::move(name)) {
+    explicit Symbol(const Atom name) : name(name) {
     }
 
     bool operator==(const Expr &other) const override;
 
-    std::shared_ptr<Object> accept(Visitor *visitor) const override;
+    Value accept(Visitor *visitor) const override;
 };
 
 class Assignment final : public Expr {
@@ -87,7 +95,7 @@ public:
 
     bool operator==(const Expr &other) const override;
 
-    std::shared_ptr<Object> accept(Visitor *visitor) const override;
+    Value accept(Visitor *visitor) const override;
 };
 
 class Declaration final : public Expr {
@@ -101,7 +109,7 @@ public:
 
     bool operator==(const Expr &other) const override;
 
-    std::shared_ptr<Object> accept(Visitor *visitor) const override;
+    Value accept(Visitor *visitor) const override;
 };
 
 class ArrayDefinition final : public Expr {
@@ -114,7 +122,7 @@ public:
 
     bool operator==(const Expr &other) const override;
 
-    std::shared_ptr<Object> accept(Visitor *visitor) const override;
+    Value accept(Visitor *visitor) const override;
 };
 
 class EntryDefinition final : public Expr {
@@ -129,7 +137,7 @@ public:
 
     bool operator==(const Expr &other) const override;
 
-    std::shared_ptr<Object> accept(Visitor *visitor) const override;
+    Value accept(Visitor *visitor) const override;
 };
 
 class MapDefinition final : public Expr {
@@ -142,48 +150,45 @@ public:
 
     bool operator==(const Expr &other) const override;
 
-    std::shared_ptr<Object> accept(Visitor *visitor) const override;
+    Value accept(Visitor *visitor) const override;
 };
 
-class AccessorExpr : public Expr {
+// `root.key[index]...`: a variable followed by one or more steps, each an
+// index or a key the parser has already resolved. Without a value the path is
+// read; with one, the value is stored into the last step. Either way it is
+// walked in a single loop, however long the path.
+class AccessPath final : public Expr {
 public:
-    std::unique_ptr<Expr> instance;
-    std::unique_ptr<Expr> accessor;
+    std::unique_ptr<Variable> root;
+    std::vector<Identifier> steps;
+    std::unique_ptr<Expr> value;
 
-    AccessorExpr(std::unique_ptr<Expr> &instance, std::unique_ptr<Expr> &accessor)
-        : instance(std::move(instance)),
-          accessor(std::move(accessor)) {
+    AccessPath(std::unique_ptr<Variable> &root, std::vector<Identifier> steps)
+        : root(std::move(root)), steps(std::move(steps)) {
     }
 
-    bool operator==(const Expr &other) const override;
-
-    std::shared_ptr<Object> accept(Visitor *visitor) const override;
-};
-
-class GetterExpr final : public AccessorExpr {
-public:
-    explicit GetterExpr(std::unique_ptr<Expr> &instance, std::unique_ptr<Expr> &accessor)
-        : AccessorExpr(instance, accessor) {
+    AccessPath(std::unique_ptr<Variable> &root, std::vector<Identifier> steps, std::unique_ptr<Expr> &value)
+        : root(std::move(root)), steps(std::move(steps)), value(std::move(value)) {
     }
 
     bool operator==(const Expr &other) const override;
 
-    std::shared_ptr<Object> accept(Visitor *visitor) const override;
+    Value accept(Visitor *visitor) const override;
 };
 
-class SetterExpr final : public AccessorExpr {
+// A call of a builtin function, e.g. `sum(a)`.
+class Call final : public Expr {
 public:
-    std::unique_ptr<Expr> value;
+    Atom name;
+    std::vector<std::unique_ptr<Expr> > arguments;
 
-    explicit SetterExpr(std::unique_ptr<Expr> &instance,
-                        std::unique_ptr<Expr> &accessor,
-                        std::unique_ptr<Expr> &value)
-        : AccessorExpr(instance, accessor), value(std::move(value)) {
+    Call(const Atom name, std::vector<std::unique_ptr<Expr> > arguments)
+        : name(name), arguments(std::move(arguments)) {
     }
 
     bool operator==(const Expr &other) const override;
 
-    std::shared_ptr<Object> accept(Visitor *visitor) const override;
+    Value accept(Visitor *visitor) const override;
 };
 
 class PrintStatement final : public Expr {
@@ -196,21 +201,35 @@ public:
 
     bool operator==(const Expr &other) const override;
 
-    std::shared_ptr<Object> accept(Visitor *visitor) const override;
+    Value accept(Visitor *visitor) const override;
 };
 
 class EmptyStatement final : public Expr {
 public:
     bool operator==(const Expr &other) const override;
 
-    std::shared_ptr<Object> accept(Visitor *visitor) const override;
+    Value accept(Visitor *visitor) const override;
+};
+
+// A whole script: statements separated by newlines or ';'.
+class Program final : public Expr {
+public:
+    std::vector<std::unique_ptr<Expr> > statements;
+
+    explicit Program(std::vector<std::unique_ptr<Expr> > statements)
+        : statements(std::move(statements)) {
+    }
+
+    bool operator==(const Expr &other) const override;
+
+    Value accept(Visitor *visitor) const override;
 };
 
 class Self final : public Expr {
 public:
     bool operator==(const Expr &other) const override;
 
-    std::shared_ptr<Object> accept(Visitor *visitor) const override;
+    Value accept(Visitor *visitor) const override;
 };
 
 #endif //AST_H
@@ -0,0 +1,44 @@
+//
+// Created by mizuk on 2025/3/22.
+//
+
+#ifndef BUILTINS_H
+#define BUILTINS_H
+#include <cstdint>
+#include <optional>
+#include <span>
+#include <string_view>
+
+#include "repl/interner.h"
+#include "repl/value.h"
+
+// Functions callable as `name(args)`. All but clone take an array first:
+//   len(a)       element count (also the key count of a map)
+//   sum(a)       total of the numbers
+//   min(a)       smallest number, nil for an empty array
+//   max(a)       largest number, nil for an empty array
+//   find(a, v)   index of the first element equal to v, or nil
+//   fill(a, v)   sets every element to v and returns a
+//   clone(x)     a copy of array or map x as it is now, in O(1): arrays and
+//                maps in it are copied as they were, one level at a time,
+//                when the copy first reaches them; other values as they are
+// On a packed array these run as vector kernels over the raw numbers.
+enum class Builtin : std::uint8_t {
+    LEN,
+    SUM,
+    MIN,
+    MAX,
+    FIND,
+    FILL,
+    CLONE,
+};
+
+[[nodiscard]] std::optional<Builtin> findBuiltin(Atom name);
+
+[[nodiscard]] std::string_view toString(Builtin builtin);
+
+// Throws InterpreterError(INVALID_ARGUMENTS) for a wrong argument count or a
+// non-number where a number is required.
+Value callBuiltin(Builtin builtin, std::span<const Value> arguments);
+
+#endif //BUILTINS_H
@@ -0,0 +1,178 @@
+//
+// Created by mizuk on 2025/3/16.
+//
+
+#ifndef BYTECODE_H
+#define BYTECODE_H
+#include <array>
+#include <cstdint>
+#include <string>
+#include <vector>
+
+#include "repl/builtins.h"
+#include "repl/flat_ast.h"
+#include "repl/interner.h"
+#include "repl/shape.h"
+
+class Globals;
+
+// Every opcode, with the width of its inline operand in bytes. The list drives
+// the enum, the disassembler's names and the VM's dispatch table, so they can
+// never drift apart. Stack effects are noted as (before -- after).
+#define REPL_OPCODES(X)                                                         \
+    X(PUSH_INT, 4)        /* ( -- int )            operand: value          */   \
+    X(PUSH_NIL, 0)        /* ( -- nil )                                    */   \
+    X(LOAD_GLOBAL, 4)     /* ( -- value )          operand: slot           */   \
+    X(CHECK_DEFINED, 4)   /* ( -- )                throws if undefined     */   \
+    X(CHECK_UNDEFINED, 4) /* ( -- )                throws if defined       */   \
+    X(STORE_GLOBAL, 4)    /* ( value -- value )    operand: slot           */   \
+    X(DEFINE_GLOBAL, 4)   /* ( value -- nil )      operand: slot           */   \
+    X(GET_INDEX, 4)       /* ( array -- value )    operand: index          */   \
+    X(GET_KEY, 4)         /* ( map -- value )      operand: cache site     */   \
+    X(SET_INDEX, 4)       /* ( array value -- value ) operand: index       */   \
+    X(SET_KEY, 4)         /* ( map value -- value )   operand: cache site  */   \
+    X(MAKE_ARRAY, 4)      /* ( v1..vn -- array )   operand: n              */   \
+    X(MAKE_MAP, 4)        /* ( v1..vn -- map )     operand: key list index */   \
+    X(COPY_ARRAY, 4)      /* ( -- array )          operand: constant       */   \
+    X(COPY_MAP, 4)        /* ( -- map )            operand: constant       */   \
+    X(CALL, 4)            /* ( a1..an -- result )  operand: call site      */   \
+    X(PRINT, 0)           /* ( value -- nil )                              */   \
+    X(POP, 0)             /* ( value -- )                                  */   \
+    X(RETURN, 0)          /* ( value -- )          ends the chunk          */
+
+enum class OpCode : std::uint8_t {
+#define REPL_OPCODE_ENUM(name, width) name,
+    REPL_OPCODES(REPL_OPCODE_ENUM)
+#undef REPL_OPCODE_ENUM
+};
+
+inline constexpr std::size_t OPCODE_COUNT = 0
+#define REPL_OPCODE_COUNT(name, width) +1
+    REPL_OPCODES(REPL_OPCODE_COUNT);
+#undef REPL_OPCODE_COUNT
+
+// Polymorphic inline cache for one GET_KEY or SET_KEY site: the offset its
+// key had in each of the last few map shapes seen there. A hit is a pointer
+// compare and a load; a miss asks the shape and remembers the answer. A site
+// that sees more than WAYS shapes goes megamorphic and stops caching. A
+// dictionary shape is never cached, as it does not live for the process.
+struct InlineCache {
+    static constexpr std::size_t WAYS = 4;
+
+    struct Entry {
+        const Shape *shape;
+        std::uint32_t offset;
+    };
+
+    Atom key;
+    std::array<Entry, WAYS> entries{};
+    std::uint32_t used{0};
+    bool megamorphic{false};
+    std::uint64_t hits{0};
+    std::uint64_t misses{0};
+
+    explicit InlineCache(const Atom key) : key(key) {
+    }
+
+    // Offset of `key` in maps of `shape`; throws std::out_of_range if they
+    // don't have it.
+    std::uint32_t offset(const Shape *shape) {
+        for (std::uint32_t i = 0; i < this->used; i++) {
+            if (this->entries[i].shape == shape) {
+                this->hits++;
+                return this->entries[i].offset;
+            }
+        }
+        return this->miss(shape);
+    }
+
+    std::uint32_t miss(const Shape *shape);
+
+    // uninitialized, monomorphic, polymorphic or megamorphic
+    [[nodiscard]] std::string state() const;
+
+    // the cached contents are runtime state, not part of the program
+    bool operator==(const InlineCache &other) const {
+        return this->key == other.key;
+    }
+};
+
+// A CALL instruction's target, resolved when compiling. An unknown name is
+// kept so the call fails when it runs, like an undefined variable.
+struct CallSite {
+    Atom name;
+    std::optional<Builtin> builtin;
+    std::uint32_t argument_count;
+
+    bool operator==(const CallSite &other) const = default;
+};
+
+// Compiled form of one statement: a byte stream of opcodes, each followed by
+// its operand in native byte order.
+struct Chunk {
+    std::vector<std::uint8_t> code;
+    // MAKE_MAP keys, in the order their values are pushed
+    std::vector<std::vector<Atom> > key_lists;
+    // the shape each key list builds, resolved once at compile time;
+    // nullptr for one past Shape::MAX_SHARED_KEYS, whose maps each get a
+    // dictionary
+    std::vector<const Shape *> shapes;
+    std::vector<CallSite> calls;
+    // one per GET_KEY and SET_KEY; filled in as the chunk runs
+    mutable std::vector<InlineCache> caches;
+    // deepest the operand stack gets, so the VM can size it up front
+    std::uint32_t max_stack{0};
+    // the table whose slots the *_GLOBAL operands index
+    const Globals *globals{nullptr};
+
+    void emit(OpCode op);
+
+    void emit(OpCode op, std::uint32_t operand);
+
+    [[nodiscard]] std::uint32_t operand(std::size_t offset) const;
+
+    bool operator==(const Chunk &other) const = default;
+};
+
+class Compiler {
+    // literals with more elements are built by each run rather than hoisted
+    static constexpr std::size_t MAX_HOISTED_ELEMENTS = 256;
+
+    Chunk chunk;
+    Globals &globals;
+    std::uint32_t depth{0};
+
+    explicit Compiler(Globals &globals);
+
+    void lower(const FlatAst &ast, NodeIndex node);
+
+    void emit(OpCode op, int effect);
+
+    void emit(OpCode op, std::uint32_t operand, int effect);
+
+    // a fresh inline cache for a GET_KEY or SET_KEY of `key`
+    std::uint32_t cacheSite(Atom key);
+
+    // The constant for an ARRAY or MAP node whose elements are all numbers
+    // and nil, materialized the first time such a literal is compiled;
+    // nullopt for any other literal.
+    std::optional<std::uint32_t> hoist(const FlatAst &ast, NodeIndex node);
+
+public:
+    // Compiles `node` (a statement, or a whole PROGRAM) into a chunk that
+    // leaves the node's value as the chunk's result. Variable names are
+    // resolved to slots of `globals` here, once.
+    static Chunk compile(const FlatAst &ast, NodeIndex node, Globals &globals);
+};
+
+[[nodiscard]] std::string toString(OpCode op);
+
+// One instruction per line: offset, opcode, decoded operand (a slot is shown
+// as #slot followed by its name).
+[[nodiscard]] std::string disassemble(const Chunk &chunk);
+
+// One line per GET_KEY and SET_KEY: offset, opcode, key, then the site's hit
+// and miss counts and cache state.
+[[nodiscard]] std::string describeCaches(const Chunk &chunk);
+
+#endif //BYTECODE_H
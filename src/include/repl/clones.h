@@ -0,0 +1,188 @@
+//
+// Created by mizuk on 2025/3/27.
+//
+
+#ifndef CLONES_H
+#define CLONES_H
+#include <cstddef>
+#include <cstdint>
+#include <functional>
+#include <memory>
+#include <vector>
+
+#include "repl/flat_hash_map.h"
+#include "repl/value.h"
+
+class CloneFamily;
+
+// clone(x) in O(1). The clone of an array or map shares its storage, a
+// persistent vector, and the arrays and maps in it are copied one level at a
+// time, as they were when the clone was made, the first time the clone
+// reaches them or stores beside them. The original and every name bound to
+// what it holds go on changing in place.
+//
+// Time is counted in instants, one per clone(x) on the thread. An array or
+// map stored into after an instant some live clone may look back to first
+// keeps its storage as of then, its past, which costs O(1) as well, so a
+// nested object copied later is copied as it was. Pasts no clone can look
+// back to any more are dropped on the next store or collection.
+//
+// The copies an array or map reaches from a clone are clones too, each of one
+// object at one instant; the leaves of its storage it has copied the objects
+// of carry its tag as their owner (see pvector.h). A leaf it has not is as
+// the object it was copied from held it, which, when that was a clone too,
+// may itself be a leaf of an older object seen at an older instant. So each
+// clone keeps the chain of what it was copied from, its lineage, and sees an
+// object in such a leaf the way each clone along the chain would have.
+//
+// Like Values, all of this belongs to one thread.
+
+// One link of a lineage: an object copied at an instant for one clone(x).
+// Each link keeps its instant looked back to for as long as it lives.
+struct CloneLineage {
+    // the tag of the object copied, 0 if it was not a clone itself
+    std::uint64_t tag;
+    std::uint64_t instant;
+    std::shared_ptr<CloneFamily> family;
+    // the lineage of the object copied, nullptr if it was not a clone
+    std::shared_ptr<const CloneLineage> parent;
+
+    CloneLineage(std::uint64_t tag, std::uint64_t instant, std::shared_ptr<CloneFamily> family,
+                 std::shared_ptr<const CloneLineage> parent);
+
+    CloneLineage(const CloneLineage &) = delete;
+
+    CloneLineage &operator=(const CloneLineage &) = delete;
+
+    ~CloneLineage();
+};
+
+// What a clone keeps of where it came from.
+struct CloneOrigin {
+    // on the leaves this clone owns
+    std::uint64_t tag;
+    std::shared_ptr<const CloneLineage> lineage;
+    // the object copied, which keeps its family entry (see CloneFamily) from
+    // going to another object at the same address
+    Value source;
+
+    CloneOrigin(std::shared_ptr<const CloneLineage> lineage, Value source);
+
+    CloneOrigin(const CloneOrigin &) = delete;
+
+    CloneOrigin &operator=(const CloneOrigin &) = delete;
+
+    ~CloneOrigin();
+};
+
+// The state of an array or map that has a past or is a clone; Past is its
+// storage as of an instant.
+template<typename Past>
+struct CloneState {
+    // oldest first
+    std::vector<Past> pasts;
+    // set for a clone
+    std::unique_ptr<CloneOrigin> origin;
+};
+
+// The copies one clone(x) has made so far, by the object copied and the
+// instant it was copied as of, so that an object reached twice is copied once
+// and a cycle stays a cycle; an entry goes with its copy.
+class CloneFamily {
+    struct Key {
+        const Object *object;
+        std::uint64_t instant;
+
+        bool operator==(const Key &) const = default;
+    };
+
+    struct KeyHash {
+        std::size_t operator()(const Key &key) const noexcept {
+            return std::hash<const Object *>{}(key.object) ^ std::hash<std::uint64_t>{}(key.instant) * 31;
+        }
+    };
+
+    FlatHashMap<Key, Object *, KeyHash> copies;
+
+public:
+    // `value` as it was at `instant`, copied for `family` unless it never
+    // changes or already was
+    static Value copy(const std::shared_ptr<CloneFamily> &family, const Value &value, std::uint64_t instant);
+
+    void forget(const Object *object, std::uint64_t instant);
+};
+
+class Clones {
+    static inline thread_local std::uint64_t clock = 0;
+    // the latest instant of a live lineage link, 0 when there is none
+    static inline thread_local std::uint64_t seen = 0;
+
+    friend struct CloneLineage;
+
+    // whether a live lineage link looks back to an instant in (after, until]
+    static bool watched(std::uint64_t after, std::uint64_t until);
+
+public:
+    // the instant of the latest clone(x), 0 before the first
+    static std::uint64_t now() {
+        return clock;
+    }
+
+    // An array or map stamped with an earlier instant keeps a past before it
+    // is stored into.
+    static std::uint64_t horizon() {
+        return seen;
+    }
+
+    // a new clone of `value` as it is now, in a family of its own; immediates
+    // and objects that never change are returned as they are
+    static Value clone(const Value &value);
+
+    // a new tag for a clone's leaves, never 0
+    static std::uint64_t tag();
+
+    // The lineage of a copy of `source`, which is a clone if `origin` is set,
+    // made at `instant` for `family`.
+    static std::shared_ptr<const CloneLineage> lineage(const CloneOrigin *origin, std::uint64_t instant,
+                                                       const std::shared_ptr<CloneFamily> &family);
+
+    // The item of a leaf owned by `owner` that the clone with `origin` does
+    // not own, as that clone sees it.
+    static Value resolve(const CloneOrigin &origin, std::uint64_t owner, const Value &item);
+
+    // Drops the pasts no live clone looks back to, the one for an instant
+    // serving every instant after the one before it up to its own; into
+    // `dropped`, when given, for the caller to free.
+    template<typename Past>
+    static void trim(std::vector<Past> &pasts, std::vector<std::shared_ptr<void> > *dropped = nullptr) {
+        auto kept = pasts.begin();
+        std::uint64_t after = 0;
+        for (auto &past: pasts) {
+            if (!watched(after, past.instant)) {
+                if (dropped != nullptr) {
+                    dropped->push_back(std::make_shared<Past>(std::move(past)));
+                }
+                continue;
+            }
+            after = past.instant;
+            if (&*kept != &past) {
+                *kept = std::move(past);
+            }
+            ++kept;
+        }
+        pasts.erase(kept, pasts.end());
+    }
+
+    // the past for `instant`, nullptr when nothing has been stored since
+    template<typename Past>
+    static const Past *pastAt(const std::vector<Past> &pasts, const std::uint64_t instant) {
+        for (const auto &past: pasts) {
+            if (past.instant >= instant) {
+                return &past;
+            }
+        }
+        return nullptr;
+    }
+};
+
+#endif //CLONES_H
@@ -0,0 +1,81 @@
+//
+// Created by mizuk on 2025/3/11.
+//
+
+#ifndef FLAT_AST_H
+#define FLAT_AST_H
+#include <cstdint>
+#include <span>
+#include <vector>
+
+#include "repl/interner.h"
+
+class Expr;
+
+enum class NodeKind : std::uint8_t {
+    NUMBER,
+    NIL,
+    VARIABLE,
+    SYMBOL,
+    ASSIGNMENT,
+    DECLARATION,
+    ARRAY,
+    ENTRY,
+    MAP,
+    ACCESS_PATH,
+    CALL,
+    PRINT,
+    EMPTY,
+    PROGRAM,
+    SELF,
+};
+
+using NodeIndex = std::uint32_t;
+
+// Compact, pointer-free form of an expression tree stored as parallel arrays.
+// Nodes are laid out in post-order, so every child precedes its parent and the
+// root is the last node. Node i's children are
+// children[first_child[i] .. first_child[i + 1]).
+//
+// Operands: NUMBER holds the value's bits, VARIABLE, SYMBOL and CALL (the
+// function name) hold an Atom id, ACCESS_PATH holds its step count; other
+// kinds leave it 0. An ACCESS_PATH's children are its root VARIABLE, a NUMBER
+// or SYMBOL per step and, for a store, the value; a CALL's are its arguments.
+// The layout is canonical, so two trees are structurally equal exactly when
+// their arrays are equal.
+class FlatAst {
+    std::vector<NodeKind> kinds;
+    std::vector<std::uint32_t> operands;
+    std::vector<std::uint32_t> first_child{0};
+    std::vector<NodeIndex> children;
+
+public:
+    FlatAst() = default;
+
+    // Lowers a pointer tree built by the Parser (or by hand).
+    static FlatAst from(const Expr &expr);
+
+    NodeIndex add(NodeKind kind, std::uint32_t operand, std::span<const NodeIndex> node_children);
+
+    [[nodiscard]] NodeIndex root() const;
+
+    [[nodiscard]] std::size_t size() const;
+
+    [[nodiscard]] NodeKind kind(NodeIndex node) const;
+
+    [[nodiscard]] std::uint32_t operand(NodeIndex node) const;
+
+    [[nodiscard]] int number(NodeIndex node) const;
+
+    [[nodiscard]] Atom atom(NodeIndex node) const;
+
+    [[nodiscard]] std::span<const NodeIndex> childrenOf(NodeIndex node) const;
+
+    [[nodiscard]] NodeIndex child(NodeIndex node, std::uint32_t index) const;
+
+    [[nodiscard]] std::uint64_t hash() const;
+
+    bool operator==(const FlatAst &other) const = default;
+};
+
+#endif //FLAT_AST_H
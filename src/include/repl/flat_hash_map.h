@@ -0,0 +1,460 @@
+//
+// Created by mizuk on 2025/3/18.
+//
+
+#ifndef FLAT_HASH_MAP_H
+#define FLAT_HASH_MAP_H
+#include <bit>
+#include <cstddef>
+#include <cstdint>
+#include <functional>
+#include <iterator>
+#include <memory>
+#include <stdexcept>
+#include <string>
+#include <string_view>
+#include <utility>
+
+#if defined(__SSE2__) || defined(_M_X64)
+#include <emmintrin.h>
+#define REPL_FLAT_HASH_MAP_SSE2 1
+#endif
+
+// Hashes every string type through std::string_view, so a map keyed on
+// std::string can be searched with a view (or a literal) without a copy.
+struct StringHash {
+    using is_transparent = void;
+
+    std::size_t operator()(const std::string_view text) const noexcept {
+        return std::hash<std::string_view>{}(text);
+    }
+};
+
+// Open-addressing hash map in the Swiss-table style. One control byte per
+// slot records whether it is empty, deleted, or full together with 7 bits of
+// the key's hash; lookups compare a whole 16-byte group of control bytes at
+// once (SSE2 where available) and only touch the slots whose bits match.
+// Entries live inline in one flat array, so there is no allocation per entry.
+//
+// Keys and values move when the table grows, so iterators and references are
+// invalidated by any insertion. Keys must not be modified through iterators.
+// With a transparent Hash and Equal (e.g. StringHash and std::equal_to<>),
+// find, contains and at accept any type the two can handle.
+template<typename Key, typename Value, typename Hash = std::hash<Key>, typename Equal = std::equal_to<Key> >
+class FlatHashMap {
+public:
+    using key_type = Key;
+    using mapped_type = Value;
+    using value_type = std::pair<Key, Value>;
+    using size_type = std::size_t;
+
+private:
+    static constexpr std::size_t GROUP_WIDTH = 16;
+    static constexpr std::int8_t EMPTY = -128;
+    static constexpr std::int8_t DELETED = -2;
+    static constexpr std::size_t NOT_FOUND = static_cast<std::size_t>(-1);
+
+    // control bytes; a capacity is always a power of two and a multiple of
+    // GROUP_WIDTH, and probing visits whole aligned groups
+    std::unique_ptr<std::int8_t[]> ctrl;
+    value_type *slots{nullptr};
+    std::size_t capacity{0};
+    std::size_t count{0};
+    // insertions left before the table must grow (or be rebuilt to drop
+    // tombstones); keeps the load factor at or below 7/8
+    std::size_t growth_left{0};
+    [[no_unique_address]] Hash hasher;
+    [[no_unique_address]] Equal equal;
+
+    template<typename T>
+    static constexpr bool transparent = requires { typename T::is_transparent; };
+
+    template<typename K>
+    static constexpr bool lookup_with = std::is_convertible_v<const K &, const Key &> ||
+                                        (transparent<Hash> && transparent<Equal>);
+
+    // std::hash of integers is often the identity; spread it over all bits
+    // so both the group index and the 7 control bits vary
+    template<typename K>
+    [[nodiscard]] std::size_t hashOf(const K &key) const {
+        auto hash = static_cast<std::uint64_t>(this->hasher(key));
+        hash ^= hash >> 33;
+        hash *= 0xff51afd7ed558ccdULL;
+        hash ^= hash >> 33;
+        return static_cast<std::size_t>(hash);
+    }
+
+    static std::int8_t h2(const std::size_t hash) {
+        return static_cast<std::int8_t>(hash & 0x7F);
+    }
+
+    // Bitmasks over one group: bit i is set when control byte i qualifies.
+    static std::uint32_t matchByte(const std::int8_t *group, const std::int8_t byte) {
+#ifdef REPL_FLAT_HASH_MAP_SSE2
+        const auto bytes = _mm_loadu_si128(reinterpret_cast<const __m128i *>(group));
+        return static_cast<std::uint32_t>(_mm_movemask_epi8(_mm_cmpeq_epi8(bytes, _mm_set1_epi8(byte))));
+#else
+        std::uint32_t bits = 0;
+        for (std::size_t i = 0; i < GROUP_WIDTH; i++) {
+            bits |= static_cast<std::uint32_t>(group[i] == byte) << i;
+        }
+        return bits;
+#endif
+    }
+
+    // empty and deleted bytes are the negative ones
+    static std::uint32_t matchFree(const std::int8_t *group) {
+#ifdef REPL_FLAT_HASH_MAP_SSE2
+        const auto bytes = _mm_loadu_si128(reinterpret_cast<const __m128i *>(group));
+        return static_cast<std::uint32_t>(_mm_movemask_epi8(bytes));
+#else
+        std::uint32_t bits = 0;
+        for (std::size_t i = 0; i < GROUP_WIDTH; i++) {
+            bits |= static_cast<std::uint32_t>(group[i] < 0) << i;
+        }
+        return bits;
+#endif
+    }
+
+    [[nodiscard]] std::size_t groupMask() const {
+        return this->capacity / GROUP_WIDTH - 1;
+    }
+
+    template<typename K>
+    [[nodiscard]] std::size_t findIndex(const K &key, const std::size_t hash) const {
+        if (this->capacity == 0) {
+            return NOT_FOUND;
+        }
+        const auto mask = this->groupMask();
+        auto group = (hash >> 7) & mask;
+        for (std::size_t step = 1;; step++) {
+            const auto *bytes = this->ctrl.get() + group * GROUP_WIDTH;
+            for (auto bits = matchByte(bytes, h2(hash)); bits != 0; bits &= bits - 1) {
+                const auto index = group * GROUP_WIDTH + std::countr_zero(bits);
+                if (this->equal(this->slots[index].first, key)) {
+                    return index;
+                }
+            }
+            if (matchByte(bytes, EMPTY) != 0) {
+                return NOT_FOUND;
+            }
+            // triangular steps visit every group of a power-of-two table
+            group = (group + step) & mask;
+        }
+    }
+
+    [[nodiscard]] std::size_t findFree(const std::size_t hash) const {
+        const auto mask = this->groupMask();
+        auto group = (hash >> 7) & mask;
+        for (std::size_t step = 1;; step++) {
+            const auto *bytes = this->ctrl.get() + group * GROUP_WIDTH;
+            if (const auto bits = matchFree(bytes); bits != 0) {
+                return group * GROUP_WIDTH + std::countr_zero(bits);
+            }
+            group = (group + step) & mask;
+        }
+    }
+
+    static std::size_t capacityFor(const std::size_t entries) {
+        auto capacity = GROUP_WIDTH;
+        while (capacity - capacity / 8 < entries) {
+            capacity *= 2;
+        }
+        return capacity;
+    }
+
+    void rehash(const std::size_t new_capacity) {
+        auto old_ctrl = std::move(this->ctrl);
+        auto *old_slots = this->slots;
+        const auto old_capacity = this->capacity;
+
+        this->ctrl = std::make_unique<std::int8_t[]>(new_capacity);
+        std::fill_n(this->ctrl.get(), new_capacity, EMPTY);
+        this->slots = std::allocator<value_type>().allocate(new_capacity);
+        this->capacity = new_capacity;
+        this->growth_left = new_capacity - new_capacity / 8 - this->count;
+
+        for (std::size_t i = 0; i < old_capacity; i++) {
+            if (old_ctrl[i] < 0) {
+                continue;
+            }
+            const auto hash = this->hashOf(old_slots[i].first);
+            const auto index = this->findFree(hash);
+            this->ctrl[index] = h2(hash);
+            std::construct_at(this->slots + index, std::move(old_slots[i]));
+            std::destroy_at(old_slots + i);
+        }
+        if (old_slots != nullptr) {
+            std::allocator<value_type>().deallocate(old_slots, old_capacity);
+        }
+    }
+
+    void destroyAll() {
+        for (std::size_t i = 0; i < this->capacity; i++) {
+            if (this->ctrl[i] >= 0) {
+                std::destroy_at(this->slots + i);
+            }
+        }
+        if (this->slots != nullptr) {
+            std::allocator<value_type>().deallocate(this->slots, this->capacity);
+        }
+        this->ctrl.reset();
+        this->slots = nullptr;
+        this->capacity = this->count = this->growth_left = 0;
+    }
+
+    template<typename Map, typename Entry>
+    class Iterator {
+        friend class FlatHashMap;
+
+        Map *map{nullptr};
+        std::size_t index{0};
+
+        Iterator(Map *map, const std::size_t index) : map(map), index(index) {
+            this->skipFree();
+        }
+
+        void skipFree() {
+            while (this->index < this->map->capacity && this->map->ctrl[this->index] < 0) {
+                this->index++;
+            }
+        }
+
+    public:
+        using iterator_category = std::forward_iterator_tag;
+        using value_type = FlatHashMap::value_type;
+        using difference_type = std::ptrdiff_t;
+        using pointer = Entry *;
+        using reference = Entry &;
+
+        Iterator() = default;
+
+        // iterator -> const_iterator
+        template<typename OtherMap, typename OtherEntry>
+        Iterator(const Iterator<OtherMap, OtherEntry> &other) : map(other.map), index(other.index) {
+        }
+
+        reference operator*() const {
+            return this->map->slots[this->index];
+        }
+
+        pointer operator->() const {
+            return this->map->slots + this->index;
+        }
+
+        Iterator &operator++() {
+            this->index++;
+            this->skipFree();
+            return *this;
+        }
+
+        Iterator operator++(int) {
+            auto previous = *this;
+            ++*this;
+            return previous;
+        }
+
+        bool operator==(const Iterator &other) const {
+            return this->index == other.index;
+        }
+
+        template<typename, typename>
+        friend class Iterator;
+    };
+
+public:
+    using iterator = Iterator<FlatHashMap, value_type>;
+    using const_iterator = Iterator<const FlatHashMap, const value_type>;
+
+    FlatHashMap() = default;
+
+    FlatHashMap(std::initializer_list<value_type> entries) {
+        this->reserve(entries.size());
+        for (const auto &entry: entries) {
+            this->try_emplace(entry.first, entry.second);
+        }
+    }
+
+    FlatHashMap(const FlatHashMap &other) : hasher(other.hasher), equal(other.equal) {
+        this->reserve(other.count);
+        for (const auto &entry: other) {
+            this->try_emplace(entry.first, entry.second);
+        }
+    }
+
+    FlatHashMap(FlatHashMap &&other) noexcept {
+        this->swap(other);
+    }
+
+    FlatHashMap &operator=(FlatHashMap other) noexcept {
+        this->swap(other);
+        return *this;
+    }
+
+    ~FlatHashMap() {
+        this->destroyAll();
+    }
+
+    void swap(FlatHashMap &other) noexcept {
+        std::swap(this->ctrl, other.ctrl);
+        std::swap(this->slots, other.slots);
+        std::swap(this->capacity, other.capacity);
+        std::swap(this->count, other.count);
+        std::swap(this->growth_left, other.growth_left);
+        std::swap(this->hasher, other.hasher);
+        std::swap(this->equal, other.equal);
+    }
+
+    iterator begin() {
+        return iterator(this, 0);
+    }
+
+    iterator end() {
+        return iterator(this, this->capacity);
+    }
+
+    const_iterator begin() const {
+        return const_iterator(this, 0);
+    }
+
+    const_iterator end() const {
+        return const_iterator(this, this->capacity);
+    }
+
+    [[nodiscard]] std::size_t size() const {
+        return this->count;
+    }
+
+    [[nodiscard]] bool empty() const {
+        return this->count == 0;
+    }
+
+    [[nodiscard]] std::size_t bucket_count() const {
+        return this->capacity;
+    }
+
+    void clear() {
+        this->destroyAll();
+    }
+
+    // Makes room for `entries` without any further growth.
+    void reserve(const std::size_t entries) {
+        if (entries > this->count + this->growth_left) {
+            this->rehash(capacityFor(entries));
+        }
+    }
+
+    template<typename K> requires lookup_with<K>
+    iterator find(const K &key) {
+        const auto index = this->findIndex(key, this->hashOf(key));
+        return index == NOT_FOUND ? this->end() : iterator(this, index);
+    }
+
+    template<typename K> requires lookup_with<K>
+    const_iterator find(const K &key) const {
+        const auto index = this->findIndex(key, this->hashOf(key));
+        return index == NOT_FOUND ? this->end() : const_iterator(this, index);
+    }
+
+    iterator find(const Key &key) {
+        return this->find<Key>(key);
+    }
+
+    const_iterator find(const Key &key) const {
+        return this->find<Key>(key);
+    }
+
+    template<typename K> requires lookup_with<K>
+    [[nodiscard]] bool contains(const K &key) const {
+        return this->findIndex(key, this->hashOf(key)) != NOT_FOUND;
+    }
+
+    [[nodiscard]] bool contains(const Key &key) const {
+        return this->contains<Key>(key);
+    }
+
+    template<typename K> requires lookup_with<K>
+    Value &at(const K &key) {
+        const auto index = this->findIndex(key, this->hashOf(key));
+        if (index == NOT_FOUND) {
+            throw std::out_of_range("FlatHashMap::at");
+        }
+        return this->slots[index].second;
+    }
+
+    Value &at(const Key &key) {
+        return this->at<Key>(key);
+    }
+
+    // Inserts (key, Value(args...)) unless the key is present; like
+    // std::unordered_map, nothing is constructed when it is.
+    template<typename... Args>
+    std::pair<iterator, bool> try_emplace(const Key &key, Args &&... args) {
+        const auto hash = this->hashOf(key);
+        if (const auto index = this->findIndex(key, hash); index != NOT_FOUND) {
+            return {iterator(this, index), false};
+        }
+        if (this->growth_left == 0) {
+            // plenty of tombstones: rebuild in place rather than doubling
+            const auto grow = this->count * 16 > this->capacity * 7;
+            this->rehash(this->capacity == 0 ? GROUP_WIDTH : grow ? this->capacity * 2 : this->capacity);
+        }
+        const auto index = this->findFree(hash);
+        if (this->ctrl[index] == EMPTY) {
+            this->growth_left--;
+        }
+        this->ctrl[index] = h2(hash);
+        std::construct_at(this->slots + index, std::piecewise_construct, std::forward_as_tuple(key),
+                          std::forward_as_tuple(std::forward<Args>(args)...));
+        this->count++;
+        return {iterator(this, index), true};
+    }
+
+    template<typename V>
+    std::pair<iterator, bool> emplace(const Key &key, V &&value) {
+        return this->try_emplace(key, std::forward<V>(value));
+    }
+
+    std::pair<iterator, bool> insert(const value_type &entry) {
+        return this->try_emplace(entry.first, entry.second);
+    }
+
+    Value &operator[](const Key &key) {
+        return this->try_emplace(key).first->second;
+    }
+
+    std::size_t erase(const Key &key) {
+        const auto index = this->findIndex(key, this->hashOf(key));
+        if (index == NOT_FOUND) {
+            return 0;
+        }
+        std::destroy_at(this->slots + index);
+        this->count--;
+        // a group that still has an empty byte never let a probe continue
+        // past it, so the slot can become empty again; otherwise it must stay
+        // a tombstone to keep later keys reachable
+        const auto *group = this->ctrl.get() + index / GROUP_WIDTH * GROUP_WIDTH;
+        if (matchByte(group, EMPTY) != 0) {
+            this->ctrl[index] = EMPTY;
+            this->growth_left++;
+        } else {
+            this->ctrl[index] = DELETED;
+        }
+        return 1;
+    }
+
+    bool operator==(const FlatHashMap &other) const {
+        if (this->count != other.count) {
+            return false;
+        }
+        for (const auto &[key, value]: *this) {
+            const auto found = other.find(key);
+            if (found == other.end() || !(found->second == value)) {
+                return false;
+            }
+        }
+        return true;
+    }
+};
+
+#endif //FLAT_HASH_MAP_H
@@ -0,0 +1,132 @@
+//
+// Created by mizuk on 2025/3/23.
+//
+
+#ifndef HEAP_H
+#define HEAP_H
+#include <chrono>
+#include <cstddef>
+#include <cstdint>
+#include <string>
+#include <vector>
+
+#include "repl/flat_hash_map.h"
+#include "repl/pool.h"
+#include "repl/value.h"
+
+struct HeapStatistics {
+    std::size_t objects{0};
+    // bytes of objects allocated with new, not counting what they own
+    std::size_t bytes{0};
+    std::size_t collections{0};
+    std::size_t collected{0};
+    std::chrono::nanoseconds last_pause{0};
+    std::chrono::nanoseconds max_pause{0};
+    std::chrono::nanoseconds total_pause{0};
+};
+
+// What Object::trace() reports an object's references to. A node of a
+// persistent vector (see pvector.h) can be shared by several objects; enter()
+// lets its references be reported only by the first of them in a pass, since
+// the node holds each of them only once.
+class Tracer {
+    std::vector<Object *> &children;
+    FlatHashMap<const void *, bool> entered;
+
+public:
+    explicit Tracer(std::vector<Object *> &children) : children(children) {
+    }
+
+    void add(Object *object) {
+        this->children.push_back(object);
+    }
+
+    void add(const Value &value) {
+        if (auto *object = value.object()) {
+            this->children.push_back(object);
+        }
+    }
+
+    // false if `node` was entered before in this pass
+    bool enter(const void *node) {
+        return this->entered.try_emplace(node, true).second;
+    }
+};
+
+// Every live Object, so that reference cycles, which counting alone never
+// frees, can be found and collected.
+//
+// collect() is a precise mark-sweep over the objects' references. An object
+// is a root when something outside the heap refers to it: a global, the VM's
+// operand stack, or a Value held by C++ code. Those references are what is
+// left of its count after subtracting the references from other objects, so
+// no root has to be registered. Everything reachable from a root is marked;
+// what remains is garbage held up only by cycles, and is freed by clearing
+// its references.
+//
+// Objects allocated with new come from per-size-class slab pools, 16 bytes
+// apart, so arrays and maps never go through the general-purpose allocator;
+// so do the nodes of their persistent vectors, through allocate().
+//
+// A heap belongs to one thread, like the Values in it: objects are registered
+// with the heap of the thread that creates them and must be destroyed there,
+// which also keeps the pools' free lists free of locks.
+class Heap {
+    friend class Object;
+
+    std::vector<Object *> objects;
+    // pools[i] holds blocks of 16 * (i + 1) bytes
+    std::vector<SlabPool> pools;
+    HeapStatistics stats;
+    // maybeCollect() collects once this many objects are live
+    std::size_t threshold{MIN_THRESHOLD};
+
+    Heap();
+
+    // the pool for objects of `size` bytes, nullptr if too big for any
+    [[nodiscard]] SlabPool *poolFor(std::size_t size);
+
+    void add(Object *object);
+
+    void remove(Object *object);
+
+public:
+    static constexpr std::size_t MIN_THRESHOLD = 4096;
+
+    // larger objects are allocated with ::operator new; a full node of a
+    // persistent vector is 272 bytes
+    static constexpr std::size_t MAX_POOLED_SIZE = 512;
+
+    Heap(const Heap &) = delete;
+
+    Heap &operator=(const Heap &) = delete;
+
+    // The calling thread's heap.
+    static Heap &local();
+
+    // Raw memory from the calling thread's pools, for what objects own.
+    static void *allocate(std::size_t size);
+
+    static void deallocate(void *pointer, std::size_t size);
+
+    // Frees every object only reachable from reference cycles; returns how
+    // many there were. Also drops the pasts arrays and maps keep for clones
+    // that are gone (see clones.h).
+    std::size_t collect();
+
+    // Collects when the heap has doubled since the last collection. Called
+    // between statements, where nothing holds a raw Object pointer.
+    void maybeCollect();
+
+    [[nodiscard]] HeapStatistics statistics() const;
+
+    [[nodiscard]] const std::vector<SlabPool> &slabPools() const;
+
+    // one line, as printed by the prompt's `:gc`
+    [[nodiscard]] std::string describe() const;
+
+    // a line per pool in use, as printed by the prompt's `:pools`
+    [[nodiscard]] std::string describePools() const;
+};
+
+#endif //HEAP_H
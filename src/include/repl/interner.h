@@ -0,0 +1,89 @@
+//
+// Created by mizuk on 2025/3/8.
+//
+
+#ifndef INTERNER_H
+#define INTERNER_H
+#include <cstdint>
+#include <deque>
+#include <functional>
+#include <shared_mutex>
+#include <string>
+#include <string_view>
+#include <variant>
+
+#include "repl/flat_hash_map.h"
+
+// Process-wide symbol table. Every distinct name is stored once and given a
+// dense integer id; ids are never reused, so they can be compared and hashed
+// in place of the strings for the lifetime of the process.
+class Interner {
+    mutable std::shared_mutex mutex;
+    // deque keeps element addresses stable, so the views in `ids` stay valid
+    std::deque<std::string> names;
+    // looked up by any string_view, so interning a token copies nothing
+    FlatHashMap<std::string_view, std::uint32_t, StringHash, std::equal_to<> > ids;
+
+public:
+    Interner() = default;
+
+    Interner(const Interner &) = delete;
+
+    Interner &operator=(const Interner &) = delete;
+
+    static Interner &global();
+
+    std::uint32_t intern(std::string_view name);
+
+    [[nodiscard]] std::string_view name(std::uint32_t id) const;
+
+    [[nodiscard]] std::size_t size() const;
+};
+
+// A name interned in Interner::global(). Converts implicitly from strings so it
+// can be used wherever a std::string name was accepted before.
+class Atom {
+    std::uint32_t value{};
+
+    Atom() = default;
+
+public:
+    Atom(const std::string_view name) : value(Interner::global().intern(name)) {
+    }
+
+    Atom(const char *name) : Atom(std::string_view(name)) {
+    }
+
+    Atom(const std::string &name) : Atom(std::string_view(name)) {
+    }
+
+    static Atom fromId(const std::uint32_t id) {
+        Atom atom;
+        atom.value = id;
+        return atom;
+    }
+
+    [[nodiscard]] std::uint32_t id() const {
+        return this->value;
+    }
+
+    [[nodiscard]] std::string_view str() const {
+        return Interner::global().name(this->value);
+    }
+
+    bool operator==(const Atom &other) const = default;
+
+    auto operator<=>(const Atom &other) const = default;
+};
+
+// One step of an access path: an array index or a map key.
+using Identifier = std::variant<int, Atom>;
+
+template<>
+struct std::hash<Atom> {
+    std::size_t operator()(const Atom &atom) const noexcept {
+        return atom.id();
+    }
+};
+
+#endif //INTERNER_H
@@ -5,28 +5,26 @@
 #ifndef INTERPRETER_H
 #define INTERPRETER_H
 
-#include <map>
+#include <cstdint>
+#include <functional>
+#include <optional>
+#include <string>
+#include <string_view>
+#include <vector>
 
 #include "visitor.h"
-
-class Globals {
-    std::map<std::string, std::shared_ptr<Object> > map = {};
-
-public:
-    Globals() = default;
-
-    ~Globals() = default;
-
-    void global_set(const std::string &key, const std::shared_ptr<Object> &value);
-
-    [[nodiscard]] bool exists(const std::string &key) const;
-
-    [[nodiscard]] std::shared_ptr<Object> global_get(const std::string &key) const;
-};
+#include "bytecode.h"
+#include "flat_ast.h"
+#include "flat_hash_map.h"
+#include "value.h"
+#include "versions.h"
 
 enum class InterpretErrorType {
     UNDEFINED_VARIABLE,
     DUPLICATE_VARIABLES_DEFINED,
+    UNKNOWN_FUNCTION,
+    // wrong number or kind of arguments to a builtin
+    INVALID_ARGUMENTS,
 };
 
 class InterpreterError final : public std::runtime_error {
@@ -39,68 +37,185 @@ public:
     }
 };
 
+// Global variables, stored densely by slot. The compiler resolves each name
+// to its slot once, so running code indexes a vector and never hashes a
+// name; the directory is only consulted when compiling and by the by-name
+// accessors used by the tree walk and for introspection.
+class Globals {
+    FlatHashMap<Atom, std::uint32_t> directory;
+    // slot -> name
+    std::vector<Atom> names;
+    // an empty Value marks a slot that has been resolved but not declared yet
+    std::vector<Value> slots;
+    // slots set since the last take_changed(), each once
+    std::vector<std::uint32_t> changed;
+    std::vector<bool> is_changed;
+    // literals the compiler hoisted, by the key it built from their contents
+    FlatHashMap<std::string, std::uint32_t, StringHash, std::equal_to<> > constant_index;
+    std::vector<Value> constants;
+
+public:
+    // the table stops taking constants once it holds this many
+    static constexpr std::size_t MAX_CONSTANTS = 4096;
+
+    Globals() = default;
+
+    ~Globals() = default;
+
+    // Returns the slot for `name`, allocating an undeclared one on first use.
+    std::uint32_t resolve(Atom name);
+
+    [[nodiscard]] Atom name(std::uint32_t slot) const;
+
+    // number of slots handed out, declared or not
+    [[nodiscard]] std::size_t slot_count() const;
+
+    [[nodiscard]] bool defined(const std::uint32_t slot) const {
+        return static_cast<bool>(this->slots[slot]);
+    }
+
+    [[nodiscard]] const Value &get(const std::uint32_t slot) const {
+        const auto &value = this->slots[slot];
+        if (!value) {
+            throw InterpreterError(InterpretErrorType::UNDEFINED_VARIABLE);
+        }
+        return value;
+    }
+
+    void set(const std::uint32_t slot, const Value &value) {
+        if (const auto *old = this->slots[slot].object(); old != nullptr && old->committed()) {
+            Versions::unslot(*old, slot);
+        }
+        this->slots[slot] = value;
+        if (!this->is_changed[slot]) {
+            this->is_changed[slot] = true;
+            this->changed.push_back(slot);
+        }
+    }
+
+    // the slots set since the last call, for Versions::commit
+    std::vector<std::uint32_t> take_changed();
+
+    void global_set(Atom key, const Value &value);
+
+    // Constant literals, shared by every chunk compiled against this table:
+    // each is an Array or Map holding only numbers and nil, is never stored
+    // into, and is handed out as copy-on-write copies.
+    [[nodiscard]] std::optional<std::uint32_t> find_constant(std::string_view key) const;
+
+    // nullopt once MAX_CONSTANTS are held
+    std::optional<std::uint32_t> add_constant(std::string key, Value constant);
+
+    [[nodiscard]] const Value &constant(const std::uint32_t index) const {
+        return this->constants[index];
+    }
+
+    [[nodiscard]] std::size_t constant_count() const;
+
+    [[nodiscard]] bool exists(Atom key) const;
+
+    [[nodiscard]] Value global_get(Atom key) const;
+};
+
 class Interpreter final : public Visitor {
     std::unique_ptr<Globals> globals = std::make_unique<Globals>();
 
-    std::tuple<std::shared_ptr<Object>, std::shared_ptr<Object> > last_accessor_pair;
+    std::tuple<Value, Value> last_accessor_pair;
+
+    // operand stack of run(), kept between chunks so its capacity is reused
+    std::vector<Value> stack;
 
-    void global_set(const std::string &key, std::shared_ptr<Object> &value) const;
+    // what commit() has published, for readers on other threads
+    Versions committed;
 
-    [[nodiscard]] bool exists(const std::string &key) const;
+    // where print sends its lines; stdout when empty
+    std::function<void(std::string_view)> output;
 
-    [[nodiscard]] std::shared_ptr<Object> global_get(const std::string &key) const;
+    void global_set(Atom key, Value &value) const;
 
-    [[nodiscard]] static std::shared_ptr<Object> callNothing();
+    [[nodiscard]] bool exists(Atom key) const;
+
+    [[nodiscard]] Value global_get(Atom key) const;
+
+    [[nodiscard]] static Value callNothing();
 
 public:
     Interpreter() = default;
 
-    std::shared_ptr<Object> visit(const Expr &expr) override;
+    // The table chunks for this interpreter must be compiled against.
+    [[nodiscard]] Globals &global_scope() const;
+
+    // Runs bytecode compiled against global_scope() (see vm.cpp). This is the fast path; the visit
+    // overloads below remain for evaluating hand-built trees.
+    Value run(const Chunk &chunk);
+
+    // Publishes the globals as they are now as the latest version readers can
+    // pin, and returns its epoch. Call between statements, on this thread.
+    std::uint64_t commit();
+
+    // The committed versions, which any thread may pin().
+    [[nodiscard]] Versions &versions();
+
+    // Sends each line print prints, without its '\n', to `sink` instead of
+    // stdout; an empty one sends them back to stdout.
+    void set_output(std::function<void(std::string_view)> sink);
+
+    // What print does with `value`.
+    void print(const Value &value) const;
+
+    // Compiles a flat tree and runs it.
+    Value execute(const FlatAst &ast);
+
+    // Compiles one node of a flat tree, e.g. a single statement of a PROGRAM,
+    // and runs it.
+    Value execute(const FlatAst &ast, NodeIndex node);
+
+    Value visit(const Expr &expr) override;
 
     // Evaluate a NumberLiteral
-    std::shared_ptr<Object> visit(const NumberLiteral &numberLiteral) override;
+    Value visit(const NumberLiteral &numberLiteral) override;
 
     // Evaluate a NilLiteral
-    std::shared_ptr<Object> visit(const NilLiteral &nilLiteral) override;
+    Value visit(const NilLiteral &nilLiteral) override;
 
     // Lookup a Variable's value
-    std::shared_ptr<Object> visit(const Variable &variable) override;
+    Value visit(const Variable &variable) override;
 
     // Evaluate a Symbol
-    std::shared_ptr<Object> visit(const Symbol &symbol) override;
+    Value visit(const Symbol &symbol) override;
 
     // Evaluate an assignment operation
-    std::shared_ptr<Object> visit(const Assignment &assignment) override;
+    Value visit(const Assignment &assignment) override;
 
     // Evaluate a declaration operation
-    std::shared_ptr<Object> visit(const Declaration &declaration) override;
+    Value visit(const Declaration &declaration) override;
 
     // Evaluate an array definition
-    std::shared_ptr<Object> visit(const ArrayDefinition &arrayDefinition) override;
+    Value visit(const ArrayDefinition &arrayDefinition) override;
 
     // Evaluate an entry in a map definition
-    std::shared_ptr<Object> visit(const EntryDefinition &entryDefinition) override;
+    Value visit(const EntryDefinition &entryDefinition) override;
 
     // Evaluate a map definition
-    std::shared_ptr<Object> visit(const MapDefinition &mapDefinition) override;
-
-    // Evaluate an accessor expression
-    std::shared_ptr<Object> visit(const AccessorExpr &accessor_expr) override;
+    Value visit(const MapDefinition &mapDefinition) override;
 
-    // Evaluate an getter expression
-    std::shared_ptr<Object> visit(const GetterExpr &getter_expr) override;
+    // Read an access path, or store into its last step
+    Value visit(const AccessPath &access_path) override;
 
-    // Evaluate an getter expression
-    std::shared_ptr<Object> visit(const SetterExpr &setter_expr) override;
+    // Call a builtin
+    Value visit(const Call &call) override;
 
     // Evaluate a print statement
-    std::shared_ptr<Object> visit(const PrintStatement &printStatement) override;
+    Value visit(const PrintStatement &printStatement) override;
 
     // Evaluate an empty statement
-    std::shared_ptr<Object> visit(const EmptyStatement &emptyStatement) override;
+    Value visit(const EmptyStatement &emptyStatement) override;
+
+    // Evaluate each statement in order; yields the last statement's value
+    Value visit(const Program &program) override;
 
     // Evaluate a self-reference (if applicable)
-    std::shared_ptr<Object> visit(const Self &selfNode) override;
+    Value visit(const Self &selfNode) override;
 };
 
 #endif //INTERPRETER_H
@@ -0,0 +1,28 @@
+//
+// Created by mizuk on 2025/3/22.
+//
+
+#ifndef KERNELS_H
+#define KERNELS_H
+#include <cstddef>
+#include <cstdint>
+#include <span>
+
+// Bulk operations over a packed array's numbers, a vector register at a time
+// (AVX2 or SSE2, whichever the build targets) with a scalar tail.
+namespace kernels {
+    // widened, so it cannot overflow for any array that fits in memory
+    std::int64_t sum(std::span<const std::int32_t> numbers);
+
+    // `numbers` must not be empty
+    std::int32_t min(std::span<const std::int32_t> numbers);
+
+    std::int32_t max(std::span<const std::int32_t> numbers);
+
+    // index of the first element equal to `number`, or numbers.size()
+    std::size_t find(std::span<const std::int32_t> numbers, std::int32_t number);
+
+    void fill(std::span<std::int32_t> numbers, std::int32_t number);
+}
+
+#endif //KERNELS_H
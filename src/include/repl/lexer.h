@@ -5,25 +5,52 @@
 #ifndef LEXER_H
 #define LEXER_H
 #include <string>
+#include <string_view>
 #include <utility>
+#include <vector>
 
-struct Token;
+#include "repl/token.h"
 
+// The lexer never copies its input: identifiers are scanned in place and
+// interned straight from the buffer, which is either owned by the Lexer or
+// borrowed from the caller.
 class Lexer {
-    std::string text;
+    std::string storage;
+    std::string_view text;
     int pos{-1};
 
 public:
+    // Owning mode: the lexer keeps the input alive itself.
     explicit Lexer(std::string text)
-        : text(std::move(text)) {
+        : storage(std::move(text)), text(this->storage) {
     }
 
+    // Borrowing mode: lexes straight out of a buffer owned by the caller.
+    explicit Lexer(const std::string_view text)
+        : text(text) {
+    }
+
+    explicit Lexer(const char *text)
+        : Lexer(std::string(text)) {
+    }
+
+    // tokens point into `storage`, which must not move underneath them
+    Lexer(const Lexer &) = delete;
+
+    Lexer &operator=(const Lexer &) = delete;
+
     ~Lexer() = default;
 
     Token nextToken();
 
     Token peekToken();
 
+    [[nodiscard]] std::string_view source() const;
+
+    // Lexes the whole remaining input into one contiguous array terminated by
+    // an EOF_ token, so a parser can look ahead any distance by indexing.
+    std::vector<Token> tokenize();
+
 private:
     void advance();
 
@@ -0,0 +1,39 @@
+//
+// Created by mizuk on 2025/3/9.
+//
+
+#ifndef MAPPED_FILE_H
+#define MAPPED_FILE_H
+#include <cstddef>
+#include <string>
+#include <string_view>
+
+// Read-only memory mapping of a whole file. The contents are exposed as a
+// string_view so a Lexer can borrow them without copying into a std::string.
+class MappedFile {
+    const char *data{nullptr};
+    std::size_t size{0};
+    // bytes before this offset have already been handed back to the kernel
+    std::size_t released{0};
+#ifdef _WIN32
+    void *file_handle{nullptr};
+    void *mapping_handle{nullptr};
+#endif
+
+public:
+    explicit MappedFile(const std::string &path);
+
+    MappedFile(const MappedFile &) = delete;
+
+    MappedFile &operator=(const MappedFile &) = delete;
+
+    ~MappedFile();
+
+    [[nodiscard]] std::string_view contents() const;
+
+    // Tells the OS that everything before `offset` will not be read again, so
+    // a sequential pass over a huge file keeps a bounded resident set.
+    void release(std::size_t offset);
+};
+
+#endif //MAPPED_FILE_H
@@ -4,111 +4,261 @@
 
 #ifndef OBJECT_H
 #define OBJECT_H
-#include <map>
+#include <cstdint>
+#include <functional>
 #include <memory>
+#include <span>
 #include <utility>
 #include <variant>
 #include <vector>
 #include <fmt/format.h>
 
-using Identifier = std::variant<int, std::string>;
+#include "repl/clones.h"
+#include "repl/interner.h"
+#include "repl/pvector.h"
+#include "repl/shape.h"
+#include "repl/value.h"
+#include "repl/versions.h"
 
-class Object {
-public:
-    virtual ~Object() = 0;
+// An array whose elements are all numbers keeps them packed, four bytes
+// each, where the bulk builtins can scan them with vector instructions. The
+// first store of anything else converts it to the generic form for good.
+//
+// Either way the elements live in a persistent vector, so a copy of an array,
+// be it clone(x) or a copy of a hoisted constant literal (see
+// Globals::add_constant), is O(1) and shares them until one side stores. A
+// clone copies the arrays and maps among them as it reaches them (see
+// clones.h).
+class Array final : public Object {
+    // the storage as of an instant a clone may look back to
+    struct Past {
+        std::uint64_t instant;
+        bool is_packed;
+        PVector<std::int32_t, 6, std::identity> numbers;
+        PVector<Value, 5, std::identity> elements;
+    };
 
-    virtual std::string toString() = 0;
+    bool is_packed{true};
+    PVector<std::int32_t, 6, std::identity> numbers;
+    PVector<Value, 5, std::identity> elements;
+    // the instant of the latest past, or the one this array was made at
+    std::uint64_t stamp{Clones::now()};
+    std::unique_ptr<CloneState<Past> > cloning;
 
-    virtual std::shared_ptr<Object> _get_item(const Identifier &identifier) = 0;
+    void unpack();
 
-    virtual std::shared_ptr<Object> _set_item(const Identifier &identifier, std::shared_ptr<Object> &value) = 0;
+    // keeps the storage as of now, before a store
+    void remember();
 
-    [[nodiscard]] virtual Identifier identifier() const = 0;
-};
+    // Copies the arrays and maps in the leaf holding `index` that this
+    // clone has yet to, or in every leaf; no-ops unless this is a clone.
+    void own(std::size_t index);
 
-class Nil final : public Object {
-public:
-    ~Nil() override = default;
+    void ownAll();
 
-    std::string toString() override;
+    // The element at `index` as this clone sees it, without copying it in,
+    // for printing.
+    [[nodiscard]] Value shown(std::size_t index) const;
+
+public:
+    // Moves the elements out of `elements`, packing them when every one of
+    // them is a number.
+    explicit Array(std::span<Value> elements);
 
-    std::shared_ptr<Object> _get_item(const Identifier &identifier) override;
+    explicit Array(std::vector<Value> elements) : Array(std::span<Value>(elements)) {
+    }
 
-    std::shared_ptr<Object> _set_item(const Identifier &identifier, std::shared_ptr<Object> &value) override;
+    explicit Array(const std::vector<std::int32_t> &numbers);
 
-    [[nodiscard]] Identifier identifier() const override;
-};
+    // shares `other`'s elements
+    Array(const Array &other);
 
-class Number final : public Object {
-public:
-    int num;
+    ~Array() override;
 
-    explicit Number(const int num): num(num) {
+    [[nodiscard]] bool packed() const {
+        return this->is_packed;
     }
 
-    ~Number() override = default;
+    // f(std::span<const std::int32_t>) for each run of the elements, in
+    // order, while packed()
+    template<typename F>
+    void forEachPackedChunk(F f) const {
+        this->numbers.forEachLeaf(f);
+    }
 
-    std::string toString() override;
+    // f(std::span<const Value>) likewise, while not packed()
+    template<typename F>
+    void forEachElementChunk(F f) {
+        this->ownAll();
+        this->elements.forEachLeaf(f);
+    }
 
-    std::shared_ptr<Object> _get_item(const Identifier &identifier) override;
+    [[nodiscard]] std::size_t size() const {
+        return this->is_packed ? this->numbers.size() : this->elements.size();
+    }
 
-    std::shared_ptr<Object> _set_item(const Identifier &identifier, std::shared_ptr<Object> &value) override;
+    // The element at `index` as stored: in a clone, an array or map not
+    // copied yet is still the original's (see navigate()).
+    [[nodiscard]] Value get(const std::size_t index) const {
+        return this->is_packed ? Value::number(this->numbers[index]) : this->elements[index];
+    }
 
-    [[nodiscard]] Identifier identifier() const override;
-};
+    // the element at `index` while not packed(), without taking a reference
+    [[nodiscard]] const Value &element(const std::size_t index) const {
+        return this->elements[index];
+    }
 
-class Array final : public Object {
-public:
-    std::vector<std::shared_ptr<Object> > elements;
+    // The element at `index`, for an access path to go on through, copied
+    // first if this is a clone that has yet to.
+    [[nodiscard]] Value navigate(const std::size_t index) {
+        if (this->cloning != nullptr && !this->is_packed) [[unlikely]] {
+            this->own(index);
+        }
+        return this->get(index);
+    }
 
-    explicit Array(std::vector<std::shared_ptr<Object> > &elements) : elements(std::move(elements)) {
+    // true while a copy shares the elements
+    [[nodiscard]] bool sharesStorage() const {
+        return this->numbers.shared() || this->elements.shared();
     }
 
-    ~Array() override = default;
+    void set(std::size_t index, const Value &value);
+
+    // sets every element to `value`
+    void fill(const Value &value);
+
+    void trace(Tracer &tracer) const override;
+
+    void clear() override;
+
+    [[nodiscard]] Object *freeze(Freezer &freezer) const override;
 
+    [[nodiscard]] Object *cloneAt(std::uint64_t instant, const std::shared_ptr<CloneFamily> &family) const override;
+
+    void trimPasts(std::vector<std::shared_ptr<void> > &dropped) override;
 
     std::string toString() override;
 
-    std::shared_ptr<Object> _get_item(const Identifier &identifier) override;
+    Value _get_item(const Identifier &identifier) override;
 
-    std::shared_ptr<Object> _set_item(const Identifier &identifier, std::shared_ptr<Object> &value) override;
+    Value _set_item(const Identifier &identifier, Value &value) override;
 
     [[nodiscard]] Identifier identifier() const override;
 };
 
+// A map stores only its values; which key sits at which offset is recorded
+// once in its shared Shape, or, past Shape::MAX_SHARED_KEYS keys, in a
+// dictionary shape it and its copies hold. Like an Array's, the values are a
+// persistent vector, shared by a copy until one side stores.
 class Map final : public Object {
+    // the values as of an instant a clone may look back to
+    struct Past {
+        std::uint64_t instant;
+        PVector<Value, 5, std::identity> values;
+    };
+
+    // one per key of `shape`, by offset
+    PVector<Value, 5, std::identity> values;
+    // as Array's
+    std::uint64_t stamp{Clones::now()};
+    std::unique_ptr<CloneState<Past> > cloning;
+
+    // as Array's
+    void remember();
+
+    void own(std::uint32_t offset);
+
+    void ownAll();
+
+    [[nodiscard]] Value shown(std::uint32_t offset) const;
+
 public:
-    std::map<std::string, std::shared_ptr<Object> > map;
+    const Shape *shape;
+
+    // moves the values out of `values`
+    Map(const Shape *shape, std::span<Value> values);
+
+    Map(const Shape *shape, std::vector<Value> values) : Map(shape, std::span<Value>(values)) {
+    }
+
+    // shares `other`'s values
+    Map(const Map &other);
+
+    Map &operator=(const Map &) = delete;
+
+    [[nodiscard]] std::size_t size() const {
+        return this->shape->size();
+    }
+
+    // the value at `offset` as stored, as Array::get()
+    [[nodiscard]] const Value &value(const std::uint32_t offset) const {
+        return this->values[offset];
+    }
+
+    // the value at `offset` for an access path, as Array::navigate()
+    [[nodiscard]] Value navigate(const std::uint32_t offset) {
+        if (this->cloning != nullptr) [[unlikely]] {
+            this->own(offset);
+        }
+        return this->values[offset];
+    }
+
+    void setValue(const std::uint32_t offset, const Value &value) {
+        if (this->link != nullptr) {
+            Versions::storing(*this, offset, this->values[offset]);
+        }
+        if (this->stamp < Clones::horizon()) [[unlikely]] {
+            this->remember();
+        }
+        if (this->cloning != nullptr) [[unlikely]] {
+            this->own(offset);
+        }
+        this->values.unique(offset) = value;
+    }
 
-    explicit Map(std::map<std::string, std::shared_ptr<Object> > elements) : map(std::move(elements)) {
+    [[nodiscard]] bool sharesStorage() const {
+        return this->values.shared();
     }
 
-    ~Map() override = default;
+    [[nodiscard]] const Shape *shapeOf() const override {
+        return this->shape;
+    }
+
+    ~Map() override;
+
+    void trace(Tracer &tracer) const override;
+
+    void clear() override;
+
+    [[nodiscard]] Object *freeze(Freezer &freezer) const override;
+
+    [[nodiscard]] Object *cloneAt(std::uint64_t instant, const std::shared_ptr<CloneFamily> &family) const override;
 
+    void trimPasts(std::vector<std::shared_ptr<void> > &dropped) override;
 
     std::string toString() override;
 
-    std::shared_ptr<Object> _get_item(const Identifier &identifier) override;
+    Value _get_item(const Identifier &identifier) override;
 
-    std::shared_ptr<Object> _set_item(const Identifier &identifier, std::shared_ptr<Object> &value) override;
+    Value _set_item(const Identifier &identifier, Value &value) override;
 
     [[nodiscard]] Identifier identifier() const override;
 };
 
 class Property final : public Object {
-    std::string name;
+    Atom name;
 
 public:
-    explicit Property(std::string name) : name(std::move(name)) {
+    explicit Property(const Atom name) : name(name) {
     }
 
     ~Property() override = default;
 
     std::string toString() override;
 
-    std::shared_ptr<Object> _get_item(const Identifier &identifier) override;
+    Value _get_item(const Identifier &identifier) override;
 
-    std::shared_ptr<Object> _set_item(const Identifier &identifier, std::shared_ptr<Object> &value) override;
+    Value _set_item(const Identifier &identifier, Value &value) override;
 
     [[nodiscard]] Identifier identifier() const override;
 };
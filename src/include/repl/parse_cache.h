@@ -0,0 +1,110 @@
+//
+// Created by mizuk on 2025/3/14.
+//
+
+#ifndef PARSE_CACHE_H
+#define PARSE_CACHE_H
+#include <cstddef>
+#include <cstdint>
+#include <list>
+#include <memory>
+#include <string>
+#include <string_view>
+#include <unordered_map>
+#include <vector>
+
+#include "repl/arena.h"
+#include "repl/bytecode.h"
+#include "repl/flat_ast.h"
+#include "repl/parser.h"
+
+// What the front end makes of one line of input. Immutable once cached, so it
+// can be shared between cache entries and outlive its own eviction.
+struct ParsedProgram {
+    FlatAst ast;
+    std::vector<Diagnostic> diagnostics;
+    // one per statement of `ast`; empty when there are diagnostics
+    std::vector<Chunk> chunks;
+};
+
+// LRU cache from statement text to its parsed and compiled program. A hit
+// skips lexing, parsing and compiling entirely. Programs that parse cleanly
+// are also pooled by structure, so texts that differ only in spacing share a
+// single FlatAst and its bytecode.
+class ParseCache {
+    struct Entry {
+        std::string text;
+        std::shared_ptr<const ParsedProgram> program;
+    };
+
+    // the table chunks are compiled against
+    Globals &globals;
+    std::size_t max_entries;
+    // most recently used at the front
+    std::list<Entry> entries;
+    // keys view the text owned by the list node, which never moves
+    std::unordered_map<std::string_view, std::list<Entry>::iterator> index;
+    // structural hash -> programs that may be shared; pruned as they expire
+    std::unordered_multimap<std::uint64_t, std::weak_ptr<const ParsedProgram> > pool;
+    AstArena arena;
+
+    std::size_t hit_count{0};
+    std::size_t miss_count{0};
+    std::size_t shared_count{0};
+
+    // Returns an equal pooled program, or compiles and pools `program`.
+    std::shared_ptr<const ParsedProgram> intern(std::shared_ptr<ParsedProgram> program);
+
+    void evict();
+
+public:
+    static constexpr std::size_t DEFAULT_CAPACITY = 4096;
+
+    // Compiles for `globals` (an Interpreter's global_scope()). A capacity of
+    // 0 disables caching: every lookup parses afresh.
+    explicit ParseCache(Globals &globals, std::size_t capacity = DEFAULT_CAPACITY);
+
+    ParseCache(const ParseCache &) = delete;
+
+    ParseCache &operator=(const ParseCache &) = delete;
+
+    // Returns the cached program for `text`, parsing it on a miss.
+    std::shared_ptr<const ParsedProgram> get(std::string_view text);
+
+    // The same, but a miss takes `parsed`, parse() of the same text, if it is
+    // given, and only compiles it.
+    std::shared_ptr<const ParsedProgram> get(std::string_view text, std::shared_ptr<ParsedProgram> parsed);
+
+    // Lexes and parses `text` without compiling it. Needs no interpreter, so
+    // it can run on a thread of its own, ahead of the one calling get().
+    static std::shared_ptr<ParsedProgram> parse(std::string_view text, AstArena &arena);
+
+    [[nodiscard]] std::size_t capacity() const;
+
+    [[nodiscard]] std::size_t size() const;
+
+    [[nodiscard]] std::size_t hits() const;
+
+    [[nodiscard]] std::size_t misses() const;
+
+    // misses whose program turned out equal to one already cached
+    [[nodiscard]] std::size_t shared() const;
+};
+
+// Which texts a ParseCache of the same capacity holds after the same lookups,
+// without the programs. A thread parsing ahead of the cache's owner asks it
+// which texts will miss, so that it parses only those.
+class ParseCacheShadow {
+    std::size_t max_entries;
+    // most recently used at the front
+    std::list<std::string> entries;
+    std::unordered_map<std::string_view, std::list<std::string>::iterator> index;
+
+public:
+    explicit ParseCacheShadow(std::size_t capacity = ParseCache::DEFAULT_CAPACITY);
+
+    // Records a lookup of `text`; whether the cache will already hold it.
+    bool lookup(std::string_view text);
+};
+
+#endif //PARSE_CACHE_H
@@ -5,32 +5,87 @@
 #ifndef PARSER_H
 #define PARSER_H
 #include <memory>
+#include <string>
+#include <vector>
 
 #include <stdexcept>
 #include "repl/token.h"
 #include "repl/lexer.h"
 #include "repl/ast.h"
+#include "repl/arena.h"
+#include "repl/flat_ast.h"
+
+enum class ParseErrorType {
+    EXPECT_EXPR_BUT_INDEED_ASSIGN,
+    UNKNOWN_LITERAL,
+    UNKNOWN_RHS,
+    UNKNOWN_DEFINITION,
+    UNEXPECTED_TOKEN,
+    INVALID_TOKEN,
+};
+
+class ParserError final : public std::runtime_error {
+public:
+    ParseErrorType error_type;
+
+    explicit ParserError(const ParseErrorType &type): std::runtime_error("ParseError!"), error_type(type) {
+    }
+};
+
+// A parse error reported instead of thrown, with a 1-based source position.
+struct Diagnostic {
+    std::size_t line;
+    std::size_t column;
+    ParseErrorType type;
+    std::string message;
+};
 
 class Parser {
     std::unique_ptr<Lexer> lexer;
-    Token current_token;
+    // the whole input, tokenized up front; always terminated by EOF_
+    std::vector<Token> tokens;
+    std::size_t cursor{0};
+    // where parse() allocates nodes; nullptr means the heap
+    AstArena *arena{nullptr};
     std::variant<std::unique_ptr<Expr>, std::monostate> prev_lhs;
 
+    // Program mode reports errors as diagnostics instead of throwing. The first
+    // error marks the statement as failed; every rule then unwinds by returning
+    // nullptr until parse_program() resynchronizes at the next separator.
+    bool recovering{false};
+    bool failed{false};
+    std::vector<Diagnostic> reported;
+    // diagnostics arrive in source order, so positions are found incrementally
+    std::size_t scanned_offset{0};
+    std::size_t scanned_line{1};
+    std::size_t scanned_line_start{0};
+
 public:
     explicit Parser(std::unique_ptr<Lexer> &lexer)
-        : lexer(std::move(lexer)), current_token(Token(TokenType::EOF_)), prev_lhs(std::monostate()) {
+        : lexer(std::move(lexer)), tokens{Token(TokenType::EOF_)}, prev_lhs(std::monostate()) {
+    }
+
+    // Parses into `arena`. The returned tree must be destroyed before the
+    // arena is reset.
+    Parser(std::unique_ptr<Lexer> &lexer, AstArena &arena)
+        : lexer(std::move(lexer)), tokens{Token(TokenType::EOF_)}, arena(&arena), prev_lhs(std::monostate()) {
     }
 
     ~Parser() = default;
 
     void consume(TokenType type);
 
-    [[nodiscard]] Token peek() const;
+    [[nodiscard]] const Token &current() const;
+
+    // O(1) lookahead of any depth; past the end it keeps returning EOF_.
+    [[nodiscard]] const Token &peek(std::size_t distance = 1) const;
 
     /*
+     *program : (expr? (NEWLINE | SEMICOLON))* expr? EOF
+     *
      *expr : declaration | assign_expr | rhs ;
      *
-     *rhs : accessor_expr | definition | literal ;
+     *rhs : call | accessor_expr | definition | literal ;
      *
      *declaration : DOLLAR variable EQ rhs SEMICOLON
      *
@@ -46,11 +101,9 @@ public:
      *
      *item_definition : rhs COMMA
      *
-     *accessor_expr : property_accessor_expr | index_accessor_expr | variable
-     *
-     *property_accessor_expr : accessor_expr DOT symbol
+     *call : IDENTIFIER LEFT_PAREN (rhs (COMMA rhs)* COMMA?)? RIGHT_PAREN
      *
-     *index_accessor_expr : accessor_expr LEFT_SQUARE (variable | number) RIGHT_SQUARE
+     *accessor_expr : variable (DOT symbol | LEFT_SQUARE number RIGHT_SQUARE)* (EQ rhs)?
      *
      *print_stmt : PRINT rhs ;
      *
@@ -67,6 +120,19 @@ public:
      */
     std::unique_ptr<Expr> parse();
 
+    // Parses every statement of the input. Never throws on bad input: each
+    // malformed statement adds one entry to diagnostics() and is left out.
+    std::unique_ptr<Program> parse_program();
+
+    [[nodiscard]] const std::vector<Diagnostic> &diagnostics() const;
+
+    // Same grammar, emitted as a FlatAst. The intermediate tree is built in the
+    // parser's arena (or a scratch one) and released before returning.
+    FlatAst parse_flat();
+
+    // parse_program(), emitted as a FlatAst with a PROGRAM root.
+    FlatAst parse_program_flat();
+
     std::unique_ptr<Expr> expr();
 
     std::unique_ptr<Declaration> declaration();
@@ -81,8 +147,12 @@ public:
 
     std::unique_ptr<ArrayDefinition> array_definition();
 
+    // Collects every step of the path into one AccessPath; a bare variable
+    // stays a Variable (or an Assignment when followed by `=`).
     std::unique_ptr<Expr> accessor_expr();
 
+    std::unique_ptr<Call> call();
+
     std::unique_ptr<PrintStatement> print_stmt();
 
     std::unique_ptr<Expr> rhs();
@@ -98,21 +168,18 @@ public:
     std::unique_ptr<Symbol> symbol();
 
     std::unique_ptr<EmptyStatement> empty_stmt();
-};
 
-enum class ParseErrorType {
-    EXPECT_EXPR_BUT_INDEED_ASSIGN,
-    UNKNOWN_LITERAL,
-    UNKNOWN_RHS,
-    UNKNOWN_DEFINITION,
-};
+private:
+    // Throws outside program mode; otherwise records "expected <expected> but
+    // found <token>" once per statement.
+    void fail(ParseErrorType type, const Token &token, std::string_view expected);
 
-class ParserError final : public std::runtime_error {
-public:
-    ParseErrorType error_type;
+    void synchronize();
 
-    explicit ParserError(const ParseErrorType &type): std::runtime_error("ParseError!"), error_type(type) {
-    }
+    [[nodiscard]] bool atSeparator() const;
+
+    template<typename Parse>
+    FlatAst lowered(Parse parse);
 };
 
 #endif //PARSER_H
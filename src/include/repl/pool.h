@@ -0,0 +1,71 @@
+//
+// Created by mizuk on 2025/3/24.
+//
+
+#ifndef POOL_H
+#define POOL_H
+#include <cstddef>
+#include <memory>
+#include <vector>
+
+// Fixed-size blocks carved out of 16 KiB slabs. Freed blocks go on an
+// intrusive free list and are handed out again last-in first-out, so a
+// statement that builds and drops objects keeps reusing the same, cache-warm
+// memory. Slabs are kept until the pool is destroyed.
+class SlabPool {
+    struct FreeBlock {
+        FreeBlock *next;
+    };
+
+    std::size_t block_bytes;
+    FreeBlock *free_list{nullptr};
+    std::vector<std::unique_ptr<std::byte[]> > slabs;
+    std::size_t in_use{0};
+
+    void grow();
+
+public:
+    static constexpr std::size_t SLAB_SIZE = 16 * 1024;
+
+    // `block_size` must be a multiple of 16, so every block is as aligned as
+    // operator new would make it.
+    explicit SlabPool(std::size_t block_size);
+
+    SlabPool(const SlabPool &) = delete;
+
+    SlabPool &operator=(const SlabPool &) = delete;
+
+    SlabPool(SlabPool &&) noexcept = default;
+
+    SlabPool &operator=(SlabPool &&) noexcept = default;
+
+    ~SlabPool() = default;
+
+    [[nodiscard]] void *allocate() {
+        if (this->free_list == nullptr) [[unlikely]] {
+            this->grow();
+        }
+        auto *block = this->free_list;
+        this->free_list = block->next;
+        this->in_use++;
+        return block;
+    }
+
+    void deallocate(void *pointer) noexcept {
+        auto *block = static_cast<FreeBlock *>(pointer);
+        block->next = this->free_list;
+        this->free_list = block;
+        this->in_use--;
+    }
+
+    [[nodiscard]] std::size_t block_size() const;
+
+    [[nodiscard]] std::size_t blocks_in_use() const;
+
+    // blocks in all slabs, used or free
+    [[nodiscard]] std::size_t capacity() const;
+
+    [[nodiscard]] std::size_t slab_count() const;
+};
+
+#endif //POOL_H
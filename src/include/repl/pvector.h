@@ -0,0 +1,434 @@
+//
+// Created by mizuk on 2025/3/25.
+//
+
+#ifndef PVECTOR_H
+#define PVECTOR_H
+#include <algorithm>
+#include <cstddef>
+#include <cstdint>
+#include <memory>
+#include <new>
+#include <span>
+#include <utility>
+#include <vector>
+
+#include "repl/heap.h"
+
+// Persistent fixed-size vector: a trie of 32-way branch nodes over leaves of
+// 2^LEAF_BITS items. Copying one shares the root, so copies are O(1) however
+// big the vector is. A store copies only the nodes on its path that are
+// still shared, and updates a node in place once it is the only holder, so
+// a vector nobody shares costs one refcount check per level to change.
+//
+// When a shared leaf is copied, every item goes through CopyItem.
+//
+// Each leaf also records an owner, the tag of the clone that has made it its
+// own (see clones.h), 0 for none; a copy of a leaf keeps it.
+//
+// Nodes come from the thread's Heap pools and, like Values, belong to one
+// thread.
+template<typename T, unsigned LEAF_BITS, typename CopyItem>
+class PVector {
+    static constexpr unsigned BRANCH_BITS = 5;
+    static constexpr std::size_t BRANCH = std::size_t{1} << BRANCH_BITS;
+    static constexpr std::size_t LEAF = std::size_t{1} << LEAF_BITS;
+
+    struct Node {
+        std::uint32_t references;
+        // items of a leaf, children of a branch
+        std::uint32_t count;
+        // of a leaf
+        std::uint64_t owner;
+    };
+
+    static constexpr std::size_t ITEMS_OFFSET = (sizeof(Node) + alignof(T) - 1) / alignof(T) * alignof(T);
+    static constexpr std::size_t CHILDREN_OFFSET = (sizeof(Node) + alignof(Node *) - 1) / alignof(Node *) * alignof(Node *);
+
+    Node *root{nullptr};
+    std::uint32_t count{0};
+    // branch levels above the leaves
+    std::uint32_t depth{0};
+
+    static T *items(Node *node) {
+        return std::launder(reinterpret_cast<T *>(reinterpret_cast<std::byte *>(node) + ITEMS_OFFSET));
+    }
+
+    static const T *items(const Node *node) {
+        return items(const_cast<Node *>(node));
+    }
+
+    static Node **children(Node *node) {
+        return std::launder(reinterpret_cast<Node **>(reinterpret_cast<std::byte *>(node) + CHILDREN_OFFSET));
+    }
+
+    static Node *const *children(const Node *node) {
+        return children(const_cast<Node *>(node));
+    }
+
+    static std::size_t leafBytes(const std::uint32_t items) {
+        return ITEMS_OFFSET + items * sizeof(T);
+    }
+
+    static std::size_t branchBytes(const std::uint32_t children) {
+        return CHILDREN_OFFSET + children * sizeof(Node *);
+    }
+
+    static Node *allocate(const std::size_t bytes, const std::uint32_t node_count, const std::uint64_t owner = 0) {
+        return new(Heap::allocate(bytes)) Node{1, node_count, owner};
+    }
+
+    static void release(Node *node, const std::uint32_t level) {
+        if (--node->references != 0) {
+            return;
+        }
+        if (level == 0) {
+            std::destroy_n(items(node), node->count);
+            Heap::deallocate(node, leafBytes(node->count));
+        } else {
+            for (std::uint32_t i = 0; i < node->count; i++) {
+                release(children(node)[i], level - 1);
+            }
+            Heap::deallocate(node, branchBytes(node->count));
+        }
+    }
+
+    // An unshared copy of `node`, which gives up the caller's reference to
+    // the original.
+    static Node *copy(Node *node, const std::uint32_t level) {
+        Node *result;
+        if (level == 0) {
+            result = allocate(leafBytes(node->count), node->count, node->owner);
+            for (std::uint32_t i = 0; i < node->count; i++) {
+                new(items(result) + i) T(CopyItem()(items(node)[i]));
+            }
+        } else {
+            result = allocate(branchBytes(node->count), node->count);
+            for (std::uint32_t i = 0; i < node->count; i++) {
+                children(result)[i] = children(node)[i];
+                children(result)[i]->references++;
+            }
+        }
+        release(node, level);
+        return result;
+    }
+
+    // the child of a branch at `level` on the way to leaf `leaf_index`
+    static std::size_t slot(const std::size_t leaf_index, const std::uint32_t level) {
+        return leaf_index >> (BRANCH_BITS * (level - 1)) & (BRANCH - 1);
+    }
+
+    // `leaf` made `owner`'s, each item x becoming item(x, the previous owner):
+    // in place if no other vector holds it, else as a copy, which gives up
+    // the caller's reference to the original
+    template<typename Item>
+    static Node *own(Node *leaf, const std::uint64_t owner, Item &item) {
+        const auto previous = leaf->owner;
+        if (leaf->references == 1) {
+            for (std::uint32_t i = 0; i < leaf->count; i++) {
+                items(leaf)[i] = item(items(leaf)[i], previous);
+            }
+            leaf->owner = owner;
+            return leaf;
+        }
+        auto *result = allocate(leafBytes(leaf->count), 0, owner);
+        for (std::uint32_t i = 0; i < leaf->count; i++) {
+            new(items(result) + i) T(item(items(leaf)[i], previous));
+            result->count++;
+        }
+        release(leaf, 0);
+        return result;
+    }
+
+    static bool owned(const Node *node, const std::uint32_t level, const std::uint64_t owner) {
+        if (level == 0) {
+            return node->owner == owner;
+        }
+        return std::all_of(children(node), children(node) + node->count, [&](const Node *child) {
+            return owned(child, level - 1, owner);
+        });
+    }
+
+    template<typename Item>
+    static void ownLeaves(Node *&node, const std::uint32_t level, const std::uint64_t owner, Item &item) {
+        if (level == 0) {
+            if (node->owner != owner) {
+                node = own(node, owner, item);
+            }
+            return;
+        }
+        // a branch is copied only on the way to a leaf that changes
+        if (owned(node, level, owner)) {
+            return;
+        }
+        if (node->references > 1) {
+            node = copy(node, level);
+        }
+        for (std::uint32_t i = 0; i < node->count; i++) {
+            ownLeaves(children(node)[i], level - 1, owner, item);
+        }
+    }
+
+    template<typename F>
+    static void leaves(const Node *node, const std::uint32_t level, F &f) {
+        if (level == 0) {
+            f(std::span<const T>(items(node), node->count));
+            return;
+        }
+        for (std::uint32_t i = 0; i < node->count; i++) {
+            leaves(children(node)[i], level - 1, f);
+        }
+    }
+
+    template<typename F>
+    static void updateLeaves(Node *&node, const std::uint32_t level, F &f) {
+        if (node->references > 1) {
+            node = copy(node, level);
+        }
+        if (level == 0) {
+            f(std::span<T>(items(node), node->count));
+            return;
+        }
+        for (std::uint32_t i = 0; i < node->count; i++) {
+            updateLeaves(children(node)[i], level - 1, f);
+        }
+    }
+
+    template<typename Keep, typename Item>
+    static Node *rebuild(Node *node, const std::uint32_t level, Keep &keep, Item &item) {
+        if (level == 0) {
+            if (std::all_of(items(node), items(node) + node->count, keep)) {
+                node->references++;
+                return node;
+            }
+            auto *leaf = allocate(leafBytes(node->count), 0);
+            for (std::uint32_t i = 0; i < node->count; i++) {
+                new(items(leaf) + i) T(item(items(node)[i]));
+                leaf->count++;
+            }
+            return leaf;
+        }
+        auto *branch = allocate(branchBytes(node->count), node->count);
+        auto same = true;
+        for (std::uint32_t i = 0; i < node->count; i++) {
+            children(branch)[i] = rebuild(children(node)[i], level - 1, keep, item);
+            same = same && children(branch)[i] == children(node)[i];
+        }
+        // nothing below changed, so share the original instead
+        if (same) {
+            release(branch, level);
+            node->references++;
+            return node;
+        }
+        return branch;
+    }
+
+    template<typename Visit>
+    static void trace(const Node *node, const std::uint32_t level, Tracer &tracer, Visit &visit) {
+        // a node held by several vectors reports its items once per pass
+        if (node->references > 1 && !tracer.enter(node)) {
+            return;
+        }
+        if (level == 0) {
+            for (std::uint32_t i = 0; i < node->count; i++) {
+                visit(items(node)[i]);
+            }
+            return;
+        }
+        for (std::uint32_t i = 0; i < node->count; i++) {
+            trace(children(node)[i], level - 1, tracer, visit);
+        }
+    }
+
+public:
+    PVector() = default;
+
+    // Builds the vector bottom up, item(i) giving the i-th item: full leaves,
+    // then levels of full branches, so nothing is ever copied. The leaves
+    // belong to `owner`.
+    template<typename Item>
+    static PVector generate(const std::size_t size, Item item, const std::uint64_t owner = 0) {
+        PVector vector;
+        if (size == 0) {
+            return vector;
+        }
+        vector.count = static_cast<std::uint32_t>(size);
+
+        const auto make_leaf = [&](const std::size_t start) {
+            const auto items_count = static_cast<std::uint32_t>(std::min(LEAF, size - start));
+            auto *leaf = allocate(leafBytes(items_count), 0, owner);
+            for (std::uint32_t i = 0; i < items_count; i++) {
+                new(items(leaf) + i) T(item(start + i));
+                leaf->count++;
+            }
+            return leaf;
+        };
+        // a single leaf, the common case, is the root
+        if (size <= LEAF) {
+            vector.root = make_leaf(0);
+            return vector;
+        }
+
+        auto nodes = std::vector<Node *>();
+        nodes.reserve((size + LEAF - 1) / LEAF);
+        for (std::size_t start = 0; start < size; start += LEAF) {
+            nodes.push_back(make_leaf(start));
+        }
+        while (nodes.size() > 1) {
+            auto parents = std::vector<Node *>();
+            parents.reserve((nodes.size() + BRANCH - 1) / BRANCH);
+            for (std::size_t start = 0; start < nodes.size(); start += BRANCH) {
+                const auto children_count = static_cast<std::uint32_t>(std::min(BRANCH, nodes.size() - start));
+                auto *branch = allocate(branchBytes(children_count), children_count);
+                std::copy_n(nodes.begin() + static_cast<std::ptrdiff_t>(start), children_count, children(branch));
+                parents.push_back(branch);
+            }
+            nodes = std::move(parents);
+            vector.depth++;
+        }
+        vector.root = nodes.front();
+        return vector;
+    }
+
+    PVector(const PVector &other) : root(other.root), count(other.count), depth(other.depth) {
+        if (this->root != nullptr) {
+            this->root->references++;
+        }
+    }
+
+    PVector(PVector &&other) noexcept
+        : root(std::exchange(other.root, nullptr)), count(std::exchange(other.count, 0)),
+          depth(std::exchange(other.depth, 0)) {
+    }
+
+    PVector &operator=(PVector other) noexcept {
+        std::swap(this->root, other.root);
+        std::swap(this->count, other.count);
+        std::swap(this->depth, other.depth);
+        return *this;
+    }
+
+    ~PVector() {
+        if (this->root != nullptr) {
+            release(this->root, this->depth);
+        }
+    }
+
+    [[nodiscard]] std::size_t size() const {
+        return this->count;
+    }
+
+    [[nodiscard]] const T &operator[](const std::size_t index) const {
+        const Node *node = this->root;
+        // a vector of up to one leaf, most of them, is just the leaf
+        if (this->depth != 0) [[unlikely]] {
+            const auto leaf_index = index >> LEAF_BITS;
+            for (auto level = this->depth; level > 0; level--) {
+                node = children(node)[slot(leaf_index, level)];
+            }
+        }
+        return items(node)[index & (LEAF - 1)];
+    }
+
+    // The item at `index`, for changing it: every node on its path is
+    // copied first if another vector still holds it.
+    [[nodiscard]] T &unique(const std::size_t index) {
+        if (this->depth == 0 && this->root->references == 1) [[likely]] {
+            return items(this->root)[index];
+        }
+        auto **node = &this->root;
+        const auto leaf_index = index >> LEAF_BITS;
+        for (auto level = this->depth;; level--) {
+            if ((*node)->references > 1) {
+                *node = copy(*node, level);
+            }
+            if (level == 0) {
+                return items(*node)[index & (LEAF - 1)];
+            }
+            node = &children(*node)[slot(leaf_index, level)];
+        }
+    }
+
+    // the owner of the leaf holding `index`
+    [[nodiscard]] std::uint64_t ownerOf(const std::size_t index) const {
+        const auto leaf_index = index >> LEAF_BITS;
+        const Node *leaf = this->root;
+        for (auto level = this->depth; level > 0; level--) {
+            leaf = children(leaf)[slot(leaf_index, level)];
+        }
+        return leaf->owner;
+    }
+
+    // Makes the leaf holding `index` belong to `owner`, unless it already
+    // does: each item x in it becomes item(x, the leaf's previous owner), and
+    // the leaf and the branches above it are copied first if another vector
+    // still holds them.
+    template<typename Item>
+    void own(const std::size_t index, const std::uint64_t owner, Item item) {
+        if (this->ownerOf(index) == owner) {
+            return;
+        }
+        const auto leaf_index = index >> LEAF_BITS;
+        auto **node = &this->root;
+        for (auto level = this->depth; level > 0; level--) {
+            if ((*node)->references > 1) {
+                *node = copy(*node, level);
+            }
+            node = &children(*node)[slot(leaf_index, level)];
+        }
+        *node = own(*node, owner, item);
+    }
+
+    // own() for every leaf
+    template<typename Item>
+    void ownEach(const std::uint64_t owner, Item item) {
+        if (this->root != nullptr) {
+            ownLeaves(this->root, this->depth, owner, item);
+        }
+    }
+
+    // whether another vector shares the root, e.g. a copy not yet stored into
+    [[nodiscard]] bool shared() const {
+        return this->root != nullptr && this->root->references > 1;
+    }
+
+    // f(std::span<const T>) for each leaf, in order
+    template<typename F>
+    void forEachLeaf(F f) const {
+        if (this->root != nullptr) {
+            leaves(this->root, this->depth, f);
+        }
+    }
+
+    // f(std::span<T>) for each leaf, in order, after unsharing all of them
+    template<typename F>
+    void updateEachLeaf(F f) {
+        if (this->root != nullptr) {
+            updateLeaves(this->root, this->depth, f);
+        }
+    }
+
+    // A copy sharing every leaf whose items all satisfy keep(item), and each
+    // branch above only such leaves; other leaves are rebuilt, with item(x)
+    // in place of each x.
+    template<typename Keep, typename Item>
+    [[nodiscard]] PVector rebuild(Keep keep, Item item) const {
+        PVector result;
+        result.count = this->count;
+        result.depth = this->depth;
+        if (this->root != nullptr) {
+            result.root = rebuild(this->root, this->depth, keep, item);
+        }
+        return result;
+    }
+
+    // visit(item) for each item, skipping nodes the tracer has already seen
+    template<typename Visit>
+    void trace(Tracer &tracer, Visit visit) const {
+        if (this->root != nullptr) {
+            trace(this->root, this->depth, tracer, visit);
+        }
+    }
+};
+
+#endif //PVECTOR_H
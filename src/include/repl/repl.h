@@ -4,9 +4,43 @@
 
 #ifndef REPL_H
 #define REPL_H
+#include <cstddef>
+#include <string>
+
+class Interpreter;
+class ParseCache;
 
 namespace REPL {
-    [[noreturn]] void Start();
+    // Lines are parsed through a ParseCache of `cache_capacity` entries; the
+    // prompt command `:cache` prints its counters.
+    [[noreturn]] void Start(std::size_t cache_capacity);
+
+    // Threads parsing ahead of the interpreter unless told otherwise: one per
+    // core but the interpreter's own, so none on a single core.
+    [[nodiscard]] std::size_t ParseJobs();
+
+    // Runs a script file statement by statement, exactly as if each line had
+    // been typed at the prompt. The file is memory-mapped and lexed in place,
+    // so memory use does not grow with the size of the script.
+    //
+    // With `jobs` threads, lines are lexed and parsed ahead of the thread
+    // compiling and running them: by one thread, a few hundred lines ahead,
+    // or by a work-stealing pool of several, a few chunks each. Output,
+    // diagnostics and errors come out exactly as they would one line at a time.
+    void RunFile(const std::string &path, std::size_t cache_capacity, std::size_t jobs = ParseJobs());
+
+    // The same, on an interpreter that keeps its globals afterwards.
+    void RunFile(Interpreter &interpreter, ParseCache &cache, const std::string &path,
+                 std::size_t jobs = ParseJobs());
+
+    // Serves the interpreter over a Unix domain socket at `socket_path`, with
+    // one worker thread per core answering reads (see Server), after running
+    // the `preload` script, if one is given. Serves until the process exits.
+    void Serve(const std::string &socket_path, const std::string &preload, std::size_t cache_capacity);
+
+    // Parses a whole script as one program without running it, printing each
+    // diagnostic as path:line:column. Returns the number of diagnostics.
+    std::size_t CheckFile(const std::string &path);
 }
 
 #endif //REPL_H
@@ -0,0 +1,168 @@
+//
+// Created by mizuk on 2025/3/28.
+//
+
+#ifndef SERVER_H
+#define SERVER_H
+#include <atomic>
+#include <condition_variable>
+#include <cstddef>
+#include <cstdint>
+#include <deque>
+#include <future>
+#include <mutex>
+#include <optional>
+#include <string>
+#include <string_view>
+#include <thread>
+#include <unordered_map>
+#include <vector>
+
+class Versions;
+
+// Serves one interpreter to many local clients over a Unix domain socket
+// (Linux only; elsewhere the constructor throws).
+//
+// Every request and every response is a frame: a 4-byte little-endian length,
+// then that many bytes of text. A request is a line as typed at the prompt,
+// and its response is what the prompt would print for it, lines joined by
+// '\n'. A connection's requests are answered one at a time, in order, so a
+// client may pipeline them.
+//
+// One epoll loop does all the socket I/O. A request that is a read, a
+// variable or an access path, goes to a pool of workers that answer it from
+// the latest committed version of the globals, without waiting for the
+// writer. Anything else goes to the writer thread, which alone owns the
+// interpreter: it runs the writes queued so far, commits once for the whole
+// batch, and only then answers them, so a client always reads its own writes.
+class Server {
+public:
+    static constexpr std::uint32_t MAX_FRAME = 16 << 20;
+
+private:
+    struct Request {
+        std::uint64_t connection;
+        std::string text;
+    };
+
+    // Requests handed from the loop to worker or writer threads.
+    class Queue {
+        std::mutex mutex;
+        std::condition_variable ready;
+        std::deque<Request> requests;
+        bool closed{false};
+
+    public:
+        void push(Request request);
+
+        // blocks for the next request; nullopt once closed and empty
+        std::optional<Request> pop();
+
+        // blocks for at least one request, then takes all there are; empty
+        // once closed and empty
+        std::vector<Request> drain();
+
+        void close();
+    };
+
+    struct Connection {
+        int fd;
+        // received, not yet framed into requests
+        std::string input;
+        // framed responses, not yet written
+        std::string output;
+        // a request is with a worker or the writer
+        bool busy{false};
+        // the peer has shut down its side; closed once everything is answered
+        bool hung_up{false};
+        // what epoll is watching it for
+        std::uint32_t events;
+    };
+
+    std::string path;
+    bool bound{false};
+    int listener{-1};
+    int epoll{-1};
+    // wakes the loop for finished responses and for stop()
+    int wake{-1};
+
+    Queue reads;
+    Queue writes;
+    std::mutex finished_mutex;
+    std::vector<Request> finished;
+    std::atomic<bool> stopping{false};
+
+    // the loop's alone
+    std::unordered_map<std::uint64_t, Connection> connections;
+    std::uint64_t next_connection{2};
+
+    // the writer's interpreter's, for the workers
+    Versions *versions{nullptr};
+    std::thread writer;
+    std::vector<std::thread> workers;
+
+    void runWriter(std::size_t cache_capacity, const std::string &preload, std::promise<Versions *> &started);
+
+    void runWorker();
+
+    // hands a response to the loop; any thread
+    void respond(std::uint64_t connection, std::string text);
+
+    void accept();
+
+    // hands finished responses to their connections
+    void deliver();
+
+    // reads what the client has sent; false if it had to be closed
+    bool receive(std::uint64_t id, Connection &connection);
+
+    // Takes its next request if it has none in flight, writes what it can and
+    // closes it once it has hung up with nothing left to do; false if it did.
+    bool progress(std::uint64_t id, Connection &connection);
+
+    void close(std::uint64_t id);
+
+    void shutdown();
+
+public:
+    // Listens at `path`, replacing a stale socket there, and starts the writer
+    // and `workers` worker threads, at most Versions::MAX_READERS. The writer first runs `preload`, if any,
+    // as RunFile would, and commits it.
+    Server(std::string path, std::size_t workers, std::size_t cache_capacity, std::string preload = {});
+
+    Server(const Server &) = delete;
+
+    Server &operator=(const Server &) = delete;
+
+    // Stops every thread and removes the socket.
+    ~Server();
+
+    // Accepts and serves clients on the calling thread until stop().
+    void run();
+
+    // Makes run() return; any thread.
+    void stop();
+};
+
+// A blocking client for a Server, one request at a time or pipelined.
+class Client {
+    int fd{-1};
+
+public:
+    explicit Client(const std::string &path);
+
+    Client(const Client &) = delete;
+
+    Client &operator=(const Client &) = delete;
+
+    ~Client();
+
+    void send(std::string_view request) const;
+
+    // the next response; throws std::runtime_error if the server hung up
+    [[nodiscard]] std::string receive() const;
+
+    [[nodiscard]] std::string request(std::string_view request) const;
+};
+
+#endif //SERVER_H
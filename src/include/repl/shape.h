@@ -0,0 +1,121 @@
+//
+// Created by mizuk on 2025/3/20.
+//
+
+#ifndef SHAPE_H
+#define SHAPE_H
+#include <atomic>
+#include <cstdint>
+#include <memory>
+#include <mutex>
+#include <optional>
+#include <shared_mutex>
+#include <span>
+#include <vector>
+
+#include "repl/flat_hash_map.h"
+#include "repl/interner.h"
+
+// The key layout of a Map: which keys it has and the offset of each key's
+// value. Shapes are immutable and shared by every map with the same keys in
+// the same order, so a map itself only stores its values. They form one
+// process-wide tree rooted at the empty shape; adding a key moves to a child,
+// which is created the first time and reused afterwards. Like atoms, shapes
+// in the tree live for the rest of the process, so such a `const Shape *`
+// never dangles and pointer equality means equal layouts.
+//
+// A child records only the key it adds: a small shape finds an offset by
+// walking up to the root, a larger one builds a table of all its keys the
+// first time it is asked. Past MAX_SHARED_KEYS keys a map gets a dictionary
+// shape of its own instead, outside the tree and freed with the last map
+// holding it, so literals with many keys, each seen once, do not fill the
+// tree.
+class Shape {
+public:
+    // the most keys a shape in the tree has
+    static constexpr std::uint32_t MAX_SHARED_KEYS = 128;
+
+private:
+    // up to this many keys, a lookup walks the chain rather than a table
+    static constexpr std::uint32_t CHAIN_KEYS = 8;
+
+    struct Table {
+        // keys by offset
+        std::vector<Atom> keys;
+        FlatHashMap<Atom, std::uint32_t> offsets;
+    };
+
+    // nullptr for the empty shape and for a dictionary
+    const Shape *parent;
+    // the key this shape adds to its parent's, at offset count - 1
+    Atom key;
+    std::uint32_t count;
+    bool is_dictionary;
+    // maps holding a dictionary; unused in the tree
+    mutable std::atomic<std::uint32_t> references{0};
+
+    mutable std::once_flag table_built;
+    mutable std::unique_ptr<Table> table;
+
+    mutable std::shared_mutex mutex;
+    mutable FlatHashMap<Atom, std::unique_ptr<Shape> > transitions;
+
+    Shape(const Shape *parent, Atom key);
+
+    // a dictionary for `keys`, which are distinct
+    explicit Shape(std::vector<Atom> keys);
+
+    // all keys, built on first use
+    const Table &tableOf() const;
+
+    // the child of this tree shape adding `key`, which it lacks
+    const Shape *child(Atom key) const;
+
+public:
+    Shape();
+
+    Shape(const Shape &) = delete;
+
+    Shape &operator=(const Shape &) = delete;
+
+    // the shape of a map with no keys
+    static const Shape *empty();
+
+    // The shape in the tree for `keys`, added in order, repeated keys keeping
+    // their first offset; nullptr when more than MAX_SHARED_KEYS of them are
+    // distinct.
+    static const Shape *shared(std::span<const Atom> keys);
+
+    // shared(keys), or else a new dictionary, which the Map given it keeps
+    static const Shape *of(std::span<const Atom> keys);
+
+    // The shape with `key` added after these keys, or this one if present;
+    // a new dictionary past MAX_SHARED_KEYS, as of().
+    const Shape *with(Atom key) const;
+
+    [[nodiscard]] std::optional<std::uint32_t> offset(Atom key) const;
+
+    // keys by offset
+    [[nodiscard]] std::vector<Atom> keyList() const;
+
+    [[nodiscard]] std::uint32_t size() const {
+        return this->count;
+    }
+
+    [[nodiscard]] const Shape *parentShape() const {
+        return this->parent;
+    }
+
+    // whether this is a map's own shape rather than one in the tree
+    [[nodiscard]] bool dictionary() const {
+        return this->is_dictionary;
+    }
+
+    // Counted by the maps holding a dictionary, which is freed with the last;
+    // no-ops for a shape in the tree.
+    void retain() const;
+
+    void release() const;
+};
+
+#endif //SHAPE_H
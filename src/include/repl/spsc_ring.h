@@ -0,0 +1,98 @@
+//
+// Created by mizuk on 2025/3/30.
+//
+
+#ifndef SPSC_RING_H
+#define SPSC_RING_H
+#include <array>
+#include <atomic>
+#include <cstddef>
+#include <utility>
+
+// Bounded queue between exactly one producer thread and one consumer thread,
+// without locks: each side alone advances its own index and publishes it with
+// a release store, and keeps a cached copy of the other's so that it touches
+// the shared cache line only when the ring looks full or empty.
+//
+// push() and pop() spin briefly and then sleep on the other side's index, so
+// a stalled stage costs no CPU.
+template<typename T, std::size_t Capacity>
+class SpscRing {
+    static_assert(Capacity > 0 && (Capacity & (Capacity - 1)) == 0, "Capacity must be a power of two");
+
+    static constexpr std::size_t SPINS = 64;
+
+    std::array<T, Capacity> slots{};
+    // next slot to pop; written by the consumer
+    alignas(64) std::atomic<std::size_t> head{0};
+    // next slot to push; written by the producer
+    alignas(64) std::atomic<std::size_t> tail{0};
+    // the producer's last look at `head`
+    alignas(64) std::size_t cached_head{0};
+    // the consumer's last look at `tail`
+    alignas(64) std::size_t cached_tail{0};
+
+public:
+    SpscRing() = default;
+
+    SpscRing(const SpscRing &) = delete;
+
+    SpscRing &operator=(const SpscRing &) = delete;
+
+    // Producer only. Moves `item` in unless the ring is full.
+    bool try_push(T &item) {
+        const auto tail = this->tail.load(std::memory_order_relaxed);
+        if (tail - this->cached_head == Capacity) {
+            this->cached_head = this->head.load(std::memory_order_acquire);
+            if (tail - this->cached_head == Capacity) {
+                return false;
+            }
+        }
+        this->slots[tail & (Capacity - 1)] = std::move(item);
+        this->tail.store(tail + 1, std::memory_order_release);
+        this->tail.notify_one();
+        return true;
+    }
+
+    // Consumer only. Moves the oldest item out unless the ring is empty.
+    bool try_pop(T &item) {
+        const auto head = this->head.load(std::memory_order_relaxed);
+        if (head == this->cached_tail) {
+            this->cached_tail = this->tail.load(std::memory_order_acquire);
+            if (head == this->cached_tail) {
+                return false;
+            }
+        }
+        item = std::move(this->slots[head & (Capacity - 1)]);
+        this->head.store(head + 1, std::memory_order_release);
+        this->head.notify_one();
+        return true;
+    }
+
+    // Producer only; waits while the ring is full.
+    void push(T item) {
+        for (std::size_t spin = 0; !this->try_push(item); spin++) {
+            if (spin >= SPINS) {
+                // full: wait for the consumer to move past the slot it holds
+                this->head.wait(this->cached_head, std::memory_order_acquire);
+            }
+        }
+    }
+
+    // Consumer only; waits while the ring is empty.
+    T pop() {
+        T item;
+        for (std::size_t spin = 0; !this->try_pop(item); spin++) {
+            if (spin >= SPINS) {
+                this->tail.wait(this->cached_tail, std::memory_order_acquire);
+            }
+        }
+        return item;
+    }
+
+    [[nodiscard]] static constexpr std::size_t capacity() {
+        return Capacity;
+    }
+};
+
+#endif //SPSC_RING_H
@@ -4,9 +4,12 @@
 
 #ifndef TOKEN_H
 #define TOKEN_H
-#include <string>
+#include <cstddef>
+#include <string_view>
 #include <variant>
 
+#include "repl/interner.h"
+
 enum class TokenType {
     DOLLAR,
     EQ,
@@ -14,25 +17,37 @@ enum class TokenType {
     RIGHT_CURLY,
     LEFT_SQUARE,
     RIGHT_SQUARE,
+    LEFT_PAREN,
+    RIGHT_PAREN,
     AT,
     PRINT,
     NIL,
     DOT,
     COMMA,
+    SEMICOLON,
+    NEWLINE,
     IDENTIFIER,
     NUMBER,
+    // a character no token starts with, or a number literal out of int range
+    INVALID,
     EOF_,
 };
 
+std::string_view toString(TokenType type);
+
+// IDENTIFIER tokens carry the interned Atom of their spelling rather than a
+// copy of it, which keeps Token small, trivially copyable and allocation-free.
 struct Token {
     TokenType type;
-    std::variant<std::monostate, std::string, int> value;
+    std::variant<std::monostate, Atom, int> value;
+    // byte offset of the token's first character in the lexed input
+    std::size_t offset{0};
 
     explicit Token(const TokenType type)
         : Token(type, std::monostate{}) {
     }
 
-    Token(const TokenType type, const std::variant<std::monostate, std::string, int> &value)
+    Token(const TokenType type, const std::variant<std::monostate, Atom, int> &value)
         : type(type),
           value(value) {
     }
@@ -0,0 +1,251 @@
+//
+// Created by mizuk on 2025/3/21.
+//
+
+#ifndef VALUE_H
+#define VALUE_H
+#include <bit>
+#include <cstddef>
+#include <cstdint>
+#include <memory>
+#include <string>
+#include <utility>
+#include <vector>
+
+#include "repl/interner.h"
+
+class CloneFamily;
+class Freezer;
+class Object;
+class Shape;
+class Tracer;
+struct VersionLink;
+
+// A runtime value in one machine word. Numbers and nil are immediates tagged
+// in the low bits, so creating and copying them never touches the heap; only
+// arrays, maps and other Objects are heap references, counted intrusively.
+// The count is not atomic: a Value and everything reachable from it belong to
+// one thread at a time.
+//
+//   all zero          no value, e.g. a global not declared yet
+//   pointer | 000     Object *, at least 8-byte aligned
+//   int << 32 | 001   number
+//   010               nil
+class Value {
+    static_assert(sizeof(std::uintptr_t) == 8, "Value packs an int beside its tag in 64 bits");
+
+    static constexpr std::uintptr_t TAG_MASK = 0b111;
+    static constexpr std::uintptr_t NUMBER_TAG = 0b001;
+    static constexpr std::uintptr_t NIL_BITS = 0b010;
+
+    std::uintptr_t bits{0};
+
+    [[nodiscard]] bool isReference() const {
+        return (this->bits & TAG_MASK) == 0 && this->bits != 0;
+    }
+
+    inline void retain() const;
+
+    // takes the bits being dropped, so the release happens after the
+    // assignment even when the source lived inside the released object
+    static inline void release(std::uintptr_t bits);
+
+public:
+    // no value
+    Value() = default;
+
+    // Takes a new reference to `object`, which must not be null.
+    explicit inline Value(Object *object);
+
+    static Value nil() {
+        Value value;
+        value.bits = NIL_BITS;
+        return value;
+    }
+
+    static Value number(const int num) {
+        Value value;
+        value.bits = static_cast<std::uintptr_t>(std::bit_cast<std::uint32_t>(num)) << 32 | NUMBER_TAG;
+        return value;
+    }
+
+    template<typename T, typename... Args>
+    static Value make(Args &&... args) {
+        return Value(new T(std::forward<Args>(args)...));
+    }
+
+    Value(const Value &other) : bits(other.bits) {
+        this->retain();
+    }
+
+    Value(Value &&other) noexcept : bits(std::exchange(other.bits, 0)) {
+    }
+
+    Value &operator=(const Value &other) {
+        other.retain();
+        release(std::exchange(this->bits, other.bits));
+        return *this;
+    }
+
+    Value &operator=(Value &&other) noexcept {
+        if (this != &other) {
+            release(std::exchange(this->bits, std::exchange(other.bits, 0)));
+        }
+        return *this;
+    }
+
+    ~Value() {
+        release(this->bits);
+    }
+
+    // false only for "no value"
+    explicit operator bool() const {
+        return this->bits != 0;
+    }
+
+    [[nodiscard]] bool isNil() const {
+        return this->bits == NIL_BITS;
+    }
+
+    [[nodiscard]] bool isNumber() const {
+        return (this->bits & TAG_MASK) == NUMBER_TAG;
+    }
+
+    [[nodiscard]] bool isObject() const {
+        return this->isReference();
+    }
+
+    [[nodiscard]] int asNumber() const {
+        return std::bit_cast<int>(static_cast<std::uint32_t>(this->bits >> 32));
+    }
+
+    // the referenced object, or nullptr for immediates
+    [[nodiscard]] Object *object() const {
+        return this->isReference() ? reinterpret_cast<Object *>(this->bits) : nullptr;
+    }
+
+    template<typename T>
+    [[nodiscard]] T *as() const {
+        return dynamic_cast<T *>(this->object());
+    }
+
+    // Map layout of the referenced object, nullptr for anything else.
+    [[nodiscard]] inline const Shape *shapeOf() const;
+
+    [[nodiscard]] std::string toString() const;
+
+    [[nodiscard]] Value get_item(const Identifier &identifier) const;
+
+    Value set_item(const Identifier &identifier, Value &value) const;
+
+    // identity for references, equality for immediates
+    bool operator==(const Value &other) const {
+        return this->bits == other.bits;
+    }
+};
+
+// Base of everything a Value can refer to. Each object registers itself with
+// its thread's Heap (see heap.h), which also accounts for the memory of those
+// allocated with new.
+class Object {
+    friend class Heap;
+    friend class Value;
+    friend class Freezer;
+    friend class Versions;
+
+    mutable std::uint32_t references{0};
+    // position in the heap's object list
+    std::uint32_t heap_index{0};
+
+protected:
+    // set once a Versions has committed this object (see versions.h); a copy
+    // starts without one
+    mutable VersionLink *link{nullptr};
+
+public:
+    Object();
+
+    // a copy is a new object with no references yet
+    Object(const Object &);
+
+    Object &operator=(const Object &) {
+        return *this;
+    }
+
+    virtual ~Object() = 0;
+
+    static void *operator new(std::size_t size);
+
+    static void operator delete(void *pointer, std::size_t size);
+
+    // Reports every object this one holds a reference to.
+    virtual void trace(Tracer &tracer) const {
+    }
+
+    // Drops those references; the collector calls it to break a cycle.
+    virtual void clear() {
+    }
+
+    virtual std::string toString() = 0;
+
+    virtual Value _get_item(const Identifier &identifier) = 0;
+
+    virtual Value _set_item(const Identifier &identifier, Value &value) = 0;
+
+    [[nodiscard]] virtual Identifier identifier() const = 0;
+
+    // A deep copy for a committed version of the globals (see versions.h),
+    // sharing with this one only nodes that hold no references, so nothing
+    // the writer stores into later can show through it; nullptr when the
+    // object never changes and can itself be shared.
+    [[nodiscard]] virtual Object *freeze(Freezer &freezer) const {
+        return nullptr;
+    }
+
+    // A copy of this object as it was at `instant`, for a clone(x) (see
+    // clones.h), sharing its storage; nullptr when the object never changes
+    // and can itself be shared.
+    [[nodiscard]] virtual Object *cloneAt(std::uint64_t instant, const std::shared_ptr<CloneFamily> &family) const {
+        return nullptr;
+    }
+
+    // Moves the pasts no clone looks back to any more into `dropped`, for
+    // the caller to free.
+    virtual void trimPasts(std::vector<std::shared_ptr<void> > &dropped) {
+    }
+
+    // the layout of a Map's values, nullptr for every other object
+    [[nodiscard]] virtual const Shape *shapeOf() const {
+        return nullptr;
+    }
+
+    // whether a Versions has committed this object and follows its stores
+    [[nodiscard]] bool committed() const {
+        return this->link != nullptr;
+    }
+};
+
+inline Value::Value(Object *object) : bits(reinterpret_cast<std::uintptr_t>(object)) {
+    object->references++;
+}
+
+inline void Value::retain() const {
+    if (this->isReference()) {
+        reinterpret_cast<Object *>(this->bits)->references++;
+    }
+}
+
+inline void Value::release(const std::uintptr_t bits) {
+    if ((bits & TAG_MASK) == 0 && bits != 0) {
+        const auto *object = reinterpret_cast<Object *>(bits);
+        if (--object->references == 0) {
+            delete object;
+        }
+    }
+}
+
+inline const Shape *Value::shapeOf() const {
+    return this->isReference() ? reinterpret_cast<Object *>(this->bits)->shapeOf() : nullptr;
+}
+
+#endif //VALUE_H
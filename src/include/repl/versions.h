@@ -0,0 +1,210 @@
+//
+// Created by mizuk on 2025/3/26.
+//
+
+#ifndef VERSIONS_H
+#define VERSIONS_H
+#include <array>
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+#include <functional>
+#include <memory>
+#include <string>
+#include <string_view>
+#include <utility>
+#include <vector>
+
+#include "repl/flat_hash_map.h"
+#include "repl/interner.h"
+#include "repl/pvector.h"
+#include "repl/value.h"
+
+class Globals;
+class Versions;
+
+// What a Versions keeps about one of the writer's objects once it has
+// committed it, so that the next commit copies only what was stored into
+// since. Writer only.
+struct VersionLink {
+    // nullptr once the Versions is gone
+    Versions *versions;
+    // the object's frozen copy in the latest version, or in the one a commit
+    // is making
+    Value copy;
+    // the commit that made `copy`, which may change it until it is published
+    std::uint64_t epoch;
+    // Where committed objects, by their links, or global slots, by nullptr,
+    // held this object as of the last commit, less what has been stored over
+    // since; the position is an Array index, a Map offset or a slot.
+    std::vector<std::pair<VersionLink *, std::uint32_t> > holders;
+    // positions stored into since the last commit, unsorted, with repeats
+    std::vector<std::uint32_t> stored;
+    // every position was stored into, by fill()
+    bool refilled{false};
+    // waiting in the Versions' queue of objects stored into
+    bool queued{false};
+    // the Versions' list of its links
+    VersionLink *previous{nullptr};
+    VersionLink *next{nullptr};
+};
+
+// Makes the frozen copies for one commit, once per object, so objects shared
+// or in cycles are shared and cyclic in the copy too.
+class Freezer {
+    Versions *versions;
+    std::uint64_t epoch;
+    FlatHashMap<const Object *, Value> copies;
+    // objects copied whole for the commit, whose holdings it has yet to record
+    std::vector<const Object *> adopted;
+
+    friend class Versions;
+
+public:
+    Freezer(Versions *versions, std::uint64_t epoch);
+
+    // The frozen copy of `value`; immediates are their own. An object the
+    // Versions already holds a copy of is not copied again: its copy is
+    // brought up to date after.
+    Value freeze(const Value &value);
+
+    // records `copy` as the frozen copy of `original` before its contents are
+    // frozen, which may lead back to it
+    void remember(const Object *original, Object *copy);
+};
+
+// The globals as of one commit. Every object in it is a frozen copy that no
+// code stores into, so any number of threads can read it at once.
+struct GlobalsVersion {
+    std::uint64_t epoch;
+    // shared with the previous version while no name has been added
+    std::shared_ptr<const FlatHashMap<Atom, std::uint32_t> > directory;
+    // by slot; empty for a slot not declared when committed. Shared with the
+    // previous version but for the slots a commit changes.
+    PVector<Value, 5, std::identity> slots;
+};
+
+// A reader's pin on the version that was latest when it was taken, which
+// stays readable, however many commits follow, until the snapshot is
+// destroyed. Reading takes no lock and never waits for the writer.
+//
+// Values reached through a snapshot are borrowed: their counts belong to the
+// writer's thread, so a reader must not copy one that refers to an object.
+class Snapshot {
+    Versions *versions;
+    std::size_t reader;
+    const GlobalsVersion *version;
+
+    friend class Versions;
+
+    Snapshot(Versions *versions, std::size_t reader, const GlobalsVersion *version);
+
+public:
+    Snapshot(const Snapshot &) = delete;
+
+    Snapshot &operator=(const Snapshot &) = delete;
+
+    Snapshot(Snapshot &&other) noexcept;
+
+    ~Snapshot();
+
+    // 0 before the first commit, when no global is visible
+    [[nodiscard]] std::uint64_t epoch() const;
+
+    // the global's value, nullptr if it was not declared
+    [[nodiscard]] const Value *get(Atom name) const;
+
+    // Evaluates a variable or a read-only access path such as `cfg.limits[0]`
+    // and prints the result as the prompt would. Throws like the VM does:
+    // InterpreterError for an undeclared variable, std::out_of_range for a
+    // missing index or key, and std::invalid_argument for any input that is
+    // not exactly one read, so a caller can hand that to the writer instead.
+    [[nodiscard]] std::string read(std::string_view path) const;
+};
+
+// Committed versions of an interpreter's globals, for readers on other
+// threads. The writer, the thread running the interpreter, publishes one with
+// commit(); readers pin the latest with pin().
+//
+// Old versions are freed by epoch-based reclamation: each reader announces the
+// epoch it pinned in its own slot, and a version replaced since is freed, on
+// the writer's thread, once it is older than every announced epoch.
+class Versions {
+    friend class Snapshot;
+
+public:
+    static constexpr std::size_t MAX_READERS = 64;
+
+private:
+    struct alignas(64) Reader {
+        std::atomic<bool> claimed{false};
+        // epoch announced while reading, 0 when idle
+        std::atomic<std::uint64_t> pinned{0};
+    };
+
+    std::array<Reader, MAX_READERS> readers;
+    std::atomic<GlobalsVersion *> current{nullptr};
+    // epoch of `current`, published after it
+    std::atomic<std::uint64_t> latest{0};
+    // the writer's alone from here on
+    std::vector<std::unique_ptr<GlobalsVersion> > retired;
+    std::uint64_t next_epoch{1};
+    // the links of every object committed and still alive
+    VersionLink *links{nullptr};
+    // objects stored into since the last commit
+    std::vector<Value> stored;
+
+    friend class Freezer;
+
+    void unpin(std::size_t reader);
+
+    // links `object`, committed for the first time
+    VersionLink *adopt(const Object &object);
+
+    void queue(Object &object, VersionLink &link);
+
+public:
+    Versions() = default;
+
+    Versions(const Versions &) = delete;
+
+    Versions &operator=(const Versions &) = delete;
+
+    // Must run on the writer's thread, after every snapshot is gone.
+    ~Versions();
+
+    // Freezes `globals` into a new latest version and returns its epoch,
+    // then frees what no reader can reach any more. Writer only.
+    //
+    // Only what changed since the last commit is copied: objects not
+    // committed before are frozen whole, though packed arrays and runs of
+    // numbers are shared rather than copied, while one already committed and
+    // stored into has its latest copy copied, sharing all but the paths to
+    // the positions stored, and likewise each object and global slot holding
+    // it in turn. Everything else keeps its copy from the previous version.
+    std::uint64_t commit(Globals &globals);
+
+    // Frees every replaced version older than all pinned epochs. Writer only.
+    void reclaim();
+
+    // Pins the latest version; any thread. Throws std::runtime_error when
+    // MAX_READERS snapshots are already held.
+    [[nodiscard]] Snapshot pin();
+
+    // versions not freed yet, the latest included; writer only
+    [[nodiscard]] std::size_t retained() const;
+
+    // Called by the writer's Arrays and Maps that have been committed: before
+    // `position` is stored over, its value being `old`; before fill(); and
+    // when destroyed or cleared, before letting go of their contents.
+    static void storing(Object &object, std::uint32_t position, const Value &old);
+
+    static void refilling(Object &object);
+
+    static void forget(Object &object);
+
+    // by Globals before a slot holding a committed object is stored over
+    static void unslot(const Object &old, std::uint32_t slot);
+};
+
+#endif //VERSIONS_H
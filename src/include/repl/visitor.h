@@ -19,48 +19,50 @@ class Declaration;
 class ArrayDefinition;
 class EntryDefinition;
 class MapDefinition;
-class AccessorExpr;
+class AccessPath;
+class Call;
 class PrintStatement;
 class EmptyStatement;
+class Program;
 class Self;
 
-class Object;
+class Value;
 
 class Visitor {
 public:
     virtual ~Visitor() = default;
 
-    virtual std::shared_ptr<Object> visit(const Expr& expr) = 0;
+    virtual Value visit(const Expr& expr) = 0;
 
-    virtual std::shared_ptr<Object> visit(const NumberLiteral &numberLiteral) = 0;
+    virtual Value visit(const NumberLiteral &numberLiteral) = 0;
 
-    virtual std::shared_ptr<Object> visit(const NilLiteral &nilLiteral) = 0;
+    virtual Value visit(const NilLiteral &nilLiteral) = 0;
 
-    virtual std::shared_ptr<Object> visit(const Variable &variable) = 0;
+    virtual Value visit(const Variable &variable) = 0;
 
-    virtual std::shared_ptr<Object> visit(const Symbol &symbol) = 0;
+    virtual Value visit(const Symbol &symbol) = 0;
 
-    virtual std::shared_ptr<Object> visit(const Assignment &assignment) = 0;
+    virtual Value visit(const Assignment &assignment) = 0;
 
-    virtual std::shared_ptr<Object> visit(const Declaration &declaration) = 0;
+    virtual Value visit(const Declaration &declaration) = 0;
 
-    virtual std::shared_ptr<Object> visit(const ArrayDefinition &arrayDefinition) = 0;
+    virtual Value visit(const ArrayDefinition &arrayDefinition) = 0;
 
-    virtual std::shared_ptr<Object> visit(const EntryDefinition &entryDefinition) = 0;
+    virtual Value visit(const EntryDefinition &entryDefinition) = 0;
 
-    virtual std::shared_ptr<Object> visit(const MapDefinition &mapDefinition) = 0;
+    virtual Value visit(const MapDefinition &mapDefinition) = 0;
 
-    virtual std::shared_ptr<Object> visit(const AccessorExpr &accessorExpr) = 0;
+    virtual Value visit(const AccessPath &access_path) = 0;
 
-    virtual std::shared_ptr<Object> visit(const GetterExpr &getter_expr) = 0;
+    virtual Value visit(const Call &call) = 0;
 
-    virtual std::shared_ptr<Object> visit(const SetterExpr &setter_expr) = 0;
+    virtual Value visit(const PrintStatement &printStatement) = 0;
 
-    virtual std::shared_ptr<Object> visit(const PrintStatement &printStatement) = 0;
+    virtual Value visit(const EmptyStatement &emptyStatement) = 0;
 
-    virtual std::shared_ptr<Object> visit(const EmptyStatement &emptyStatement) = 0;
+    virtual Value visit(const Program &program) = 0;
 
-    virtual std::shared_ptr<Object> visit(const Self &selfNode) = 0;
+    virtual Value visit(const Self &selfNode) = 0;
 };
 
 #endif //VISITOR_H
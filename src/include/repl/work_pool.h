@@ -0,0 +1,63 @@
+//
+// Created by mizuk on 2025/4/1.
+//
+
+#ifndef WORK_POOL_H
+#define WORK_POOL_H
+#include <atomic>
+#include <condition_variable>
+#include <cstddef>
+#include <deque>
+#include <functional>
+#include <memory>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+// Fixed set of threads running submitted tasks, each from a deque of its own.
+// A thread takes its newest task first, and when it has none steals the oldest
+// of another's, so work submitted in bulk to one thread, or from inside a
+// task, spreads over whichever threads are idle.
+class WorkStealingPool {
+    struct Queue {
+        std::mutex mutex;
+        std::deque<std::function<void()> > tasks;
+    };
+
+    std::vector<std::unique_ptr<Queue> > queues;
+    std::vector<std::thread> threads;
+    // tasks submitted and not yet taken, which idle threads sleep until
+    std::atomic<std::size_t> queued{0};
+    std::mutex idle_mutex;
+    std::condition_variable idle;
+    bool stopping{false};
+    // where the next task from outside the pool goes
+    std::atomic<std::size_t> next{0};
+    std::atomic<std::size_t> steal_count{0};
+
+    void run(std::size_t index);
+
+    // its own newest task, else another's oldest
+    bool take(std::size_t index, std::function<void()> &task);
+
+public:
+    explicit WorkStealingPool(std::size_t threads);
+
+    WorkStealingPool(const WorkStealingPool &) = delete;
+
+    WorkStealingPool &operator=(const WorkStealingPool &) = delete;
+
+    // Runs every task already submitted, then joins the threads.
+    ~WorkStealingPool();
+
+    // From one of the pool's own tasks, queues on that thread; from anywhere
+    // else, on each thread in turn.
+    void submit(std::function<void()> task);
+
+    [[nodiscard]] std::size_t size() const;
+
+    // tasks run by a thread other than the one they were queued on
+    [[nodiscard]] std::size_t steals() const;
+};
+
+#endif //WORK_POOL_H
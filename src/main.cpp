@@ -1,8 +1,74 @@
+#include <algorithm>
+#include <charconv>
+#include <cstring>
+#include <exception>
+#include <thread>
+#include <fmt/core.h>
+#include <repl/parse_cache.h>
 #include <repl/repl.h>
 
-int main() {
+static bool parseCount(const char *value, std::size_t &count) {
+    const auto *end = value + std::strlen(value);
+    const auto [ptr, ec] = std::from_chars(value, end, count);
+    return ec == std::errc() && ptr == end;
+}
+
+static int usage() {
+    fmt::println(stderr, "usage: repl [--cache <entries>] [--jobs <threads>] [--file <script> | --check <script>] "
+                 "[--serve <socket>]");
+    return -1;
+}
+
+int main(const int argc, char **argv) {
     try {
-        REPL::Start();
+        std::size_t cache_capacity = ParseCache::DEFAULT_CAPACITY;
+        // threads parsing a script ahead of the one running it
+        std::size_t jobs = REPL::ParseJobs();
+        const char *file = nullptr;
+        const char *check = nullptr;
+        const char *serve = nullptr;
+        for (int i = 1; i < argc; i += 2) {
+            if (i + 1 == argc) {
+                return usage();
+            }
+            const char *value = argv[i + 1];
+            if (std::strcmp(argv[i], "--cache") == 0) {
+                if (!parseCount(value, cache_capacity)) {
+                    return usage();
+                }
+            } else if (std::strcmp(argv[i], "--jobs") == 0) {
+                if (!parseCount(value, jobs)) {
+                    return usage();
+                }
+                // more threads than cores cannot parse any faster
+                jobs = std::min<std::size_t>(jobs, std::max(1u, std::thread::hardware_concurrency()));
+            } else if (std::strcmp(argv[i], "--file") == 0 && !check) {
+                file = value;
+            } else if (std::strcmp(argv[i], "--check") == 0 && !file && !serve) {
+                check = value;
+            } else if (std::strcmp(argv[i], "--serve") == 0 && !check) {
+                serve = value;
+            } else {
+                return usage();
+            }
+        }
+
+        if (check) {
+            return REPL::CheckFile(check) == 0 ? 0 : 1;
+        }
+        if (serve) {
+            // a script given with --file is loaded before the first client
+            REPL::Serve(serve, file ? file : "", cache_capacity);
+            return 0;
+        }
+        if (file) {
+            REPL::RunFile(file, cache_capacity, jobs);
+            return 0;
+        }
+        REPL::Start(cache_capacity);
+    } catch (const std::exception &error) {
+        fmt::println(stderr, "{}", error.what());
+        return -1;
     } catch (...) {
         return -1;
     }
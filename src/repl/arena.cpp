@@ -0,0 +1,72 @@
+//
+// Created by mizuk on 2025/3/10.
+//
+
+#include <algorithm>
+#include <stdexcept>
+#include <repl/arena.h>
+
+namespace {
+    thread_local AstArena *active_arena = nullptr;
+}
+
+void *AstArena::allocate(const std::size_t size, const std::size_t alignment) {
+    while (true) {
+        if (this->block_index < this->blocks.size()) {
+            auto &block = this->blocks[this->block_index];
+            const auto start = (this->offset + alignment - 1) / alignment * alignment;
+            if (start + size <= block.size) {
+                this->offset = start + size;
+                this->live++;
+                return block.memory.get() + start;
+            }
+            if (this->block_index + 1 < this->blocks.size()) {
+                this->block_index++;
+                this->offset = 0;
+                continue;
+            }
+        }
+        // out of reserved blocks: grow, doubling so big literals need few blocks
+        const auto previous = this->blocks.empty() ? 0 : this->blocks.back().size;
+        const auto block_size = std::max({BLOCK_SIZE, previous * 2, size + alignment});
+        this->blocks.push_back({std::make_unique<std::byte[]>(block_size), block_size});
+        this->block_index = this->blocks.size() - 1;
+        this->offset = 0;
+    }
+}
+
+void AstArena::deallocate() noexcept {
+    this->live--;
+}
+
+void AstArena::reset() {
+    if (this->live != 0) {
+        throw std::logic_error("AstArena reset while nodes are still alive");
+    }
+    this->block_index = 0;
+    this->offset = 0;
+}
+
+std::size_t AstArena::live_nodes() const {
+    return this->live;
+}
+
+std::size_t AstArena::reserved_bytes() const {
+    std::size_t total = 0;
+    for (const auto &block: this->blocks) {
+        total += block.size;
+    }
+    return total;
+}
+
+AstArena *AstArena::current() {
+    return active_arena;
+}
+
+AstArena::Scope::Scope(AstArena *arena) : previous(active_arena) {
+    active_arena = arena;
+}
+
+AstArena::Scope::~Scope() {
+    active_arena = this->previous;
+}
@@ -2,10 +2,41 @@
 // Created by mizuk on 2025/2/22.
 //
 
+#include <new>
+#include <repl/arena.h>
 #include <repl/ast.h>
 #include <repl/object.h>
 #include <repl/visitor.h>
 
+namespace {
+    // Prefixed to every node so delete knows where the memory came from.
+    struct alignas(std::max_align_t) NodeHeader {
+        AstArena *arena;
+    };
+}
+
+void *Expr::operator new(const std::size_t size) {
+    auto *arena = AstArena::current();
+    const auto total = sizeof(NodeHeader) + size;
+    void *memory = arena != nullptr
+                       ? arena->allocate(total, alignof(NodeHeader))
+                       : ::operator new(total);
+    auto *header = new(memory) NodeHeader{arena};
+    return header + 1;
+}
+
+void Expr::operator delete(void *ptr) noexcept {
+    if (ptr == nullptr) {
+        return;
+    }
+    auto *header = static_cast<NodeHeader *>(ptr) - 1;
+    if (header->arena != nullptr) {
+        header->arena->deallocate();
+        return;
+    }
+    ::operator delete(header);
+}
+
 bool Expr::operator!=(const Expr &other) const {
     return !(*this == other);
 }
@@ -78,27 +109,22 @@ bool MapDefinition::operator==(const Expr &other) const {
     return false;
 }
 
-bool AccessorExpr::operator==(const Expr &other) const {
-    if (const auto *accessor_expr = dynamic_cast<const AccessorExpr *>(&other)) {
-        return *instance == *accessor_expr->instance &&
-               *accessor == *accessor_expr->accessor;
-    }
-    return false;
-}
-
-bool GetterExpr::operator==(const Expr &other) const {
-    if (const auto *getter_expr = dynamic_cast<const GetterExpr *>(&other)) {
-        return *instance == *getter_expr->instance &&
-               *accessor == *getter_expr->accessor;
+bool AccessPath::operator==(const Expr &other) const {
+    if (const auto *access_path = dynamic_cast<const AccessPath *>(&other)) {
+        if (*root != *access_path->root || steps != access_path->steps) return false;
+        if (value == nullptr || access_path->value == nullptr) return value == access_path->value;
+        return *value == *access_path->value;
     }
     return false;
 }
 
-bool SetterExpr::operator==(const Expr &other) const {
-    if (const auto *setter_expr = dynamic_cast<const SetterExpr *>(&other)) {
-        return *instance == *setter_expr->instance &&
-               *accessor == *setter_expr->accessor &&
-               *value == *setter_expr->value;
+bool Call::operator==(const Expr &other) const {
+    if (const auto *call = dynamic_cast<const Call *>(&other)) {
+        if (name != call->name || arguments.size() != call->arguments.size()) return false;
+        for (std::size_t i = 0; i < arguments.size(); i++) {
+            if (*arguments[i] != *call->arguments[i]) return false;
+        }
+        return true;
     }
     return false;
 }
@@ -114,68 +140,79 @@ bool EmptyStatement::operator==(const Expr &other) const {
     return dynamic_cast<const EmptyStatement *>(&other) != nullptr;
 }
 
+bool Program::operator==(const Expr &other) const {
+    if (const auto *program = dynamic_cast<const Program *>(&other)) {
+        if (statements.size() != program->statements.size()) return false;
+        for (std::size_t i = 0; i < statements.size(); i++) {
+            if (*statements[i] != *program->statements[i]) return false;
+        }
+        return true;
+    }
+    return false;
+}
+
 bool Self::operator==(const Expr &other) const {
     return dynamic_cast<const Self *>(&other) != nullptr;
 }
 
 // New: Implementations of the accept method for each AST node
 
-std::shared_ptr<Object> NumberLiteral::accept(Visitor *visitor) const {
+Value NumberLiteral::accept(Visitor *visitor) const {
     return visitor->visit(*this);
 }
 
-std::shared_ptr<Object> NilLiteral::accept(Visitor *visitor) const {
+Value NilLiteral::accept(Visitor *visitor) const {
     return visitor->visit(*this);
 }
 
-std::shared_ptr<Object> Variable::accept(Visitor *visitor) const {
+Value Variable::accept(Visitor *visitor) const {
     return visitor->visit(*this);
 }
 
-std::shared_ptr<Object> Symbol::accept(Visitor *visitor) const {
+Value Symbol::accept(Visitor *visitor) const {
     return visitor->visit(*this);
 }
 
-std::shared_ptr<Object> Assignment::accept(Visitor *visitor) const {
+Value Assignment::accept(Visitor *visitor) const {
     return visitor->visit(*this);
 }
 
-std::shared_ptr<Object> Declaration::accept(Visitor *visitor) const {
+Value Declaration::accept(Visitor *visitor) const {
     return visitor->visit(*this);
 }
 
-std::shared_ptr<Object> ArrayDefinition::accept(Visitor *visitor) const {
+Value ArrayDefinition::accept(Visitor *visitor) const {
     return visitor->visit(*this);
 }
 
-std::shared_ptr<Object> EntryDefinition::accept(Visitor *visitor) const {
+Value EntryDefinition::accept(Visitor *visitor) const {
     return visitor->visit(*this);
 }
 
-std::shared_ptr<Object> MapDefinition::accept(Visitor *visitor) const {
+Value MapDefinition::accept(Visitor *visitor) const {
     return visitor->visit(*this);
 }
 
-std::shared_ptr<Object> AccessorExpr::accept(Visitor *visitor) const {
+Value AccessPath::accept(Visitor *visitor) const {
     return visitor->visit(*this);
 }
 
-std::shared_ptr<Object> GetterExpr::accept(Visitor *visitor) const {
+Value Call::accept(Visitor *visitor) const {
     return visitor->visit(*this);
 }
 
-std::shared_ptr<Object> SetterExpr::accept(Visitor *visitor) const {
+Value PrintStatement::accept(Visitor *visitor) const {
     return visitor->visit(*this);
 }
 
-std::shared_ptr<Object> PrintStatement::accept(Visitor *visitor) const {
+Value EmptyStatement::accept(Visitor *visitor) const {
     return visitor->visit(*this);
 }
 
-std::shared_ptr<Object> EmptyStatement::accept(Visitor *visitor) const {
+Value Program::accept(Visitor *visitor) const {
     return visitor->visit(*this);
 }
 
-std::shared_ptr<Object> Self::accept(Visitor *visitor) const {
+Value Self::accept(Visitor *visitor) const {
     return visitor->visit(*this);
 }
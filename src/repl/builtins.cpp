@@ -0,0 +1,150 @@
+//
+// Created by mizuk on 2025/3/22.
+//
+
+#include <algorithm>
+#include <array>
+#include <functional>
+#include <limits>
+#include <stdexcept>
+#include <repl/builtins.h>
+#include <repl/clones.h>
+#include <repl/interpreter.h>
+#include <repl/kernels.h>
+#include <repl/object.h>
+
+namespace {
+    constexpr std::array<std::string_view, 7> BUILTIN_NAMES = {"len", "sum", "min", "max", "find", "fill", "clone"};
+
+    constexpr std::size_t arity(const Builtin builtin) {
+        return builtin == Builtin::FIND || builtin == Builtin::FILL ? 2 : 1;
+    }
+
+    Array &arrayArgument(const Value &value) {
+        auto *array = value.as<Array>();
+        if (array == nullptr) {
+            throw InterpreterError(InterpretErrorType::INVALID_ARGUMENTS);
+        }
+        return *array;
+    }
+
+    // The array's numbers, packed; a generic array only qualifies when every
+    // element is a number, and is then scanned through a temporary copy.
+    std::vector<std::int32_t> numbersOf(Array &array) {
+        auto numbers = std::vector<std::int32_t>();
+        numbers.reserve(array.size());
+        array.forEachElementChunk([&](const std::span<const Value> elements) {
+            for (const auto &element: elements) {
+                if (!element.isNumber()) {
+                    throw InterpreterError(InterpretErrorType::INVALID_ARGUMENTS);
+                }
+                numbers.push_back(element.asNumber());
+            }
+        });
+        return numbers;
+    }
+
+    // Runs `kernel` over each chunk of the array's numbers and folds the
+    // results with `combine`; a chunk is never empty.
+    template<typename Kernel, typename Combine>
+    auto scan(Array &array, Kernel kernel, Combine combine) {
+        if (!array.packed()) {
+            const auto numbers = numbersOf(array);
+            return kernel(std::span<const std::int32_t>(numbers));
+        }
+        auto result = std::optional<decltype(kernel(std::span<const std::int32_t>()))>();
+        array.forEachPackedChunk([&](const std::span<const std::int32_t> numbers) {
+            const auto chunk = kernel(numbers);
+            result = result ? combine(*result, chunk) : chunk;
+        });
+        return *result;
+    }
+}
+
+std::optional<Builtin> findBuiltin(const Atom name) {
+    for (std::size_t i = 0; i < BUILTIN_NAMES.size(); i++) {
+        if (name.str() == BUILTIN_NAMES[i]) {
+            return static_cast<Builtin>(i);
+        }
+    }
+    return std::nullopt;
+}
+
+std::string_view toString(const Builtin builtin) {
+    return BUILTIN_NAMES[static_cast<std::size_t>(builtin)];
+}
+
+Value callBuiltin(const Builtin builtin, const std::span<const Value> arguments) {
+    if (arguments.size() != arity(builtin)) {
+        throw InterpreterError(InterpretErrorType::INVALID_ARGUMENTS);
+    }
+    if (builtin == Builtin::LEN) {
+        if (const auto *map = arguments[0].as<Map>()) {
+            return Value::number(static_cast<int>(map->size()));
+        }
+    }
+    if (builtin == Builtin::CLONE) {
+        return Clones::clone(arguments[0]);
+    }
+    auto &array = arrayArgument(arguments[0]);
+    switch (builtin) {
+        case Builtin::LEN:
+            return Value::number(static_cast<int>(array.size()));
+        case Builtin::SUM: {
+            if (array.size() == 0) {
+                return Value::number(0);
+            }
+            const auto total = scan(array, kernels::sum, std::plus());
+            if (total < std::numeric_limits<int>::min() || total > std::numeric_limits<int>::max()) {
+                throw std::out_of_range(fmt::format("Sum {} out of range", total));
+            }
+            return Value::number(static_cast<int>(total));
+        }
+        case Builtin::MIN:
+            return array.size() == 0 ? Value::nil() : Value::number(scan(array, kernels::min, [](const std::int32_t a, const std::int32_t b) {
+                                                           return std::min(a, b);
+                                                       }));
+        case Builtin::MAX:
+            return array.size() == 0 ? Value::nil() : Value::number(scan(array, kernels::max, [](const std::int32_t a, const std::int32_t b) {
+                                                           return std::max(a, b);
+                                                       }));
+        case Builtin::FIND: {
+            const auto &needle = arguments[1];
+            if (array.packed()) {
+                if (!needle.isNumber()) {
+                    return Value::nil();
+                }
+                // the chunks in order, stopping at the first with a match
+                auto offset = std::size_t{0};
+                auto found = false;
+                array.forEachPackedChunk([&](const std::span<const std::int32_t> numbers) {
+                    if (found) {
+                        return;
+                    }
+                    const auto index = kernels::find(numbers, needle.asNumber());
+                    found = index != numbers.size();
+                    offset += index;
+                });
+                return found ? Value::number(static_cast<int>(offset)) : Value::nil();
+            }
+            auto index = std::size_t{0};
+            auto found = false;
+            array.forEachElementChunk([&](const std::span<const Value> elements) {
+                if (found) {
+                    return;
+                }
+                const auto match = std::ranges::find(elements, needle);
+                found = match != elements.end();
+                index += static_cast<std::size_t>(match - elements.begin());
+            });
+            return found ? Value::number(static_cast<int>(index)) : Value::nil();
+        }
+        case Builtin::FILL:
+            array.fill(arguments[1]);
+            return arguments[0];
+        case Builtin::CLONE:
+            // takes any value, so handled before the array is looked for
+            break;
+    }
+    throw std::logic_error("Unknown builtin");
+}
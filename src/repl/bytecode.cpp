@@ -0,0 +1,362 @@
+//
+// Created by mizuk on 2025/3/16.
+//
+
+#include <algorithm>
+#include <array>
+#include <bit>
+#include <cstring>
+#include <string_view>
+#include <stdexcept>
+#include <fmt/format.h>
+#include <repl/bytecode.h>
+#include <repl/interpreter.h>
+#include <repl/object.h>
+
+namespace {
+    constexpr std::array<std::string_view, OPCODE_COUNT> OPCODE_NAMES = {
+#define REPL_OPCODE_NAME(name, width) #name,
+        REPL_OPCODES(REPL_OPCODE_NAME)
+#undef REPL_OPCODE_NAME
+    };
+
+    constexpr std::array<std::uint8_t, OPCODE_COUNT> OPCODE_WIDTHS = {
+#define REPL_OPCODE_WIDTH(name, width) width,
+        REPL_OPCODES(REPL_OPCODE_WIDTH)
+#undef REPL_OPCODE_WIDTH
+    };
+}
+
+std::uint32_t InlineCache::miss(const Shape *shape) {
+    this->misses++;
+    const auto offset = shape->offset(this->key);
+    if (!offset) {
+        throw std::out_of_range(fmt::format("Key {} not found", this->key.str()));
+    }
+    // a dictionary may be freed and its address reused by another
+    if (shape->dictionary()) {
+        return *offset;
+    }
+    if (this->used < WAYS) {
+        this->entries[this->used++] = {shape, *offset};
+    } else {
+        this->megamorphic = true;
+    }
+    return *offset;
+}
+
+std::string InlineCache::state() const {
+    if (this->megamorphic) {
+        return "megamorphic";
+    }
+    switch (this->used) {
+        case 0:
+            return "uninitialized";
+        case 1:
+            return "monomorphic";
+        default:
+            return "polymorphic";
+    }
+}
+
+void Chunk::emit(const OpCode op) {
+    this->code.push_back(static_cast<std::uint8_t>(op));
+}
+
+void Chunk::emit(const OpCode op, const std::uint32_t operand) {
+    this->emit(op);
+    const auto offset = this->code.size();
+    this->code.resize(offset + sizeof(operand));
+    std::memcpy(this->code.data() + offset, &operand, sizeof(operand));
+}
+
+std::uint32_t Chunk::operand(const std::size_t offset) const {
+    std::uint32_t operand;
+    std::memcpy(&operand, this->code.data() + offset, sizeof(operand));
+    return operand;
+}
+
+Compiler::Compiler(Globals &globals) : globals(globals) {
+    this->chunk.globals = &globals;
+}
+
+Chunk Compiler::compile(const FlatAst &ast, const NodeIndex node, Globals &globals) {
+    Compiler compiler(globals);
+    compiler.lower(ast, node);
+    compiler.emit(OpCode::RETURN, -1);
+    return std::move(compiler.chunk);
+}
+
+void Compiler::emit(const OpCode op, const int effect) {
+    this->chunk.emit(op);
+    this->depth += effect;
+    this->chunk.max_stack = std::max(this->chunk.max_stack, this->depth);
+}
+
+void Compiler::emit(const OpCode op, const std::uint32_t operand, const int effect) {
+    this->chunk.emit(op, operand);
+    this->depth += effect;
+    this->chunk.max_stack = std::max(this->chunk.max_stack, this->depth);
+}
+
+std::uint32_t Compiler::cacheSite(const Atom key) {
+    this->chunk.caches.emplace_back(key);
+    return static_cast<std::uint32_t>(this->chunk.caches.size() - 1);
+}
+
+std::optional<std::uint32_t> Compiler::hoist(const FlatAst &ast, const NodeIndex node) {
+    const auto is_map = ast.kind(node) == NodeKind::MAP;
+    const auto children = ast.childrenOf(node);
+    if (children.size() > MAX_HOISTED_ELEMENTS) {
+        return std::nullopt;
+    }
+    auto keys = std::vector<Atom>();
+    auto elements = std::vector<Value>();
+    elements.reserve(children.size());
+    for (const auto child: children) {
+        const auto element = is_map ? ast.child(child, 1) : child;
+        switch (ast.kind(element)) {
+            case NodeKind::NUMBER:
+                elements.push_back(Value::number(ast.number(element)));
+                break;
+            case NodeKind::NIL:
+                elements.push_back(Value::nil());
+                break;
+            default:
+                return std::nullopt;
+        }
+        if (is_map) {
+            keys.push_back(ast.atom(ast.child(child, 0)));
+        }
+    }
+
+    // as MAKE_MAP lays them out: by offset, a repeated key keeping its
+    // first value. Only with a shape from the tree, as the key below names
+    // the shape by its address.
+    const auto *shape = is_map ? Shape::shared(keys) : nullptr;
+    if (is_map && shape == nullptr) {
+        return std::nullopt;
+    }
+    if (is_map && shape->size() != keys.size()) {
+        auto values = std::vector<Value>(shape->size());
+        for (std::size_t i = 0; i < keys.size(); i++) {
+            auto &value = values[*shape->offset(keys[i])];
+            if (!value) {
+                value = elements[i];
+            }
+        }
+        elements = std::move(values);
+    }
+
+    // the layout and each element, so equal literals share one constant
+    auto key = std::string(is_map ? "m" : "a");
+    key.append(reinterpret_cast<const char *>(&shape), sizeof(shape));
+    for (const auto &element: elements) {
+        const auto number = element.isNumber() ? element.asNumber() : 0;
+        key.push_back(element.isNumber() ? 'n' : '_');
+        key.append(reinterpret_cast<const char *>(&number), sizeof(number));
+    }
+    if (const auto found = this->globals.find_constant(key)) {
+        return found;
+    }
+    auto constant = is_map
+                        ? Value::make<Map>(shape, std::move(elements))
+                        : Value::make<Array>(std::move(elements));
+    return this->globals.add_constant(std::move(key), std::move(constant));
+}
+
+void Compiler::lower(const FlatAst &ast, const NodeIndex node) {
+    switch (ast.kind(node)) {
+        case NodeKind::NUMBER:
+            this->emit(OpCode::PUSH_INT, ast.operand(node), 1);
+            return;
+        case NodeKind::NIL:
+        case NodeKind::EMPTY:
+        case NodeKind::SELF:
+            this->emit(OpCode::PUSH_NIL, 1);
+            return;
+        case NodeKind::VARIABLE:
+            this->emit(OpCode::LOAD_GLOBAL, this->globals.resolve(ast.atom(node)), 1);
+            return;
+        case NodeKind::ASSIGNMENT: {
+            const auto slot = this->globals.resolve(ast.atom(ast.child(node, 0)));
+            this->emit(OpCode::CHECK_DEFINED, slot, 0);
+            this->lower(ast, ast.child(node, 1));
+            this->emit(OpCode::STORE_GLOBAL, slot, 0);
+            return;
+        }
+        case NodeKind::DECLARATION: {
+            const auto slot = this->globals.resolve(ast.atom(ast.child(node, 0)));
+            this->emit(OpCode::CHECK_UNDEFINED, slot, 0);
+            this->lower(ast, ast.child(node, 1));
+            this->emit(OpCode::DEFINE_GLOBAL, slot, 0);
+            return;
+        }
+        case NodeKind::ARRAY: {
+            if (const auto constant = this->hoist(ast, node)) {
+                this->emit(OpCode::COPY_ARRAY, *constant, 1);
+                return;
+            }
+            const auto elements = ast.childrenOf(node);
+            for (const auto element: elements) {
+                this->lower(ast, element);
+            }
+            const auto count = static_cast<std::uint32_t>(elements.size());
+            this->emit(OpCode::MAKE_ARRAY, count, 1 - static_cast<int>(count));
+            return;
+        }
+        case NodeKind::MAP: {
+            if (const auto constant = this->hoist(ast, node)) {
+                this->emit(OpCode::COPY_MAP, *constant, 1);
+                return;
+            }
+            const auto entries = ast.childrenOf(node);
+            auto keys = std::vector<Atom>();
+            keys.reserve(entries.size());
+            for (const auto entry: entries) {
+                keys.push_back(ast.atom(ast.child(entry, 0)));
+                this->lower(ast, ast.child(entry, 1));
+            }
+            const auto list = static_cast<std::uint32_t>(this->chunk.key_lists.size());
+            this->chunk.shapes.push_back(Shape::shared(keys));
+            this->chunk.key_lists.push_back(std::move(keys));
+            this->emit(OpCode::MAKE_MAP, list, 1 - static_cast<int>(entries.size()));
+            return;
+        }
+        case NodeKind::ACCESS_PATH: {
+            // children: root variable, one NUMBER or SYMBOL per step, then the
+            // value if this is a store
+            const auto nodes = ast.childrenOf(node);
+            const auto step_count = ast.operand(node);
+            const auto is_store = nodes.size() > step_count + 1;
+            this->emit(OpCode::LOAD_GLOBAL, this->globals.resolve(ast.atom(nodes[0])), 1);
+            const auto walked = is_store ? step_count - 1 : step_count;
+            for (std::uint32_t i = 1; i <= walked; i++) {
+                if (ast.kind(nodes[i]) == NodeKind::NUMBER) {
+                    this->emit(OpCode::GET_INDEX, ast.operand(nodes[i]), 0);
+                } else {
+                    this->emit(OpCode::GET_KEY, this->cacheSite(ast.atom(nodes[i])), 0);
+                }
+            }
+            if (is_store) {
+                const auto last = nodes[step_count];
+                this->lower(ast, nodes.back());
+                if (ast.kind(last) == NodeKind::NUMBER) {
+                    this->emit(OpCode::SET_INDEX, ast.operand(last), -1);
+                } else {
+                    this->emit(OpCode::SET_KEY, this->cacheSite(ast.atom(last)), -1);
+                }
+            }
+            return;
+        }
+        case NodeKind::CALL: {
+            const auto arguments = ast.childrenOf(node);
+            for (const auto argument: arguments) {
+                this->lower(ast, argument);
+            }
+            const auto name = ast.atom(node);
+            const auto count = static_cast<std::uint32_t>(arguments.size());
+            const auto site = static_cast<std::uint32_t>(this->chunk.calls.size());
+            this->chunk.calls.push_back({name, findBuiltin(name), count});
+            this->emit(OpCode::CALL, site, 1 - static_cast<int>(count));
+            return;
+        }
+        case NodeKind::PRINT:
+            this->lower(ast, ast.child(node, 0));
+            this->emit(OpCode::PRINT, 0);
+            return;
+        case NodeKind::PROGRAM: {
+            const auto statements = ast.childrenOf(node);
+            if (statements.empty()) {
+                this->emit(OpCode::PUSH_NIL, 1);
+                return;
+            }
+            for (std::size_t i = 0; i < statements.size(); i++) {
+                if (i > 0) {
+                    this->emit(OpCode::POP, -1);
+                }
+                this->lower(ast, statements[i]);
+            }
+            return;
+        }
+        case NodeKind::SYMBOL:
+        case NodeKind::ENTRY:
+            throw std::logic_error("Not implemented");
+    }
+    throw std::logic_error("Unknown node kind");
+}
+
+std::string toString(const OpCode op) {
+    return std::string(OPCODE_NAMES[static_cast<std::size_t>(op)]);
+}
+
+std::string disassemble(const Chunk &chunk) {
+    std::string text;
+    std::size_t offset = 0;
+    while (offset < chunk.code.size()) {
+        const auto op = static_cast<OpCode>(chunk.code[offset]);
+        text += fmt::format("{:04} {}", offset, toString(op));
+        if (OPCODE_WIDTHS[static_cast<std::size_t>(op)] != 0) {
+            const auto operand = chunk.operand(offset + 1);
+            switch (op) {
+                case OpCode::PUSH_INT:
+                case OpCode::GET_INDEX:
+                case OpCode::SET_INDEX:
+                    text += fmt::format(" {}", std::bit_cast<int>(operand));
+                    break;
+                case OpCode::LOAD_GLOBAL:
+                case OpCode::CHECK_DEFINED:
+                case OpCode::CHECK_UNDEFINED:
+                case OpCode::STORE_GLOBAL:
+                case OpCode::DEFINE_GLOBAL:
+                    text += fmt::format(" #{} {}", operand, chunk.globals->name(operand).str());
+                    break;
+                case OpCode::MAKE_ARRAY:
+                    text += fmt::format(" {}", operand);
+                    break;
+                case OpCode::COPY_ARRAY:
+                case OpCode::COPY_MAP:
+                    text += fmt::format(" #{} {}", operand, chunk.globals->constant(operand).toString());
+                    break;
+                case OpCode::MAKE_MAP: {
+                    text += " {";
+                    const auto &keys = chunk.key_lists[operand];
+                    for (std::size_t i = 0; i < keys.size(); i++) {
+                        text += fmt::format("{}{}", i > 0 ? ", " : "", keys[i].str());
+                    }
+                    text += "}";
+                    break;
+                }
+                case OpCode::GET_KEY:
+                case OpCode::SET_KEY:
+                    text += fmt::format(" {}", chunk.caches[operand].key.str());
+                    break;
+                case OpCode::CALL: {
+                    const auto &call = chunk.calls[operand];
+                    text += fmt::format(" {}/{}", call.name.str(), call.argument_count);
+                    break;
+                }
+                default:
+                    break;
+            }
+        }
+        text += '\n';
+        offset += 1 + OPCODE_WIDTHS[static_cast<std::size_t>(op)];
+    }
+    return text;
+}
+
+std::string describeCaches(const Chunk &chunk) {
+    std::string text;
+    std::size_t offset = 0;
+    while (offset < chunk.code.size()) {
+        const auto op = static_cast<OpCode>(chunk.code[offset]);
+        if (op == OpCode::GET_KEY || op == OpCode::SET_KEY) {
+            const auto &site = chunk.caches[chunk.operand(offset + 1)];
+            text += fmt::format("{:04} {} {}: {} hits, {} misses, {}\n", offset, toString(op), site.key.str(),
+                                site.hits, site.misses, site.state());
+        }
+        offset += 1 + OPCODE_WIDTHS[static_cast<std::size_t>(op)];
+    }
+    return text;
+}
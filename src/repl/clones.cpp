@@ -0,0 +1,109 @@
+//
+// Created by mizuk on 2025/3/27.
+//
+
+#include <map>
+#include <utility>
+#include <repl/clones.h>
+
+namespace {
+    // The instants of the live lineage links, with how many links there are
+    // of each. Never destroyed, like the heap, since statics may still hold
+    // clones after thread_local destructors have run.
+    thread_local std::map<std::uint64_t, std::size_t> *live = nullptr;
+
+    // the last tag handed out
+    thread_local std::uint64_t last_tag = 0;
+
+    std::map<std::uint64_t, std::size_t> &liveInstants() {
+        if (live == nullptr) [[unlikely]] {
+            live = new std::map<std::uint64_t, std::size_t>();
+        }
+        return *live;
+    }
+
+    // `item` as the clone with the lineage from `link` down sees it, in a leaf
+    // owned by `owner`: as the link copying `owner`, or the oldest link, saw
+    // it, then copied again by each link above
+    Value view(const CloneLineage &link, const std::uint64_t owner, const Value &item) {
+        if (link.parent == nullptr || link.tag == owner) {
+            return CloneFamily::copy(link.family, item, link.instant);
+        }
+        return CloneFamily::copy(link.family, view(*link.parent, owner, item), link.instant);
+    }
+}
+
+CloneLineage::CloneLineage(const std::uint64_t tag, const std::uint64_t instant, std::shared_ptr<CloneFamily> family,
+                           std::shared_ptr<const CloneLineage> parent)
+    : tag(tag), instant(instant), family(std::move(family)), parent(std::move(parent)) {
+    auto &instants = liveInstants();
+    instants[instant]++;
+    Clones::seen = instants.rbegin()->first;
+}
+
+CloneLineage::~CloneLineage() {
+    auto &instants = liveInstants();
+    const auto found = instants.find(this->instant);
+    if (--found->second == 0) {
+        instants.erase(found);
+    }
+    Clones::seen = instants.empty() ? 0 : instants.rbegin()->first;
+}
+
+CloneOrigin::CloneOrigin(std::shared_ptr<const CloneLineage> lineage, Value source)
+    : tag(Clones::tag()), lineage(std::move(lineage)), source(std::move(source)) {
+}
+
+CloneOrigin::~CloneOrigin() {
+    this->lineage->family->forget(this->source.object(), this->lineage->instant);
+}
+
+Value CloneFamily::copy(const std::shared_ptr<CloneFamily> &family, const Value &value, const std::uint64_t instant) {
+    auto *object = value.object();
+    if (object == nullptr) {
+        return value;
+    }
+    const auto key = Key{object, instant};
+    if (const auto found = family->copies.find(key); found != family->copies.end()) {
+        return Value(found->second);
+    }
+    auto *copy = object->cloneAt(instant, family);
+    if (copy == nullptr) {
+        return value;
+    }
+    family->copies.try_emplace(key, copy);
+    return Value(copy);
+}
+
+void CloneFamily::forget(const Object *object, const std::uint64_t instant) {
+    this->copies.erase(Key{object, instant});
+}
+
+bool Clones::watched(const std::uint64_t after, const std::uint64_t until) {
+    const auto &instants = liveInstants();
+    const auto found = instants.upper_bound(after);
+    return found != instants.end() && found->first <= until;
+}
+
+Value Clones::clone(const Value &value) {
+    return CloneFamily::copy(std::make_shared<CloneFamily>(), value, ++clock);
+}
+
+std::uint64_t Clones::tag() {
+    return ++last_tag;
+}
+
+std::shared_ptr<const CloneLineage> Clones::lineage(const CloneOrigin *origin, const std::uint64_t instant,
+                                                    const std::shared_ptr<CloneFamily> &family) {
+    if (origin == nullptr) {
+        return std::make_shared<const CloneLineage>(0, instant, family, nullptr);
+    }
+    return std::make_shared<const CloneLineage>(origin->tag, instant, family, origin->lineage);
+}
+
+Value Clones::resolve(const CloneOrigin &origin, const std::uint64_t owner, const Value &item) {
+    if (!item.isObject()) {
+        return item;
+    }
+    return view(*origin.lineage, owner, item);
+}
@@ -0,0 +1,211 @@
+//
+// Created by mizuk on 2025/3/11.
+//
+
+#include <bit>
+#include <stdexcept>
+#include <repl/ast.h>
+#include <repl/flat_ast.h>
+#include <repl/object.h>
+#include <repl/visitor.h>
+
+namespace {
+    // Walks a pointer tree through the existing double dispatch and appends
+    // each node after its children. `last` is the index of the node just added.
+    class FlatAstBuilder final : public Visitor {
+    public:
+        FlatAst ast;
+        NodeIndex last{0};
+
+        NodeIndex lower(const Expr &expr) {
+            expr.accept(this);
+            return this->last;
+        }
+
+        Value visit(const Expr &expr) override {
+            return expr.accept(this);
+        }
+
+        Value visit(const NumberLiteral &numberLiteral) override {
+            this->last = this->ast.add(NodeKind::NUMBER, std::bit_cast<std::uint32_t>(numberLiteral.value), {});
+            return {};
+        }
+
+        Value visit(const NilLiteral &nilLiteral) override {
+            this->last = this->ast.add(NodeKind::NIL, 0, {});
+            return {};
+        }
+
+        Value visit(const Variable &variable) override {
+            this->last = this->ast.add(NodeKind::VARIABLE, variable.name.id(), {});
+            return {};
+        }
+
+        Value visit(const Symbol &symbol) override {
+            this->last = this->ast.add(NodeKind::SYMBOL, symbol.name.id(), {});
+            return {};
+        }
+
+        Value visit(const Assignment &assignment) override {
+            const NodeIndex nodes[] = {this->lower(*assignment.lhs), this->lower(*assignment.rhs)};
+            this->last = this->ast.add(NodeKind::ASSIGNMENT, 0, nodes);
+            return {};
+        }
+
+        Value visit(const Declaration &declaration) override {
+            const NodeIndex nodes[] = {this->lower(*declaration.lhs), this->lower(*declaration.rhs)};
+            this->last = this->ast.add(NodeKind::DECLARATION, 0, nodes);
+            return {};
+        }
+
+        Value visit(const ArrayDefinition &arrayDefinition) override {
+            auto nodes = std::vector<NodeIndex>();
+            nodes.reserve(arrayDefinition.elements.size());
+            for (const auto &element: arrayDefinition.elements) {
+                nodes.push_back(this->lower(*element));
+            }
+            this->last = this->ast.add(NodeKind::ARRAY, 0, nodes);
+            return {};
+        }
+
+        Value visit(const EntryDefinition &entryDefinition) override {
+            const NodeIndex nodes[] = {this->lower(*entryDefinition.key), this->lower(*entryDefinition.value)};
+            this->last = this->ast.add(NodeKind::ENTRY, 0, nodes);
+            return {};
+        }
+
+        Value visit(const MapDefinition &mapDefinition) override {
+            auto nodes = std::vector<NodeIndex>();
+            nodes.reserve(mapDefinition.entries.size());
+            for (const auto &entry: mapDefinition.entries) {
+                nodes.push_back(this->lower(*entry));
+            }
+            this->last = this->ast.add(NodeKind::MAP, 0, nodes);
+            return {};
+        }
+
+        Value visit(const AccessPath &access_path) override {
+            auto nodes = std::vector<NodeIndex>();
+            nodes.reserve(access_path.steps.size() + 2);
+            nodes.push_back(this->lower(*access_path.root));
+            for (const auto &step: access_path.steps) {
+                if (std::holds_alternative<int>(step)) {
+                    nodes.push_back(this->ast.add(NodeKind::NUMBER, std::bit_cast<std::uint32_t>(std::get<int>(step)), {}));
+                } else {
+                    nodes.push_back(this->ast.add(NodeKind::SYMBOL, std::get<Atom>(step).id(), {}));
+                }
+            }
+            if (access_path.value) {
+                nodes.push_back(this->lower(*access_path.value));
+            }
+            const auto step_count = static_cast<std::uint32_t>(access_path.steps.size());
+            this->last = this->ast.add(NodeKind::ACCESS_PATH, step_count, nodes);
+            return {};
+        }
+
+        Value visit(const Call &call) override {
+            auto nodes = std::vector<NodeIndex>();
+            nodes.reserve(call.arguments.size());
+            for (const auto &argument: call.arguments) {
+                nodes.push_back(this->lower(*argument));
+            }
+            this->last = this->ast.add(NodeKind::CALL, call.name.id(), nodes);
+            return {};
+        }
+
+        Value visit(const PrintStatement &printStatement) override {
+            const NodeIndex nodes[] = {this->lower(*printStatement.rhs)};
+            this->last = this->ast.add(NodeKind::PRINT, 0, nodes);
+            return {};
+        }
+
+        Value visit(const EmptyStatement &emptyStatement) override {
+            this->last = this->ast.add(NodeKind::EMPTY, 0, {});
+            return {};
+        }
+
+        Value visit(const Program &program) override {
+            auto nodes = std::vector<NodeIndex>();
+            nodes.reserve(program.statements.size());
+            for (const auto &statement: program.statements) {
+                nodes.push_back(this->lower(*statement));
+            }
+            this->last = this->ast.add(NodeKind::PROGRAM, 0, nodes);
+            return {};
+        }
+
+        Value visit(const Self &selfNode) override {
+            this->last = this->ast.add(NodeKind::SELF, 0, {});
+            return {};
+        }
+    };
+
+    // FNV-1a style mixing, one array element at a time
+    template<typename T>
+    std::uint64_t hashArray(std::uint64_t hash, const std::vector<T> &values) {
+        for (const auto value: values) {
+            hash = (hash ^ static_cast<std::uint64_t>(value)) * 0x100000001b3ULL;
+        }
+        return (hash ^ values.size()) * 0x100000001b3ULL;
+    }
+}
+
+FlatAst FlatAst::from(const Expr &expr) {
+    FlatAstBuilder builder;
+    builder.lower(expr);
+    return std::move(builder.ast);
+}
+
+NodeIndex FlatAst::add(const NodeKind kind, const std::uint32_t operand, const std::span<const NodeIndex> node_children) {
+    const auto node = static_cast<NodeIndex>(this->kinds.size());
+    this->kinds.push_back(kind);
+    this->operands.push_back(operand);
+    this->children.insert(this->children.end(), node_children.begin(), node_children.end());
+    this->first_child.push_back(static_cast<std::uint32_t>(this->children.size()));
+    return node;
+}
+
+NodeIndex FlatAst::root() const {
+    if (this->kinds.empty()) {
+        throw std::logic_error("Empty FlatAst has no root");
+    }
+    return static_cast<NodeIndex>(this->kinds.size() - 1);
+}
+
+std::size_t FlatAst::size() const {
+    return this->kinds.size();
+}
+
+NodeKind FlatAst::kind(const NodeIndex node) const {
+    return this->kinds[node];
+}
+
+std::uint32_t FlatAst::operand(const NodeIndex node) const {
+    return this->operands[node];
+}
+
+int FlatAst::number(const NodeIndex node) const {
+    return std::bit_cast<int>(this->operands[node]);
+}
+
+Atom FlatAst::atom(const NodeIndex node) const {
+    return Atom::fromId(this->operands[node]);
+}
+
+std::span<const NodeIndex> FlatAst::childrenOf(const NodeIndex node) const {
+    const auto begin = this->first_child[node];
+    return {this->children.data() + begin, this->first_child[node + 1] - begin};
+}
+
+NodeIndex FlatAst::child(const NodeIndex node, const std::uint32_t index) const {
+    return this->children[this->first_child[node] + index];
+}
+
+std::uint64_t FlatAst::hash() const {
+    auto hash = 0xcbf29ce484222325ULL;
+    hash = hashArray(hash, this->kinds);
+    hash = hashArray(hash, this->operands);
+    hash = hashArray(hash, this->first_child);
+    hash = hashArray(hash, this->children);
+    return hash;
+}
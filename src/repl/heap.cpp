@@ -0,0 +1,203 @@
+//
+// Created by mizuk on 2025/3/23.
+//
+
+#include <algorithm>
+#include <memory>
+#include <fmt/format.h>
+#include <repl/heap.h>
+#include <repl/value.h>
+
+namespace {
+    // Constant-initialized, so reading it needs no guard; the heap is
+    // created on a thread's first object and never destroyed, since statics
+    // may still hold objects after thread_local destructors have run.
+    thread_local Heap *current = nullptr;
+}
+
+Object::Object() {
+    Heap::local().add(this);
+}
+
+Object::Object(const Object &) {
+    Heap::local().add(this);
+}
+
+Object::~Object() {
+    Heap::local().remove(this);
+}
+
+void *Object::operator new(const std::size_t size) {
+    auto &heap = Heap::local();
+    heap.stats.bytes += size;
+    if (auto *pool = heap.poolFor(size)) {
+        return pool->allocate();
+    }
+    return ::operator new(size);
+}
+
+void Object::operator delete(void *pointer, const std::size_t size) {
+    auto &heap = Heap::local();
+    heap.stats.bytes -= size;
+    if (auto *pool = heap.poolFor(size)) {
+        pool->deallocate(pointer);
+        return;
+    }
+    ::operator delete(pointer, size);
+}
+
+void *Heap::allocate(const std::size_t size) {
+    if (auto *pool = local().poolFor(size)) {
+        return pool->allocate();
+    }
+    return ::operator new(size);
+}
+
+void Heap::deallocate(void *pointer, const std::size_t size) {
+    if (auto *pool = local().poolFor(size)) {
+        pool->deallocate(pointer);
+        return;
+    }
+    ::operator delete(pointer, size);
+}
+
+Heap::Heap() {
+    this->pools.reserve(MAX_POOLED_SIZE / 16);
+    for (std::size_t size = 16; size <= MAX_POOLED_SIZE; size += 16) {
+        this->pools.emplace_back(size);
+    }
+}
+
+SlabPool *Heap::poolFor(const std::size_t size) {
+    return size <= MAX_POOLED_SIZE ? &this->pools[(size - 1) / 16] : nullptr;
+}
+
+Heap &Heap::local() {
+    if (current == nullptr) [[unlikely]] {
+        current = new Heap();
+    }
+    return *current;
+}
+
+void Heap::add(Object *object) {
+    object->heap_index = static_cast<std::uint32_t>(this->objects.size());
+    this->objects.push_back(object);
+}
+
+void Heap::remove(Object *object) {
+    auto *last = this->objects.back();
+    last->heap_index = object->heap_index;
+    this->objects[object->heap_index] = last;
+    this->objects.pop_back();
+}
+
+std::size_t Heap::collect() {
+    const auto start = std::chrono::steady_clock::now();
+    const auto count = this->objects.size();
+
+    // references from outside the heap: the count minus those from objects
+    auto external = std::vector<std::int64_t>(count);
+    for (std::size_t i = 0; i < count; i++) {
+        external[i] = this->objects[i]->references;
+    }
+    auto children = std::vector<Object *>();
+    auto counting = Tracer(children);
+    for (const auto *object: this->objects) {
+        children.clear();
+        object->trace(counting);
+        for (const auto *child: children) {
+            external[child->heap_index]--;
+        }
+    }
+
+    // An object nothing counts, say one on the C++ stack, is a root too: a
+    // heap-allocated one would already have been freed.
+    auto marked = std::vector<bool>(count);
+    auto pending = std::vector<Object *>();
+    auto marking = Tracer(children);
+    for (std::size_t i = 0; i < count; i++) {
+        if (external[i] > 0 || this->objects[i]->references == 0) {
+            marked[i] = true;
+            pending.push_back(this->objects[i]);
+        }
+    }
+    while (!pending.empty()) {
+        const auto *object = pending.back();
+        pending.pop_back();
+        children.clear();
+        object->trace(marking);
+        for (auto *child: children) {
+            if (!marked[child->heap_index]) {
+                marked[child->heap_index] = true;
+                pending.push_back(child);
+            }
+        }
+    }
+
+    // Holding a reference to every unmarked object keeps them all alive while
+    // their references to each other are cleared; dropping it frees them.
+    auto garbage = std::vector<Value>();
+    for (std::size_t i = 0; i < count; i++) {
+        if (!marked[i]) {
+            garbage.emplace_back(this->objects[i]);
+        }
+    }
+    for (const auto &value: garbage) {
+        value.object()->clear();
+    }
+    const auto collected = garbage.size();
+    garbage.clear();
+
+    // Pasts no clone looks back to any more (see clones.h), freed once every
+    // object has given its up, since freeing one may free objects.
+    auto dropped = std::vector<std::shared_ptr<void> >();
+    for (auto *object: this->objects) {
+        object->trimPasts(dropped);
+    }
+    dropped.clear();
+
+    const auto pause = std::chrono::duration_cast<std::chrono::nanoseconds>(std::chrono::steady_clock::now() - start);
+    this->stats.collections++;
+    this->stats.collected += collected;
+    this->stats.last_pause = pause;
+    this->stats.max_pause = std::max(this->stats.max_pause, pause);
+    this->stats.total_pause += pause;
+    this->threshold = std::max(MIN_THRESHOLD, 2 * this->objects.size());
+    return collected;
+}
+
+void Heap::maybeCollect() {
+    if (this->objects.size() >= this->threshold) {
+        this->collect();
+    }
+}
+
+HeapStatistics Heap::statistics() const {
+    auto statistics = this->stats;
+    statistics.objects = this->objects.size();
+    return statistics;
+}
+
+const std::vector<SlabPool> &Heap::slabPools() const {
+    return this->pools;
+}
+
+std::string Heap::describe() const {
+    const auto statistics = this->statistics();
+    return fmt::format("{} objects, {} bytes; {} collections freed {} objects, pauses {}us last, {}us max, {}us total",
+                       statistics.objects, statistics.bytes, statistics.collections, statistics.collected,
+                       statistics.last_pause.count() / 1000, statistics.max_pause.count() / 1000,
+                       statistics.total_pause.count() / 1000);
+}
+
+std::string Heap::describePools() const {
+    std::string text;
+    for (const auto &pool: this->pools) {
+        if (pool.slab_count() == 0) {
+            continue;
+        }
+        text += fmt::format("{:>3} bytes: {} of {} blocks in use, {} slabs\n", pool.block_size(),
+                            pool.blocks_in_use(), pool.capacity(), pool.slab_count());
+    }
+    return text;
+}
@@ -0,0 +1,43 @@
+//
+// Created by mizuk on 2025/3/8.
+//
+
+#include <mutex>
+#include <stdexcept>
+#include <repl/interner.h>
+
+Interner &Interner::global() {
+    static Interner interner;
+    return interner;
+}
+
+std::uint32_t Interner::intern(const std::string_view name) {
+    {
+        std::shared_lock lock(this->mutex);
+        if (const auto found = this->ids.find(name); found != this->ids.end()) {
+            return found->second;
+        }
+    }
+    std::unique_lock lock(this->mutex);
+    // another thread may have interned it between the two locks
+    if (const auto found = this->ids.find(name); found != this->ids.end()) {
+        return found->second;
+    }
+    const auto id = static_cast<std::uint32_t>(this->names.size());
+    const auto &stored = this->names.emplace_back(name);
+    this->ids.emplace(stored, id);
+    return id;
+}
+
+std::string_view Interner::name(const std::uint32_t id) const {
+    std::shared_lock lock(this->mutex);
+    if (id >= this->names.size()) {
+        throw std::out_of_range("Unknown atom id");
+    }
+    return this->names[id];
+}
+
+std::size_t Interner::size() const {
+    std::shared_lock lock(this->mutex);
+    return this->names.size();
+}
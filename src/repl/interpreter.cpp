@@ -3,66 +3,136 @@
 //
 
 #include <stdexcept>
+#include <utility>
 #include <repl/ast.h>
+#include <repl/builtins.h>
 #include "repl/interpreter.h"
 #include <repl/object.h>
 
-void Globals::global_set(const std::string &key, const std::shared_ptr<Object> &value) {
-    this->map[key] = value;
+std::uint32_t Globals::resolve(const Atom name) {
+    const auto [found, inserted] = this->directory.try_emplace(name, static_cast<std::uint32_t>(this->slots.size()));
+    if (inserted) {
+        this->names.push_back(name);
+        this->slots.emplace_back();
+        this->is_changed.push_back(false);
+    }
+    return found->second;
+}
+
+std::vector<std::uint32_t> Globals::take_changed() {
+    for (const auto slot: this->changed) {
+        this->is_changed[slot] = false;
+    }
+    return std::exchange(this->changed, {});
+}
+
+Atom Globals::name(const std::uint32_t slot) const {
+    return this->names.at(slot);
 }
 
-bool Globals::exists(const std::string &key) const {
-    return this->map.contains(key);
+std::size_t Globals::slot_count() const {
+    return this->slots.size();
 }
 
-std::shared_ptr<Object> Globals::global_get(const std::string &key) const {
-    if (this->map.contains(key)) {
-        return this->map.at(key);
+void Globals::global_set(const Atom key, const Value &value) {
+    this->set(this->resolve(key), value);
+}
+
+bool Globals::exists(const Atom key) const {
+    const auto found = this->directory.find(key);
+    return found != this->directory.end() && this->defined(found->second);
+}
+
+Value Globals::global_get(const Atom key) const {
+    if (const auto found = this->directory.find(key); found != this->directory.end()) {
+        return this->get(found->second);
     }
     throw InterpreterError(InterpretErrorType::UNDEFINED_VARIABLE);
 }
 
-void Interpreter::global_set(const std::string &key, std::shared_ptr<Object> &value) const {
+std::optional<std::uint32_t> Globals::find_constant(const std::string_view key) const {
+    if (const auto found = this->constant_index.find(key); found != this->constant_index.end()) {
+        return found->second;
+    }
+    return std::nullopt;
+}
+
+std::optional<std::uint32_t> Globals::add_constant(std::string key, Value constant) {
+    if (this->constants.size() >= MAX_CONSTANTS) {
+        return std::nullopt;
+    }
+    const auto index = static_cast<std::uint32_t>(this->constants.size());
+    this->constant_index.emplace(std::move(key), index);
+    this->constants.push_back(std::move(constant));
+    return index;
+}
+
+std::size_t Globals::constant_count() const {
+    return this->constants.size();
+}
+
+Globals &Interpreter::global_scope() const {
+    return *this->globals;
+}
+
+std::uint64_t Interpreter::commit() {
+    return this->committed.commit(*this->globals);
+}
+
+Versions &Interpreter::versions() {
+    return this->committed;
+}
+
+void Interpreter::set_output(std::function<void(std::string_view)> sink) {
+    this->output = std::move(sink);
+}
+
+void Interpreter::print(const Value &value) const {
+    if (this->output) {
+        this->output(value.toString());
+    } else {
+        fmt::print("{}\n", value.toString());
+    }
+}
+
+void Interpreter::global_set(const Atom key, Value &value) const {
     this->globals->global_set(key, value);
 }
 
-bool Interpreter::exists(const std::string &key) const {
+bool Interpreter::exists(const Atom key) const {
     return this->globals->exists(key);
 }
 
-std::shared_ptr<Object> Interpreter::global_get(const std::string &key) const {
+Value Interpreter::global_get(const Atom key) const {
     return this->globals->global_get(key);
 }
 
-std::shared_ptr<Object> Interpreter::callNothing() {
-    std::unique_ptr<Object> nil = std::make_unique<Nil>();
-    return nil;
+Value Interpreter::callNothing() {
+    return Value::nil();
 }
 
-std::shared_ptr<Object> Interpreter::visit(const Expr &expr) {
+Value Interpreter::visit(const Expr &expr) {
     return expr.accept(this);
 }
 
-std::shared_ptr<Object> Interpreter::visit(const NumberLiteral &numberLiteral) {
-    std::unique_ptr<Object> number = std::make_unique<Number>(numberLiteral.value);
-    return number;
+Value Interpreter::visit(const NumberLiteral &numberLiteral) {
+    return Value::number(numberLiteral.value);
 }
 
-std::shared_ptr<Object> Interpreter::visit(const NilLiteral &nilLiteral) {
-    std::unique_ptr<Object> nil = std::make_unique<Nil>();
-    return nil;
+Value Interpreter::visit(const NilLiteral &nilLiteral) {
+    return Value::nil();
 }
 
-std::shared_ptr<Object> Interpreter::visit(const Variable &variable) {
+Value Interpreter::visit(const Variable &variable) {
     auto object = this->global_get(variable.name);
     return object;
 }
 
-std::shared_ptr<Object> Interpreter::visit(const Symbol &symbol) {
-    return std::make_shared<Property>(symbol.name);
+Value Interpreter::visit(const Symbol &symbol) {
+    return Value::make<Property>(symbol.name);
 }
 
-std::shared_ptr<Object> Interpreter::visit(const Assignment &assignment) {
+Value Interpreter::visit(const Assignment &assignment) {
     const auto variable_name = assignment.lhs->name;
     if (!this->exists(variable_name)) {
         throw InterpreterError(InterpretErrorType::UNDEFINED_VARIABLE);
@@ -72,7 +142,7 @@ std::shared_ptr<Object> Interpreter::visit(const Assignment &assignment) {
     return right;
 }
 
-std::shared_ptr<Object> Interpreter::visit(const Declaration &declaration) {
+Value Interpreter::visit(const Declaration &declaration) {
     const auto variable_name = declaration.lhs->name;
     if (const auto duplicated = this->globals->exists(variable_name); duplicated) {
         throw InterpreterError(InterpretErrorType::DUPLICATE_VARIABLES_DEFINED);
@@ -82,59 +152,99 @@ std::shared_ptr<Object> Interpreter::visit(const Declaration &declaration) {
     return callNothing();
 }
 
-std::shared_ptr<Object> Interpreter::visit(const ArrayDefinition &arrayDefinition) {
-    auto objects = std::vector<std::shared_ptr<Object> >();
+Value Interpreter::visit(const ArrayDefinition &arrayDefinition) {
+    auto objects = std::vector<Value>();
     for (const auto &element: arrayDefinition.elements) {
         auto object = this->visit(*element);
         objects.push_back(object);
     }
-    auto array = std::make_shared<Array>(objects);
-    return array;
+    return Value::make<Array>(std::move(objects));
 }
 
-std::shared_ptr<Object> Interpreter::visit(const EntryDefinition &entryDefinition) {
+Value Interpreter::visit(const EntryDefinition &entryDefinition) {
     throw std::logic_error("Not implemented");
 }
 
-std::shared_ptr<Object> Interpreter::visit(const MapDefinition &mapDefinition) {
-    auto map = std::map<std::string, std::shared_ptr<Object> >();
+Value Interpreter::visit(const MapDefinition &mapDefinition) {
+    auto keys = std::vector<Atom>();
+    auto values = std::vector<Value>();
+    keys.reserve(mapDefinition.entries.size());
+    values.reserve(mapDefinition.entries.size());
     for (const auto &entry_definition: mapDefinition.entries) {
-        auto keyName = entry_definition->key->name;
-        auto value = this->visit(*entry_definition->value);
-        map.emplace(keyName, value);
+        keys.push_back(entry_definition->key->name);
+        values.push_back(this->visit(*entry_definition->value));
+    }
+    const auto *shape = Shape::of(keys);
+    if (shape->size() != keys.size()) {
+        // a repeated key keeps its first value
+        auto distinct = std::vector<Value>(shape->size());
+        for (std::size_t i = 0; i < keys.size(); i++) {
+            auto &value = distinct[*shape->offset(keys[i])];
+            if (!value) {
+                value = std::move(values[i]);
+            }
+        }
+        values = std::move(distinct);
     }
-    std::shared_ptr<Map> mapObject = std::make_shared<Map>(map);
-    return mapObject;
+    return Value::make<Map>(shape, std::move(values));
 }
 
-std::shared_ptr<Object> Interpreter::visit(const AccessorExpr &accessor_expr) {
-    return accessor_expr.accept(this);
+Value Interpreter::visit(const AccessPath &access_path) {
+    const auto &steps = access_path.steps;
+    auto object = this->global_get(access_path.root->name);
+    if (!access_path.value) {
+        for (const auto &step: steps) {
+            object = object.get_item(step);
+        }
+        return object;
+    }
+    for (std::size_t i = 0; i + 1 < steps.size(); i++) {
+        object = object.get_item(steps[i]);
+    }
+    auto new_value = this->visit(*access_path.value);
+    object.set_item(steps.back(), new_value);
+    return new_value;
 }
 
-std::shared_ptr<Object> Interpreter::visit(const GetterExpr &getter_expr) {
-    const auto object = this->visit(*getter_expr.instance);
-    const auto property = this->visit(*getter_expr.accessor);
-    return object->_get_item(property->identifier());
+Value Interpreter::visit(const Call &call) {
+    const auto builtin = findBuiltin(call.name);
+    if (!builtin) {
+        throw InterpreterError(InterpretErrorType::UNKNOWN_FUNCTION);
+    }
+    auto arguments = std::vector<Value>();
+    arguments.reserve(call.arguments.size());
+    for (const auto &argument: call.arguments) {
+        arguments.push_back(this->visit(*argument));
+    }
+    return callBuiltin(*builtin, arguments);
 }
 
-std::shared_ptr<Object> Interpreter::visit(const SetterExpr &setter_expr) {
-    const auto object = this->visit(*setter_expr.instance);
-    const auto property = this->visit(*setter_expr.accessor);
-    auto new_value = this->visit(*setter_expr.value);
-    object->_set_item(property->identifier(), new_value);
-    return new_value;
+Value Interpreter::visit(const PrintStatement &printStatement) {
+    const auto object = this->visit(*printStatement.rhs);
+    this->print(object);
+    return callNothing();
 }
 
-std::shared_ptr<Object> Interpreter::visit(const PrintStatement &printStatement) {
-    auto object = this->visit(*printStatement.rhs);
-    fmt::print("{}\n", object->toString());
+Value Interpreter::visit(const EmptyStatement &emptyStatement) {
     return callNothing();
 }
 
-std::shared_ptr<Object> Interpreter::visit(const EmptyStatement &emptyStatement) {
-    return callNothing();
+Value Interpreter::visit(const Program &program) {
+    auto result = callNothing();
+    for (const auto &statement: program.statements) {
+        result = this->visit(*statement);
+    }
+    return result;
 }
 
-std::shared_ptr<Object> Interpreter::visit(const Self &selfNode) {
+Value Interpreter::visit(const Self &selfNode) {
     return callNothing();
 }
+
+Value Interpreter::execute(const FlatAst &ast) {
+    return this->execute(ast, ast.root());
+}
+
+Value Interpreter::execute(const FlatAst &ast, const NodeIndex node) {
+    return this->run(Compiler::compile(ast, node, *this->globals));
+}
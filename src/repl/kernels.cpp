@@ -0,0 +1,194 @@
+//
+// Created by mizuk on 2025/3/22.
+//
+
+#include <algorithm>
+#include <bit>
+#include <cstring>
+#include <repl/kernels.h>
+
+#if defined(__AVX2__)
+#include <immintrin.h>
+#define REPL_KERNELS_SIMD 1
+#elif defined(__SSE2__) || defined(_M_X64)
+#include <emmintrin.h>
+#define REPL_KERNELS_SIMD 1
+#endif
+
+namespace {
+#if defined(__AVX2__)
+    using Vector = __m256i;
+    constexpr std::size_t LANES = 8;
+
+    inline Vector load(const std::int32_t *from) {
+        return _mm256_loadu_si256(reinterpret_cast<const Vector *>(from));
+    }
+
+    inline void store(std::int32_t *to, const Vector vector) {
+        _mm256_storeu_si256(reinterpret_cast<Vector *>(to), vector);
+    }
+
+    inline Vector broadcast(const std::int32_t number) {
+        return _mm256_set1_epi32(number);
+    }
+
+    inline Vector lanewiseMin(const Vector a, const Vector b) {
+        return _mm256_min_epi32(a, b);
+    }
+
+    inline Vector lanewiseMax(const Vector a, const Vector b) {
+        return _mm256_max_epi32(a, b);
+    }
+
+    // bit i set where lane i of the two vectors is equal
+    inline unsigned equalLanes(const Vector a, const Vector b) {
+        return static_cast<unsigned>(_mm256_movemask_ps(_mm256_castsi256_ps(_mm256_cmpeq_epi32(a, b))));
+    }
+
+    // adds the lanes, sign-extended, into two vectors of 64-bit sums
+    inline void accumulate(Vector (&sums)[2], const Vector vector) {
+        sums[0] = _mm256_add_epi64(sums[0], _mm256_cvtepi32_epi64(_mm256_castsi256_si128(vector)));
+        sums[1] = _mm256_add_epi64(sums[1], _mm256_cvtepi32_epi64(_mm256_extracti128_si256(vector, 1)));
+    }
+
+    inline Vector zero() {
+        return _mm256_setzero_si256();
+    }
+#elif defined(__SSE2__) || defined(_M_X64)
+    using Vector = __m128i;
+    constexpr std::size_t LANES = 4;
+
+    inline Vector load(const std::int32_t *from) {
+        return _mm_loadu_si128(reinterpret_cast<const Vector *>(from));
+    }
+
+    inline void store(std::int32_t *to, const Vector vector) {
+        _mm_storeu_si128(reinterpret_cast<Vector *>(to), vector);
+    }
+
+    inline Vector broadcast(const std::int32_t number) {
+        return _mm_set1_epi32(number);
+    }
+
+    // SSE2 has no 32-bit min/max; select through a comparison mask
+    inline Vector select(const Vector mask, const Vector a, const Vector b) {
+        return _mm_or_si128(_mm_and_si128(mask, a), _mm_andnot_si128(mask, b));
+    }
+
+    inline Vector lanewiseMin(const Vector a, const Vector b) {
+        return select(_mm_cmplt_epi32(a, b), a, b);
+    }
+
+    inline Vector lanewiseMax(const Vector a, const Vector b) {
+        return select(_mm_cmpgt_epi32(a, b), a, b);
+    }
+
+    inline unsigned equalLanes(const Vector a, const Vector b) {
+        return static_cast<unsigned>(_mm_movemask_ps(_mm_castsi128_ps(_mm_cmpeq_epi32(a, b))));
+    }
+
+    inline void accumulate(Vector (&sums)[2], const Vector vector) {
+        const auto sign = _mm_srai_epi32(vector, 31);
+        sums[0] = _mm_add_epi64(sums[0], _mm_unpacklo_epi32(vector, sign));
+        sums[1] = _mm_add_epi64(sums[1], _mm_unpackhi_epi32(vector, sign));
+    }
+
+    inline Vector zero() {
+        return _mm_setzero_si128();
+    }
+#endif
+}
+
+namespace kernels {
+    std::int64_t sum(const std::span<const std::int32_t> numbers) {
+        std::size_t i = 0;
+        std::int64_t total = 0;
+#ifdef REPL_KERNELS_SIMD
+        Vector sums[2] = {zero(), zero()};
+        for (; i + LANES <= numbers.size(); i += LANES) {
+            accumulate(sums, load(numbers.data() + i));
+        }
+        // two vectors of 64-bit lanes
+        std::int64_t partial[LANES];
+        std::memcpy(partial, sums, sizeof(sums));
+        for (const auto value: partial) {
+            total += value;
+        }
+#endif
+        for (; i < numbers.size(); i++) {
+            total += numbers[i];
+        }
+        return total;
+    }
+
+    std::int32_t min(const std::span<const std::int32_t> numbers) {
+        std::size_t i = 0;
+        auto result = numbers.front();
+#ifdef REPL_KERNELS_SIMD
+        if (numbers.size() >= LANES) {
+            auto lowest = load(numbers.data());
+            for (i = LANES; i + LANES <= numbers.size(); i += LANES) {
+                lowest = lanewiseMin(lowest, load(numbers.data() + i));
+            }
+            std::int32_t lanes[LANES];
+            store(lanes, lowest);
+            result = *std::min_element(lanes, lanes + LANES);
+        }
+#endif
+        for (; i < numbers.size(); i++) {
+            result = std::min(result, numbers[i]);
+        }
+        return result;
+    }
+
+    std::int32_t max(const std::span<const std::int32_t> numbers) {
+        std::size_t i = 0;
+        auto result = numbers.front();
+#ifdef REPL_KERNELS_SIMD
+        if (numbers.size() >= LANES) {
+            auto highest = load(numbers.data());
+            for (i = LANES; i + LANES <= numbers.size(); i += LANES) {
+                highest = lanewiseMax(highest, load(numbers.data() + i));
+            }
+            std::int32_t lanes[LANES];
+            store(lanes, highest);
+            result = *std::max_element(lanes, lanes + LANES);
+        }
+#endif
+        for (; i < numbers.size(); i++) {
+            result = std::max(result, numbers[i]);
+        }
+        return result;
+    }
+
+    std::size_t find(const std::span<const std::int32_t> numbers, const std::int32_t number) {
+        std::size_t i = 0;
+#ifdef REPL_KERNELS_SIMD
+        const auto needle = broadcast(number);
+        for (; i + LANES <= numbers.size(); i += LANES) {
+            if (const auto equal = equalLanes(load(numbers.data() + i), needle); equal != 0) {
+                return i + std::countr_zero(equal);
+            }
+        }
+#endif
+        for (; i < numbers.size(); i++) {
+            if (numbers[i] == number) {
+                return i;
+            }
+        }
+        return numbers.size();
+    }
+
+    void fill(const std::span<std::int32_t> numbers, const std::int32_t number) {
+        std::size_t i = 0;
+#ifdef REPL_KERNELS_SIMD
+        const auto value = broadcast(number);
+        for (; i + LANES <= numbers.size(); i += LANES) {
+            store(numbers.data() + i, value);
+        }
+#endif
+        for (; i < numbers.size(); i++) {
+            numbers[i] = number;
+        }
+    }
+}
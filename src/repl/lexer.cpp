@@ -2,61 +2,182 @@
 // Created by mizuk on 2025/2/22.
 //
 
+#include <algorithm>
+#include <array>
+#include <bit>
 #include <stdexcept>
-#include <cctype>
-#include <vector>
+#include <charconv>
 #include <repl/lexer.h>
 #include <repl/token.h>
 
-void Lexer::advance() {
-    this->pos++;
-}
+#if defined(__AVX2__)
+#include <immintrin.h>
+#elif defined(__SSE2__) || defined(_M_X64)
+#include <emmintrin.h>
+#endif
 
-Token Lexer::nextToken() {
-    this->advance();
-    while (this->pos < this->text.size()) {
-        this->skipWhiteSpace();
-        if (this->pos >= this->text.size()) {
-            return Token(TokenType::EOF_, std::monostate{});
-        }
+namespace {
+    enum CharClass : unsigned char {
+        SPACE = 1 << 0,
+        DIGIT = 1 << 1,
+        ALPHA = 1 << 2,
+        PUNCT = 1 << 3,
+        IDENT = DIGIT | ALPHA,
+    };
 
-        const auto ch = this->currentChar();
-        if (ch == '$') {
-            return Token(TokenType::DOLLAR);
+    struct CharInfo {
+        unsigned char classes;
+        TokenType token;
+    };
+
+    // One entry per byte value. Classification is fixed ASCII, independent of
+    // the C locale that isspace/isalnum/isdigit would consult.
+    constexpr std::array<CharInfo, 256> makeCharTable() {
+        std::array<CharInfo, 256> table{};
+        for (auto &info: table) {
+            info = {0, TokenType::EOF_};
         }
-        if (ch == '=') {
-            return Token(TokenType::EQ);
+        // '\n' is not whitespace: it separates statements
+        for (const auto ch: {' ', '\t', '\v', '\f', '\r'}) {
+            table[static_cast<unsigned char>(ch)].classes = SPACE;
         }
-        if (ch == '{') {
-            return Token(TokenType::LEFT_CURLY);
+        for (auto ch = '0'; ch <= '9'; ch++) {
+            table[static_cast<unsigned char>(ch)].classes = DIGIT;
         }
-        if (ch == '}') {
-            return Token(TokenType::RIGHT_CURLY);
+        for (auto ch = 'a'; ch <= 'z'; ch++) {
+            table[static_cast<unsigned char>(ch)].classes = ALPHA;
+            table[static_cast<unsigned char>(ch - 'a' + 'A')].classes = ALPHA;
         }
-        if (ch == '[') {
-            return Token(TokenType::LEFT_SQUARE);
+        const std::pair<char, TokenType> punctuation[] = {
+            {'$', TokenType::DOLLAR},
+            {'=', TokenType::EQ},
+            {'{', TokenType::LEFT_CURLY},
+            {'}', TokenType::RIGHT_CURLY},
+            {'[', TokenType::LEFT_SQUARE},
+            {']', TokenType::RIGHT_SQUARE},
+            {'(', TokenType::LEFT_PAREN},
+            {')', TokenType::RIGHT_PAREN},
+            {'@', TokenType::AT},
+            {'.', TokenType::DOT},
+            {',', TokenType::COMMA},
+            {';', TokenType::SEMICOLON},
+            {'\n', TokenType::NEWLINE},
+        };
+        for (const auto &[ch, type]: punctuation) {
+            table[static_cast<unsigned char>(ch)] = {PUNCT, type};
         }
-        if (ch == ']') {
-            return Token(TokenType::RIGHT_SQUARE);
+        return table;
+    }
+
+    constexpr auto CHAR_TABLE = makeCharTable();
+
+    constexpr bool is(const char ch, const unsigned char classes) {
+        return (CHAR_TABLE[static_cast<unsigned char>(ch)].classes & classes) != 0;
+    }
+
+#if defined(__AVX2__)
+    // Each mask sets a byte to 0xFF where the input byte belongs to the run.
+    inline __m256i inRange(const __m256i bytes, const char lo, const char hi) {
+        const auto offset = _mm256_sub_epi8(bytes, _mm256_set1_epi8(lo));
+        const auto span = _mm256_set1_epi8(static_cast<char>(hi - lo));
+        return _mm256_cmpeq_epi8(_mm256_min_epu8(offset, span), offset);
+    }
+
+    inline __m256i runMask(const __m256i bytes, const unsigned char classes) {
+        if (classes == SPACE) {
+            const auto controls = _mm256_andnot_si256(_mm256_cmpeq_epi8(bytes, _mm256_set1_epi8('\n')),
+                                                      inRange(bytes, '\t', '\r'));
+            return _mm256_or_si256(_mm256_cmpeq_epi8(bytes, _mm256_set1_epi8(' ')), controls);
+        }
+        const auto digits = inRange(bytes, '0', '9');
+        if (classes == DIGIT) {
+            return digits;
+        }
+        const auto letters = inRange(_mm256_or_si256(bytes, _mm256_set1_epi8(0x20)), 'a', 'z');
+        return _mm256_or_si256(digits, letters);
+    }
+#elif defined(__SSE2__) || defined(_M_X64)
+    inline __m128i inRange(const __m128i bytes, const char lo, const char hi) {
+        const auto offset = _mm_sub_epi8(bytes, _mm_set1_epi8(lo));
+        const auto span = _mm_set1_epi8(static_cast<char>(hi - lo));
+        return _mm_cmpeq_epi8(_mm_min_epu8(offset, span), offset);
+    }
+
+    inline __m128i runMask(const __m128i bytes, const unsigned char classes) {
+        if (classes == SPACE) {
+            const auto controls = _mm_andnot_si128(_mm_cmpeq_epi8(bytes, _mm_set1_epi8('\n')),
+                                                   inRange(bytes, '\t', '\r'));
+            return _mm_or_si128(_mm_cmpeq_epi8(bytes, _mm_set1_epi8(' ')), controls);
         }
-        if (ch == '@') {
-            return Token(TokenType::AT);
+        const auto digits = inRange(bytes, '0', '9');
+        if (classes == DIGIT) {
+            return digits;
         }
-        if (ch == '.') {
-            return Token(TokenType::DOT);
+        const auto letters = inRange(_mm_or_si128(bytes, _mm_set1_epi8(0x20)), 'a', 'z');
+        return _mm_or_si128(digits, letters);
+    }
+#endif
+
+    // Returns the index of the first byte at or after `from` that is not in
+    // `classes` (SPACE, DIGIT or IDENT), scanning a vector register at a time
+    // where the target supports it and finishing with the table.
+    std::size_t scanRun(const std::string_view text, std::size_t from, const unsigned char classes) {
+        // most runs are a handful of bytes; only long ones pay for a vector load
+        for (const auto limit = std::min(from + 8, text.size()); from < limit; from++) {
+            if (!is(text[from], classes)) {
+                return from;
+            }
         }
-        if (ch == ',') {
-            return Token(TokenType::COMMA);
+#if defined(__AVX2__)
+        while (from + 32 <= text.size()) {
+            const auto bytes = _mm256_loadu_si256(reinterpret_cast<const __m256i *>(text.data() + from));
+            const auto outside = ~static_cast<unsigned>(_mm256_movemask_epi8(runMask(bytes, classes)));
+            if (outside != 0) {
+                return from + std::countr_zero(outside);
+            }
+            from += 32;
         }
-        if (isalpha(ch)) {
-            return this->identifier();
+#elif defined(__SSE2__) || defined(_M_X64)
+        while (from + 16 <= text.size()) {
+            const auto bytes = _mm_loadu_si128(reinterpret_cast<const __m128i *>(text.data() + from));
+            const auto outside = ~static_cast<unsigned>(_mm_movemask_epi8(runMask(bytes, classes))) & 0xFFFFu;
+            if (outside != 0) {
+                return from + std::countr_zero(outside);
+            }
+            from += 16;
         }
-        if (isdigit(ch)) {
-            return this->number();
+#endif
+        while (from < text.size() && is(text[from], classes)) {
+            from++;
         }
+        return from;
     }
+}
+
+void Lexer::advance() {
+    this->pos++;
+}
 
-    return Token(TokenType::EOF_);
+Token Lexer::nextToken() {
+    this->advance();
+    this->skipWhiteSpace();
+    const auto start = static_cast<std::size_t>(this->pos);
+    auto token = Token(TokenType::EOF_);
+    if (start < this->text.size()) {
+        const auto &[classes, type] = CHAR_TABLE[static_cast<unsigned char>(this->text[start])];
+        if (classes & PUNCT) {
+            token = Token(type);
+        } else if (classes & ALPHA) {
+            token = this->identifier();
+        } else if (classes & DIGIT) {
+            token = this->number();
+        } else {
+            // reported by the parser, which knows how to recover from it
+            token = Token(TokenType::INVALID);
+        }
+    }
+    token.offset = std::min(start, this->text.size());
+    return token;
 }
 
 Token Lexer::peekToken() {
@@ -66,6 +187,23 @@ Token Lexer::peekToken() {
     return token;
 }
 
+std::vector<Token> Lexer::tokenize() {
+    auto tokens = std::vector<Token>();
+    // tokens average well over four input bytes once whitespace is counted
+    tokens.reserve(this->text.size() / 4 + 1);
+    while (true) {
+        const auto token = this->nextToken();
+        tokens.push_back(token);
+        if (token.type == TokenType::EOF_) {
+            return tokens;
+        }
+    }
+}
+
+std::string_view Lexer::source() const {
+    return this->text;
+}
+
 char Lexer::currentChar() const {
     if (this->pos >= this->text.size()) {
         throw std::out_of_range("Attempted to read past end of input");
@@ -74,50 +212,46 @@ char Lexer::currentChar() const {
 }
 
 void Lexer::skipWhiteSpace() {
-    while (this->pos < this->text.size() && isspace(this->currentChar())) {
-        this->advance();
-    }
+    this->pos = static_cast<int>(scanRun(this->text, this->pos, SPACE));
 }
 
 Token Lexer::number() {
-    auto chars = std::vector<char>();
-    while (this->pos < this->text.size() && isdigit(this->currentChar())) {
-        chars.push_back(this->currentChar());
-        this->advance();
-    }
+    const auto start = this->pos;
+    this->pos = static_cast<int>(scanRun(this->text, this->pos, DIGIT));
+    const auto digits = this->text.substr(start, this->pos - start);
     // should revert one pos, or not it will be conflicted with
     // Token Lexer::nextToken() {
     //     this->advance();
     //     //...
     // }
-    if(!chars.empty()) {
+    if (!digits.empty()) {
         this->pos--;
     }
-    const auto number_string = std::string(chars.begin(), chars.end());
-    auto number = std::stoi(number_string);
+    int number = 0;
+    const auto [end, error] = std::from_chars(digits.data(), digits.data() + digits.size(), number);
+    if (error == std::errc::result_out_of_range) {
+        return Token(TokenType::INVALID);
+    }
     return {TokenType::NUMBER, number};
 }
 
 Token Lexer::identifier() {
-    auto chars = std::vector<char>();
-    while (this->pos < this->text.size() && isalnum(this->currentChar())) {
-        chars.push_back(this->currentChar());
-        this->advance();
-    }
+    const auto start = this->pos;
+    this->pos = static_cast<int>(scanRun(this->text, this->pos, IDENT));
+    const auto identifier = this->text.substr(start, this->pos - start);
     // should revert one pos, or not it will be conflicted with
     // Token Lexer::nextToken() {
     //     this->advance();
     //     //...
     // }
-    if (!chars.empty()) {
+    if (!identifier.empty()) {
         this->pos--;
     }
-    auto identifier = std::string(chars.begin(), chars.end());
     if (identifier == "nil") {
         return Token(TokenType::NIL);
     }
     if (identifier == "print") {
         return Token(TokenType::PRINT);
     }
-    return {TokenType::IDENTIFIER, identifier};
+    return {TokenType::IDENTIFIER, Atom(identifier)};
 }
@@ -0,0 +1,120 @@
+//
+// Created by mizuk on 2025/3/9.
+//
+
+#include <algorithm>
+#include <system_error>
+#include <repl/mapped_file.h>
+
+#ifdef _WIN32
+#include <windows.h>
+#else
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#endif
+
+#ifdef _WIN32
+
+MappedFile::MappedFile(const std::string &path) {
+    this->file_handle = CreateFileA(path.c_str(), GENERIC_READ, FILE_SHARE_READ, nullptr,
+                                    OPEN_EXISTING, FILE_FLAG_SEQUENTIAL_SCAN, nullptr);
+    if (this->file_handle == INVALID_HANDLE_VALUE) {
+        this->file_handle = nullptr;
+        throw std::system_error(static_cast<int>(GetLastError()), std::system_category(), path);
+    }
+    LARGE_INTEGER file_size;
+    if (!GetFileSizeEx(this->file_handle, &file_size)) {
+        const auto error = static_cast<int>(GetLastError());
+        CloseHandle(this->file_handle);
+        throw std::system_error(error, std::system_category(), path);
+    }
+    this->size = static_cast<std::size_t>(file_size.QuadPart);
+    if (this->size == 0) {
+        return;
+    }
+    this->mapping_handle = CreateFileMappingA(this->file_handle, nullptr, PAGE_READONLY, 0, 0, nullptr);
+    if (this->mapping_handle == nullptr) {
+        const auto error = static_cast<int>(GetLastError());
+        CloseHandle(this->file_handle);
+        throw std::system_error(error, std::system_category(), path);
+    }
+    this->data = static_cast<const char *>(MapViewOfFile(this->mapping_handle, FILE_MAP_READ, 0, 0, 0));
+    if (this->data == nullptr) {
+        const auto error = static_cast<int>(GetLastError());
+        CloseHandle(this->mapping_handle);
+        CloseHandle(this->file_handle);
+        throw std::system_error(error, std::system_category(), path);
+    }
+}
+
+MappedFile::~MappedFile() {
+    if (this->data != nullptr) {
+        UnmapViewOfFile(this->data);
+    }
+    if (this->mapping_handle != nullptr) {
+        CloseHandle(this->mapping_handle);
+    }
+    if (this->file_handle != nullptr) {
+        CloseHandle(this->file_handle);
+    }
+}
+
+void MappedFile::release(const std::size_t offset) {
+    // the Windows working-set manager trims clean, sequentially read pages itself
+    this->released = std::max(this->released, offset);
+}
+
+#else
+
+MappedFile::MappedFile(const std::string &path) {
+    const auto fd = open(path.c_str(), O_RDONLY);
+    if (fd < 0) {
+        throw std::system_error(errno, std::generic_category(), path);
+    }
+    struct stat status{};
+    if (fstat(fd, &status) != 0) {
+        const auto error = errno;
+        close(fd);
+        throw std::system_error(error, std::generic_category(), path);
+    }
+    this->size = static_cast<std::size_t>(status.st_size);
+    if (this->size == 0) {
+        close(fd);
+        return;
+    }
+    void *mapping = mmap(nullptr, this->size, PROT_READ, MAP_PRIVATE, fd, 0);
+    const auto error = errno;
+    // the mapping keeps its own reference to the file
+    close(fd);
+    if (mapping == MAP_FAILED) {
+        throw std::system_error(error, std::generic_category(), path);
+    }
+    madvise(mapping, this->size, MADV_SEQUENTIAL);
+    this->data = static_cast<const char *>(mapping);
+}
+
+MappedFile::~MappedFile() {
+    if (this->data != nullptr) {
+        munmap(const_cast<char *>(this->data), this->size);
+    }
+}
+
+void MappedFile::release(const std::size_t offset) {
+    if (this->data == nullptr) {
+        return;
+    }
+    static const auto page_size = static_cast<std::size_t>(sysconf(_SC_PAGESIZE));
+    const auto end = offset / page_size * page_size;
+    if (end > this->released) {
+        madvise(const_cast<char *>(this->data) + this->released, end - this->released, MADV_DONTNEED);
+        this->released = end;
+    }
+}
+
+#endif
+
+std::string_view MappedFile::contents() const {
+    return {this->data, this->size};
+}
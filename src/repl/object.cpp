@@ -2,27 +2,379 @@
 // Created by mizuk on 2025/2/22.
 //
 
+#include <algorithm>
+#include <repl/kernels.h>
 #include <repl/object.h>
+#include <repl/versions.h>
 #include <sstream>
 
-// Added: definition for the pure-virtual destructor.
-Object::~Object() = default;
+namespace {
+    // Objects whose toString() is running on this thread. One reached again
+    // through a cycle prints as "Array(...)" or "Map(...)".
+    thread_local std::vector<const Object *> printing;
 
-std::string Nil::toString() {
-    return "Nil()";
+    class PrintGuard {
+    public:
+        const bool entered;
+
+        explicit PrintGuard(const Object *object) : entered(std::ranges::find(printing, object) == printing.end()) {
+            if (this->entered) {
+                printing.push_back(object);
+            }
+        }
+
+        ~PrintGuard() {
+            if (this->entered) {
+                printing.pop_back();
+            }
+        }
+    };
+}
+
+std::string Value::toString() const {
+    if (this->isNumber()) {
+        return "Number(" + std::to_string(this->asNumber()) + ")";
+    }
+    if (this->isNil()) {
+        return "Nil()";
+    }
+    if (auto *object = this->object()) {
+        return object->toString();
+    }
+    throw std::logic_error("toString of no value");
+}
+
+Value Value::get_item(const Identifier &identifier) const {
+    if (auto *object = this->object()) {
+        return object->_get_item(identifier);
+    }
+    throw std::logic_error(fmt::format("Not implemented _get_item on {}", this->isNumber() ? "Number" : "Nil"));
+}
+
+Value Value::set_item(const Identifier &identifier, Value &value) const {
+    if (auto *object = this->object()) {
+        return object->_set_item(identifier, value);
+    }
+    throw std::logic_error(fmt::format("Not implemented _set_item on {}", this->isNumber() ? "Number" : "Nil"));
+}
+
+Array::Array(const std::span<Value> elements) {
+    if (std::ranges::all_of(elements, &Value::isNumber)) {
+        this->numbers = decltype(this->numbers)::generate(elements.size(), [&](const std::size_t i) {
+            return elements[i].asNumber();
+        });
+    } else {
+        this->is_packed = false;
+        this->elements = decltype(this->elements)::generate(elements.size(), [&](const std::size_t i) {
+            return std::move(elements[i]);
+        });
+    }
+}
+
+Array::Array(const Array &other)
+    : Object(other), is_packed(other.is_packed), numbers(other.numbers), elements(other.elements) {
+}
+
+Array::Array(const std::vector<std::int32_t> &numbers)
+    : numbers(decltype(this->numbers)::generate(numbers.size(), [&](const std::size_t i) {
+        return numbers[i];
+    })) {
+}
+
+void Array::unpack() {
+    // numbers are this array's own, clone or not
+    const auto owner = this->cloning != nullptr && this->cloning->origin != nullptr ? this->cloning->origin->tag : 0;
+    this->elements = decltype(this->elements)::generate(this->numbers.size(), [&](const std::size_t i) {
+        return Value::number(this->numbers[i]);
+    }, owner);
+    this->numbers = {};
+    this->is_packed = false;
+}
+
+void Array::remember() {
+    if (this->cloning == nullptr) {
+        this->cloning = std::make_unique<CloneState<Past> >();
+    }
+    auto &pasts = this->cloning->pasts;
+    Clones::trim(pasts);
+    pasts.push_back(Past{Clones::now(), this->is_packed, this->numbers, this->elements});
+    this->stamp = Clones::now();
+}
+
+void Array::own(const std::size_t index) {
+    if (this->cloning->origin == nullptr) {
+        return;
+    }
+    const auto &origin = *this->cloning->origin;
+    this->elements.own(index, origin.tag, [&](const Value &element, const std::uint64_t owner) {
+        return Clones::resolve(origin, owner, element);
+    });
+}
+
+void Array::ownAll() {
+    if (this->cloning == nullptr || this->cloning->origin == nullptr) {
+        return;
+    }
+    const auto &origin = *this->cloning->origin;
+    this->elements.ownEach(origin.tag, [&](const Value &element, const std::uint64_t owner) {
+        return Clones::resolve(origin, owner, element);
+    });
+}
+
+Value Array::shown(const std::size_t index) const {
+    const auto &origin = *this->cloning->origin;
+    const auto owner = this->elements.ownerOf(index);
+    return owner == origin.tag ? this->elements[index] : Clones::resolve(origin, owner, this->elements[index]);
+}
+
+void Array::set(const std::size_t index, const Value &value) {
+    if (this->link != nullptr) {
+        Versions::storing(*this, static_cast<std::uint32_t>(index), this->is_packed ? Value() : this->elements[index]);
+    }
+    if (this->stamp < Clones::horizon()) [[unlikely]] {
+        this->remember();
+    }
+    if (this->is_packed) {
+        if (value.isNumber()) {
+            this->numbers.unique(index) = value.asNumber();
+            return;
+        }
+        this->unpack();
+    }
+    if (this->cloning != nullptr) [[unlikely]] {
+        this->own(index);
+    }
+    this->elements.unique(index) = value;
+}
+
+void Array::fill(const Value &value) {
+    if (this->link != nullptr) {
+        Versions::refilling(*this);
+    }
+    if (this->stamp < Clones::horizon()) [[unlikely]] {
+        this->remember();
+    }
+    if (this->is_packed && value.isNumber()) {
+        this->numbers.updateEachLeaf([&](const std::span<std::int32_t> numbers) {
+            kernels::fill(numbers, value.asNumber());
+        });
+        return;
+    }
+    if (this->is_packed) {
+        this->unpack();
+    }
+    if (this->cloning != nullptr && this->cloning->origin != nullptr) {
+        // nothing of the original's is left to copy
+        this->elements = decltype(this->elements)::generate(this->elements.size(), [&](std::size_t) {
+            return value;
+        }, this->cloning->origin->tag);
+        return;
+    }
+    this->elements.updateEachLeaf([&](const std::span<Value> elements) {
+        std::ranges::fill(elements, value);
+    });
+}
+
+void Array::trace(Tracer &tracer) const {
+    const auto add = [&](const Value &element) {
+        tracer.add(element);
+    };
+    this->elements.trace(tracer, add);
+    if (this->cloning != nullptr) {
+        for (const auto &past: this->cloning->pasts) {
+            past.elements.trace(tracer, add);
+        }
+        if (this->cloning->origin != nullptr) {
+            tracer.add(this->cloning->origin->source);
+        }
+    }
+}
+
+Array::~Array() {
+    if (this->link != nullptr) {
+        Versions::forget(*this);
+    }
+}
+
+void Array::clear() {
+    if (this->link != nullptr) {
+        Versions::forget(*this);
+    }
+    this->numbers = {};
+    this->elements = {};
+    this->cloning.reset();
 }
 
-std::string Number::toString() {
-    return "Number(" + std::to_string(num) + ")";
+Object *Array::freeze(Freezer &freezer) const {
+    // a clone copies what it still shares first, which changes nothing it
+    // shows
+    const_cast<Array *>(this)->ownAll();
+    auto *copy = new Array(*this);
+    // before the elements, which may lead back here
+    freezer.remember(this, copy);
+    copy->elements = this->elements.rebuild([](const Value &element) {
+        return !element.isObject();
+    }, [&](const Value &element) {
+        return freezer.freeze(element);
+    });
+    return copy;
+}
+
+Object *Array::cloneAt(const std::uint64_t instant, const std::shared_ptr<CloneFamily> &family) const {
+    auto *copy = new Array(*this);
+    const CloneOrigin *origin = nullptr;
+    if (this->cloning != nullptr) {
+        origin = this->cloning->origin.get();
+        if (const auto *past = Clones::pastAt(this->cloning->pasts, instant)) {
+            copy->is_packed = past->is_packed;
+            copy->numbers = past->numbers;
+            copy->elements = past->elements;
+        }
+    }
+    // whatever it holds has been there since
+    copy->stamp = instant;
+    copy->cloning = std::make_unique<CloneState<Past> >();
+    copy->cloning->origin = std::make_unique<CloneOrigin>(Clones::lineage(origin, instant, family),
+                                                          Value(const_cast<Array *>(this)));
+    return copy;
+}
+
+void Array::trimPasts(std::vector<std::shared_ptr<void> > &dropped) {
+    if (this->cloning != nullptr) {
+        Clones::trim(this->cloning->pasts, &dropped);
+    }
+}
+
+Map::Map(const Shape *shape, const std::span<Value> values)
+    : values(decltype(this->values)::generate(values.size(), [&](const std::size_t i) {
+        return std::move(values[i]);
+    })), shape(shape) {
+    this->shape->retain();
+}
+
+Map::Map(const Map &other) : Object(other), values(other.values), shape(other.shape) {
+    this->shape->retain();
+}
+
+void Map::remember() {
+    if (this->cloning == nullptr) {
+        this->cloning = std::make_unique<CloneState<Past> >();
+    }
+    auto &pasts = this->cloning->pasts;
+    Clones::trim(pasts);
+    pasts.push_back(Past{Clones::now(), this->values});
+    this->stamp = Clones::now();
+}
+
+void Map::own(const std::uint32_t offset) {
+    if (this->cloning->origin == nullptr) {
+        return;
+    }
+    const auto &origin = *this->cloning->origin;
+    this->values.own(offset, origin.tag, [&](const Value &value, const std::uint64_t owner) {
+        return Clones::resolve(origin, owner, value);
+    });
+}
+
+void Map::ownAll() {
+    if (this->cloning == nullptr || this->cloning->origin == nullptr) {
+        return;
+    }
+    const auto &origin = *this->cloning->origin;
+    this->values.ownEach(origin.tag, [&](const Value &value, const std::uint64_t owner) {
+        return Clones::resolve(origin, owner, value);
+    });
+}
+
+Value Map::shown(const std::uint32_t offset) const {
+    const auto &origin = *this->cloning->origin;
+    const auto owner = this->values.ownerOf(offset);
+    return owner == origin.tag ? this->values[offset] : Clones::resolve(origin, owner, this->values[offset]);
+}
+
+void Map::trace(Tracer &tracer) const {
+    const auto add = [&](const Value &value) {
+        tracer.add(value);
+    };
+    this->values.trace(tracer, add);
+    if (this->cloning != nullptr) {
+        for (const auto &past: this->cloning->pasts) {
+            past.values.trace(tracer, add);
+        }
+        if (this->cloning->origin != nullptr) {
+            tracer.add(this->cloning->origin->source);
+        }
+    }
+}
+
+Map::~Map() {
+    if (this->link != nullptr) {
+        Versions::forget(*this);
+    }
+    this->shape->release();
+}
+
+void Map::clear() {
+    if (this->link != nullptr) {
+        Versions::forget(*this);
+    }
+    this->values = {};
+    this->cloning.reset();
+}
+
+Object *Map::freeze(Freezer &freezer) const {
+    const_cast<Map *>(this)->ownAll();
+    auto *copy = new Map(*this);
+    freezer.remember(this, copy);
+    copy->values = this->values.rebuild([](const Value &value) {
+        return !value.isObject();
+    }, [&](const Value &value) {
+        return freezer.freeze(value);
+    });
+    return copy;
+}
+
+Object *Map::cloneAt(const std::uint64_t instant, const std::shared_ptr<CloneFamily> &family) const {
+    auto *copy = new Map(*this);
+    const CloneOrigin *origin = nullptr;
+    if (this->cloning != nullptr) {
+        origin = this->cloning->origin.get();
+        if (const auto *past = Clones::pastAt(this->cloning->pasts, instant)) {
+            copy->values = past->values;
+        }
+    }
+    copy->stamp = instant;
+    copy->cloning = std::make_unique<CloneState<Past> >();
+    copy->cloning->origin = std::make_unique<CloneOrigin>(Clones::lineage(origin, instant, family),
+                                                          Value(const_cast<Map *>(this)));
+    return copy;
+}
+
+void Map::trimPasts(std::vector<std::shared_ptr<void> > &dropped) {
+    if (this->cloning != nullptr) {
+        Clones::trim(this->cloning->pasts, &dropped);
+    }
 }
 
 std::string Array::toString() {
+    const PrintGuard guard(this);
+    if (!guard.entered) {
+        return "Array(...)";
+    }
+    const bool clone = this->cloning != nullptr && this->cloning->origin != nullptr && !this->is_packed;
     std::stringstream ss;
     ss << "Array(";
 
-    for (size_t i = 0; i < elements.size(); ++i) {
+    // elements by reference, so printing a committed version from a reader
+    // thread never touches a count; a clone, never committed, shows what it
+    // has yet to copy as copies made for the print
+    for (size_t i = 0; i < this->size(); ++i) {
         if (i > 0) ss << ", ";
-        ss << elements[i]->toString();
+        if (clone) [[unlikely]] {
+            ss << this->shown(i).toString();
+        } else {
+            ss << (this->is_packed ? Value::number(this->numbers[i]).toString() : this->elements[i].toString());
+        }
     }
 
     ss << ")";
@@ -30,13 +382,28 @@ std::string Array::toString() {
 }
 
 std::string Map::toString() {
+    const PrintGuard guard(this);
+    if (!guard.entered) {
+        return "Map(...)";
+    }
+    const bool clone = this->cloning != nullptr && this->cloning->origin != nullptr;
     std::stringstream ss;
     ss << "Map(";
 
+    // keys are printed in name order, independent of the shape's layout
+    const auto &keys = this->shape->keyList();
+    auto entries = std::vector<std::pair<std::string_view, std::uint32_t> >();
+    entries.reserve(keys.size());
+    for (std::uint32_t i = 0; i < keys.size(); i++) {
+        entries.emplace_back(keys[i].str(), i);
+    }
+    std::ranges::sort(entries);
+
+    // as Array's
     bool first = true;
-    for (const auto &[key, value]: map) {
+    for (const auto &[key, offset]: entries) {
         if (!first) ss << ", ";
-        ss << key << " = " << value->toString();
+        ss << key << " = " << (clone ? this->shown(offset).toString() : this->value(offset).toString());
         first = false;
     }
 
@@ -44,64 +411,42 @@ std::string Map::toString() {
     return ss.str();
 }
 
-std::shared_ptr<Object> Nil::_get_item(const Identifier &identifier) {
-    throw std::logic_error(fmt::format("Not implemented _get_item on {}", typeid(*this).name()));
-}
-
-std::shared_ptr<Object> Nil::_set_item(const Identifier &identifier, std::shared_ptr<Object> &value) {
-    throw std::logic_error(fmt::format("Not implemented _set_item on {}", typeid(*this).name()));
-}
-
-std::shared_ptr<Object> Number::_get_item(const Identifier &identifier) {
-    throw std::logic_error(fmt::format("Not implemented _get_item on {}", typeid(*this).name()));
-}
-
-std::shared_ptr<Object> Number::_set_item(const Identifier &identifier, std::shared_ptr<Object> &value) {
-    throw std::logic_error(fmt::format("Not implemented _set_item on {}", typeid(*this).name()));
-}
-
-std::shared_ptr<Object> Array::_get_item(const Identifier &identifier) {
+Value Array::_get_item(const Identifier &identifier) {
     const auto index = std::get<int>(identifier);
-    if (index < 0 || index >= elements.size()) {
+    if (index < 0 || static_cast<std::size_t>(index) >= this->size()) {
         throw std::out_of_range(fmt::format("Index {} out of range", index));
     }
-    return elements[index];
+    return this->navigate(index);
 }
 
-std::shared_ptr<Object> Array::_set_item(const Identifier &identifier, std::shared_ptr<Object> &value) {
+Value Array::_set_item(const Identifier &identifier, Value &value) {
     const auto index = std::get<int>(identifier);
-    if (index < 0 || index >= elements.size()) {
+    if (index < 0 || static_cast<std::size_t>(index) >= this->size()) {
         throw std::out_of_range(fmt::format("Index {} out of range", index));
     }
-    elements[index] = value;
+    this->set(index, value);
     return value;
 }
 
-std::shared_ptr<Object> Map::_get_item(const Identifier &identifier) {
-    const auto name = std::get<std::string>(identifier);
-    if (!this->map.contains(name)) {
-        throw std::out_of_range(fmt::format("Key {} not found", name));
+Value Map::_get_item(const Identifier &identifier) {
+    const auto name = std::get<Atom>(identifier);
+    const auto offset = this->shape->offset(name);
+    if (!offset) {
+        throw std::out_of_range(fmt::format("Key {} not found", name.str()));
     }
-    return this->map.at(name);
+    return this->navigate(*offset);
 }
 
-std::shared_ptr<Object> Map::_set_item(const Identifier &identifier, std::shared_ptr<Object> &value) {
-    const auto name = std::get<std::string>(identifier);
-    if (!this->map.contains(name)) {
-        throw std::out_of_range(fmt::format("Key {} not found", name));
+Value Map::_set_item(const Identifier &identifier, Value &value) {
+    const auto name = std::get<Atom>(identifier);
+    const auto offset = this->shape->offset(name);
+    if (!offset) {
+        throw std::out_of_range(fmt::format("Key {} not found", name.str()));
     }
-    this->map.at(name) = value;
+    this->setValue(*offset, value);
     return value;
 }
 
-Identifier Nil::identifier() const {
-    throw std::logic_error("Not implemented");
-}
-
-Identifier Number::identifier() const {
-    return this->num;
-}
-
 Identifier Array::identifier() const {
     throw std::logic_error("Not implemented");
 }
@@ -111,14 +456,14 @@ Identifier Map::identifier() const {
 }
 
 std::string Property::toString() {
-    return "Property(" + this->name + ")";
+    return "Property(" + std::string(this->name.str()) + ")";
 }
 
-std::shared_ptr<Object> Property::_get_item(const Identifier &identifier) {
+Value Property::_get_item(const Identifier &identifier) {
     throw std::logic_error("Not implemented");
 }
 
-std::shared_ptr<Object> Property::_set_item(const Identifier &identifier, std::shared_ptr<Object> &value) {
+Value Property::_set_item(const Identifier &identifier, Value &value) {
     throw std::logic_error("Not implemented");
 }
 
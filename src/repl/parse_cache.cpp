@@ -0,0 +1,146 @@
+//
+// Created by mizuk on 2025/3/14.
+//
+
+#include <repl/lexer.h>
+#include <repl/parse_cache.h>
+
+namespace {
+    void compile(ParsedProgram &program, Globals &globals) {
+        if (!program.diagnostics.empty()) {
+            return;
+        }
+        const auto &ast = program.ast;
+        for (const auto statement: ast.childrenOf(ast.root())) {
+            program.chunks.push_back(Compiler::compile(ast, statement, globals));
+        }
+    }
+}
+
+ParseCache::ParseCache(Globals &globals, const std::size_t capacity) : globals(globals), max_entries(capacity) {
+    this->index.reserve(capacity);
+}
+
+std::shared_ptr<const ParsedProgram> ParseCache::get(const std::string_view text) {
+    return this->get(text, nullptr);
+}
+
+std::shared_ptr<const ParsedProgram> ParseCache::get(const std::string_view text,
+                                                     std::shared_ptr<ParsedProgram> parsed) {
+    if (const auto found = this->index.find(text); found != this->index.end()) {
+        this->hit_count++;
+        this->entries.splice(this->entries.begin(), this->entries, found->second);
+        return found->second->program;
+    }
+    this->miss_count++;
+
+    if (!parsed) {
+        parsed = parse(text, this->arena);
+    }
+    if (this->max_entries == 0) {
+        compile(*parsed, this->globals);
+        return parsed;
+    }
+
+    auto program = this->intern(std::move(parsed));
+    if (this->entries.size() == this->max_entries) {
+        this->evict();
+    }
+    this->entries.push_front({std::string(text), program});
+    this->index.emplace(this->entries.front().text, this->entries.begin());
+    return program;
+}
+
+std::shared_ptr<ParsedProgram> ParseCache::parse(const std::string_view text, AstArena &arena) {
+    auto lexer = std::make_unique<Lexer>(text);
+    Parser parser(lexer, arena);
+    auto parsed = std::make_shared<ParsedProgram>();
+    parsed->ast = parser.parse_program_flat();
+    parsed->diagnostics = parser.diagnostics();
+    return parsed;
+}
+
+std::shared_ptr<const ParsedProgram> ParseCache::intern(std::shared_ptr<ParsedProgram> program) {
+    // diagnostics carry positions, so only clean programs are interchangeable
+    if (!program->diagnostics.empty()) {
+        return program;
+    }
+    const auto hash = program->ast.hash();
+    auto [it, last] = this->pool.equal_range(hash);
+    while (it != last) {
+        auto existing = it->second.lock();
+        if (!existing) {
+            it = this->pool.erase(it);
+            continue;
+        }
+        if (existing->ast == program->ast) {
+            this->shared_count++;
+            return existing;
+        }
+        ++it;
+    }
+    compile(*program, this->globals);
+    this->pool.emplace(hash, program);
+    return program;
+}
+
+void ParseCache::evict() {
+    const auto program = std::move(this->entries.back().program);
+    this->index.erase(this->entries.back().text);
+    this->entries.pop_back();
+
+    // last reference: drop its pool slot along with any expired neighbours
+    if (program.use_count() != 1 || !program->diagnostics.empty()) {
+        return;
+    }
+    auto [it, last] = this->pool.equal_range(program->ast.hash());
+    while (it != last) {
+        if (const auto existing = it->second.lock(); !existing || existing == program) {
+            it = this->pool.erase(it);
+        } else {
+            ++it;
+        }
+    }
+}
+
+std::size_t ParseCache::capacity() const {
+    return this->max_entries;
+}
+
+std::size_t ParseCache::size() const {
+    return this->entries.size();
+}
+
+std::size_t ParseCache::hits() const {
+    return this->hit_count;
+}
+
+std::size_t ParseCache::misses() const {
+    return this->miss_count;
+}
+
+std::size_t ParseCache::shared() const {
+    return this->shared_count;
+}
+
+ParseCacheShadow::ParseCacheShadow(const std::size_t capacity) : max_entries(capacity) {
+    this->index.reserve(capacity);
+}
+
+bool ParseCacheShadow::lookup(const std::string_view text) {
+    if (const auto found = this->index.find(text); found != this->index.end()) {
+        this->entries.splice(this->entries.begin(), this->entries, found->second);
+        return true;
+    }
+    if (this->max_entries == 0) {
+        return false;
+    }
+    // evicts exactly when ParseCache does
+    if (this->entries.size() == this->max_entries) {
+        this->index.erase(this->entries.back());
+        this->entries.pop_back();
+    }
+    this->entries.emplace_front(text);
+    this->index.emplace(this->entries.front(), this->entries.begin());
+    return false;
+}
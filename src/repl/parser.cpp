@@ -2,27 +2,146 @@
 // Created by mizuk on 2025/2/22.
 //
 
+#include <algorithm>
 #include <stdexcept>
+#include <fmt/format.h>
 #include <repl/parser.h>
 
 void Parser::consume(const TokenType type) {
-    if (this->current_token.type != type) {
-        throw std::runtime_error("Unexpected token");
+    if (this->failed) {
+        return;
+    }
+    const auto &token = this->current();
+    if (token.type != type) {
+        const auto error_type = token.type == TokenType::INVALID
+                                    ? ParseErrorType::INVALID_TOKEN
+                                    : ParseErrorType::UNEXPECTED_TOKEN;
+        this->fail(error_type, token, toString(type));
+        return;
+    }
+    if (this->cursor + 1 < this->tokens.size()) {
+        this->cursor++;
+    }
+}
+
+const Token &Parser::current() const {
+    return this->tokens[this->cursor];
+}
+
+const Token &Parser::peek(const std::size_t distance) const {
+    const auto index = std::min(this->cursor + distance, this->tokens.size() - 1);
+    return this->tokens[index];
+}
+
+void Parser::fail(const ParseErrorType type, const Token &token, const std::string_view expected) {
+    if (!this->recovering) {
+        throw ParserError(type);
+    }
+    if (this->failed) {
+        return;
+    }
+    this->failed = true;
+
+    const auto source = this->lexer->source();
+    const auto offset = std::min(token.offset, source.size());
+    for (; this->scanned_offset < offset; this->scanned_offset++) {
+        if (source[this->scanned_offset] == '\n') {
+            this->scanned_line++;
+            this->scanned_line_start = this->scanned_offset + 1;
+        }
+    }
+    this->reported.push_back({
+        this->scanned_line,
+        offset - this->scanned_line_start + 1,
+        type,
+        fmt::format("expected {} but found {}", expected, toString(token.type)),
+    });
+}
+
+bool Parser::atSeparator() const {
+    const auto type = this->current().type;
+    return type == TokenType::NEWLINE || type == TokenType::SEMICOLON;
+}
+
+void Parser::synchronize() {
+    while (!this->atSeparator() && this->current().type != TokenType::EOF_) {
+        this->cursor++;
     }
-    this->current_token = this->lexer->nextToken();
 }
 
-Token Parser::peek() const {
-    return this->lexer->peekToken();
+template<typename Parse>
+FlatAst Parser::lowered(Parse parse) {
+    AstArena scratch;
+    auto *const previous = this->arena;
+    if (this->arena == nullptr) {
+        this->arena = &scratch;
+    }
+    FlatAst ast;
+    try {
+        ast = FlatAst::from(*parse());
+    } catch (...) {
+        this->arena = previous;
+        throw;
+    }
+    this->arena->reset();
+    this->arena = previous;
+    return ast;
 }
 
 std::unique_ptr<Expr> Parser::parse() {
-    this->current_token = this->lexer->nextToken();
+    AstArena::Scope scope(this->arena);
+    this->tokens = this->lexer->tokenize();
+    this->cursor = 0;
     return this->expr();
 }
 
+std::unique_ptr<Program> Parser::parse_program() {
+    AstArena::Scope scope(this->arena);
+    this->tokens = this->lexer->tokenize();
+    this->cursor = 0;
+    this->recovering = true;
+    this->reported.clear();
+    this->scanned_offset = 0;
+    this->scanned_line = 1;
+    this->scanned_line_start = 0;
+
+    auto statements = std::vector<std::unique_ptr<Expr> >();
+    while (this->current().type != TokenType::EOF_) {
+        if (this->atSeparator()) {
+            this->cursor++;
+            continue;
+        }
+        this->failed = false;
+        auto statement = this->expr();
+        if (!this->failed && !this->atSeparator() && this->current().type != TokenType::EOF_) {
+            this->fail(ParseErrorType::UNEXPECTED_TOKEN, this->current(), "newline or ';'");
+        }
+        if (this->failed) {
+            this->synchronize();
+            continue;
+        }
+        statements.push_back(std::move(statement));
+    }
+
+    this->recovering = false;
+    this->failed = false;
+    return std::make_unique<Program>(std::move(statements));
+}
+
+const std::vector<Diagnostic> &Parser::diagnostics() const {
+    return this->reported;
+}
+
+FlatAst Parser::parse_flat() {
+    return this->lowered([this] { return this->parse(); });
+}
+
+FlatAst Parser::parse_program_flat() {
+    return this->lowered([this] { return this->parse_program(); });
+}
+
 std::unique_ptr<Expr> Parser::expr() {
-    const auto token = this->current_token;
+    const auto &token = this->current();
     if (token.type == TokenType::DOLLAR) {
         return this->declaration();
     }
@@ -45,7 +164,13 @@ std::unique_ptr<Declaration> Parser::declaration() {
     this->consume(TokenType::DOLLAR);
     auto lhs = this->variable();
     this->consume(TokenType::EQ);
+    if (this->failed) {
+        return nullptr;
+    }
     auto rhs = this->rhs();
+    if (this->failed) {
+        return nullptr;
+    }
     return std::make_unique<Declaration>(lhs, rhs);
 }
 
@@ -54,33 +179,46 @@ std::unique_ptr<Assignment> Parser::assign_expr() {
 }
 
 std::unique_ptr<Expr> Parser::definition() {
-    const auto token = this->peek();
+    const auto &token = this->peek();
     if (token.type == TokenType::LEFT_CURLY) {
         return this->map_definition();
     }
     if (token.type == TokenType::LEFT_SQUARE) {
         return this->array_definition();
     }
-    throw ParserError(ParseErrorType::UNKNOWN_DEFINITION);
+    this->fail(ParseErrorType::UNKNOWN_DEFINITION, token, "'{' or '[' after '@'");
+    return nullptr;
 }
 
 std::unique_ptr<MapDefinition> Parser::map_definition() {
     this->consume(TokenType::AT);
     auto entries = std::vector<std::unique_ptr<EntryDefinition> >();
     this->consume(TokenType::LEFT_CURLY);
-    while (this->current_token.type != TokenType::RIGHT_CURLY) {
+    while (!this->failed && this->current().type != TokenType::RIGHT_CURLY) {
         auto entry = this->entry_definition();
+        if (this->failed) {
+            return nullptr;
+        }
         entries.push_back(std::move(entry));
         this->consume(TokenType::COMMA);
     }
     this->consume(TokenType::RIGHT_CURLY);
+    if (this->failed) {
+        return nullptr;
+    }
     return std::make_unique<MapDefinition>(std::move(entries));
 }
 
 std::unique_ptr<EntryDefinition> Parser::entry_definition() {
     auto symbol = this->symbol();
     this->consume(TokenType::EQ);
+    if (this->failed) {
+        return nullptr;
+    }
     auto rhs = this->rhs();
+    if (this->failed) {
+        return nullptr;
+    }
     return std::make_unique<EntryDefinition>(symbol, rhs);
 }
 
@@ -88,66 +226,98 @@ std::unique_ptr<ArrayDefinition> Parser::array_definition() {
     this->consume(TokenType::AT);
     auto elements = std::vector<std::unique_ptr<Expr> >();
     this->consume(TokenType::LEFT_SQUARE);
-    while (this->current_token.type != TokenType::RIGHT_SQUARE) {
+    while (!this->failed && this->current().type != TokenType::RIGHT_SQUARE) {
         auto element = this->rhs();
+        if (this->failed) {
+            return nullptr;
+        }
         elements.push_back(std::move(element));
         this->consume(TokenType::COMMA);
     }
     this->consume(TokenType::RIGHT_SQUARE);
+    if (this->failed) {
+        return nullptr;
+    }
     return std::make_unique<ArrayDefinition>(std::move(elements));
 }
 
 std::unique_ptr<Expr> Parser::accessor_expr() {
-    std::unique_ptr<Expr> instance = this->variable();
-    auto is_accessor = false;
-    while (this->current_token.type == TokenType::DOT || this->current_token.type == TokenType::LEFT_SQUARE) {
-        is_accessor = true;
-        const auto token_type = this->current_token.type;
+    auto root = this->variable();
+    if (this->failed) {
+        return nullptr;
+    }
+    auto steps = std::vector<Identifier>();
+    while (this->current().type == TokenType::DOT || this->current().type == TokenType::LEFT_SQUARE) {
+        const auto token_type = this->current().type;
+        this->consume(token_type);
+        const auto &token = this->current();
         if (token_type == TokenType::DOT) {
-            this->consume(TokenType::DOT);
-            std::unique_ptr<Expr> accessor = this->symbol();
-            instance = std::make_unique<GetterExpr>(instance, accessor);
-        }
-        if (token_type == TokenType::LEFT_SQUARE) {
-            this->consume(TokenType::LEFT_SQUARE);
-            std::unique_ptr<Expr> accessor = this->number();
-            instance = std::make_unique<GetterExpr>(instance, accessor);
+            this->consume(TokenType::IDENTIFIER);
+            if (this->failed) {
+                return nullptr;
+            }
+            steps.emplace_back(std::get<Atom>(token.value));
+        } else {
+            this->consume(TokenType::NUMBER);
             this->consume(TokenType::RIGHT_SQUARE);
+            if (this->failed) {
+                return nullptr;
+            }
+            steps.emplace_back(std::get<int>(token.value));
         }
     }
-    if (this->current_token.type != TokenType::EQ) {
-        return instance;
-    }
-    if (!is_accessor) {
-        this->consume(TokenType::EQ);
-        auto rhs = this->rhs();
-        auto variable = std::make_unique<Variable>(*dynamic_cast<Variable *>(instance.get()));
-        return std::make_unique<Assignment>(variable, rhs);
-    }
-
-    auto *getter_ptr = dynamic_cast<GetterExpr *>(instance.get());
-    if (!getter_ptr) {
-        throw std::runtime_error("Expected AccessorExpr");
+    if (this->current().type != TokenType::EQ) {
+        if (steps.empty()) {
+            return root;
+        }
+        return std::make_unique<AccessPath>(root, std::move(steps));
     }
 
     this->consume(TokenType::EQ);
     auto value = this->rhs();
+    if (this->failed) {
+        return nullptr;
+    }
+    if (steps.empty()) {
+        return std::make_unique<Assignment>(root, value);
+    }
+    return std::make_unique<AccessPath>(root, std::move(steps), value);
+}
 
-    return std::make_unique<SetterExpr>(
-        getter_ptr->instance,
-        getter_ptr->accessor,
-        value
-    );
+std::unique_ptr<Call> Parser::call() {
+    const auto &name = this->current();
+    this->consume(TokenType::IDENTIFIER);
+    this->consume(TokenType::LEFT_PAREN);
+    auto arguments = std::vector<std::unique_ptr<Expr> >();
+    while (!this->failed && this->current().type != TokenType::RIGHT_PAREN) {
+        auto argument = this->rhs();
+        if (this->failed) {
+            return nullptr;
+        }
+        arguments.push_back(std::move(argument));
+        if (this->current().type != TokenType::COMMA) {
+            break;
+        }
+        this->consume(TokenType::COMMA);
+    }
+    this->consume(TokenType::RIGHT_PAREN);
+    if (this->failed) {
+        return nullptr;
+    }
+    return std::make_unique<Call>(std::get<Atom>(name.value), std::move(arguments));
 }
 
 std::unique_ptr<PrintStatement> Parser::print_stmt() {
     this->consume(TokenType::PRINT);
     auto rhs = this->rhs();
+    if (this->failed) {
+        return nullptr;
+    }
     return std::make_unique<PrintStatement>(std::move(rhs));
 }
 
 std::unique_ptr<Expr> Parser::rhs() {
-    const auto token = this->current_token;
+    const auto &token = this->current();
     if (token.type == TokenType::AT) {
         return this->definition();
     }
@@ -155,46 +325,71 @@ std::unique_ptr<Expr> Parser::rhs() {
         return this->literal();
     }
     if (token.type == TokenType::IDENTIFIER) {
+        if (this->peek().type == TokenType::LEFT_PAREN) {
+            return this->call();
+        }
         return this->accessor_expr();
     }
-    throw ParserError(ParseErrorType::UNKNOWN_RHS);
+    this->fail(ParseErrorType::UNKNOWN_RHS, token, "a value");
+    return nullptr;
 }
 
 std::unique_ptr<Literal> Parser::literal() {
-    const auto token = this->current_token;
+    const auto &token = this->current();
     if (token.type == TokenType::NUMBER) {
         return this->number();
     }
     if (token.type == TokenType::NIL) {
         return this->null();
     }
-    throw ParserError(ParseErrorType::UNKNOWN_LITERAL);
+    this->fail(ParseErrorType::UNKNOWN_LITERAL, token, "a number or 'nil'");
+    return nullptr;
 }
 
 std::unique_ptr<NumberLiteral> Parser::number() {
-    auto token = this->current_token;
+    const auto &token = this->current();
     this->consume(TokenType::NUMBER);
+    if (this->failed) {
+        return nullptr;
+    }
     return std::make_unique<NumberLiteral>(std::get<int>(token.value));
 }
 
 std::unique_ptr<NilLiteral> Parser::null() {
     this->consume(TokenType::NIL);
+    if (this->failed) {
+        return nullptr;
+    }
     return std::make_unique<NilLiteral>();
 }
 
 std::unique_ptr<Variable> Parser::variable() {
-    auto token = this->current_token;
+    const auto &token = this->current();
     this->consume(TokenType::IDENTIFIER);
-    return std::make_unique<Variable>(std::get<std::string>(token.value));
+    if (this->failed) {
+        return nullptr;
+    }
+    return std::make_unique<Variable>(std::get<Atom>(token.value));
 }
 
 std::unique_ptr<Symbol> Parser::symbol() {
-    auto token = this->current_token;
+    const auto &token = this->current();
     this->consume(TokenType::IDENTIFIER);
-    return std::make_unique<Symbol>(std::get<std::string>(token.value));
+    if (this->failed) {
+        return nullptr;
+    }
+    return std::make_unique<Symbol>(std::get<Atom>(token.value));
 }
 
 std::unique_ptr<EmptyStatement> Parser::empty_stmt() {
-    this->consume(TokenType::EOF_);
+    const auto &token = this->current();
+    if (token.type != TokenType::EOF_ && !this->atSeparator()) {
+        const auto error_type = token.type == TokenType::INVALID
+                                    ? ParseErrorType::INVALID_TOKEN
+                                    : ParseErrorType::UNEXPECTED_TOKEN;
+        this->fail(error_type, token, "a statement");
+        return nullptr;
+    }
+    this->consume(token.type);
     return std::make_unique<EmptyStatement>();
 }
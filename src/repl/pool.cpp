@@ -0,0 +1,40 @@
+//
+// Created by mizuk on 2025/3/24.
+//
+
+#include <stdexcept>
+#include <repl/pool.h>
+
+SlabPool::SlabPool(const std::size_t block_size) : block_bytes(block_size) {
+    if (block_size == 0 || block_size % 16 != 0 || block_size > SLAB_SIZE) {
+        throw std::invalid_argument("SlabPool block size must be a positive multiple of 16 within a slab");
+    }
+}
+
+void SlabPool::grow() {
+    auto slab = std::make_unique<std::byte[]>(SLAB_SIZE);
+    const auto count = SLAB_SIZE / this->block_bytes;
+    // threaded back to front, so blocks are handed out in address order
+    for (auto i = count; i-- > 0;) {
+        auto *block = reinterpret_cast<FreeBlock *>(slab.get() + i * this->block_bytes);
+        block->next = this->free_list;
+        this->free_list = block;
+    }
+    this->slabs.push_back(std::move(slab));
+}
+
+std::size_t SlabPool::block_size() const {
+    return this->block_bytes;
+}
+
+std::size_t SlabPool::blocks_in_use() const {
+    return this->in_use;
+}
+
+std::size_t SlabPool::capacity() const {
+    return this->slabs.size() * (SLAB_SIZE / this->block_bytes);
+}
+
+std::size_t SlabPool::slab_count() const {
+    return this->slabs.size();
+}
@@ -2,20 +2,256 @@
 // Created by mizuk on 2025/2/22.
 //
 
+#include <algorithm>
+#include <atomic>
+#include <deque>
+#include <exception>
 #include <iostream>
+#include <memory>
 #include <ostream>
+#include <thread>
+#include <vector>
+#include <repl/arena.h>
+#include <repl/heap.h>
 #include <repl/interpreter.h>
 #include <repl/repl.h>
 #include <repl/lexer.h>
+#include <repl/mapped_file.h>
 #include <repl/object.h>
+#include <repl/parse_cache.h>
 #include <repl/parser.h>
+#include <repl/server.h>
+#include <repl/spsc_ring.h>
+#include <repl/work_pool.h>
 
 #include "fmt/core.h"
 
-[[noreturn]] void REPL::Start() {
+namespace {
+    // how far a script run gets before the pages behind it are released
+    constexpr std::size_t RELEASE_INTERVAL = 64 << 20;
+
+    // lines parsed ahead of the interpreter in a pipelined run
+    constexpr std::size_t PIPELINE_DEPTH = 256;
+
+    // bytes of script per task of a parallel run, rounded up to a whole line
+    constexpr std::size_t PARALLEL_CHUNK = 64 << 10;
+    // chunks per parsing thread taken on ahead of the interpreter
+    constexpr std::size_t PARALLEL_WINDOW = 4;
+
+    // Text seen recently comes straight from `cache`; anything else is parsed
+    // there, unless `parsed` already holds its parse. `line_number` is where
+    // `text` starts in its source, for diagnostics.
+    void Execute(Interpreter &interpreter, ParseCache &cache, const std::string_view text,
+                 const std::size_t line_number, std::shared_ptr<ParsedProgram> parsed = nullptr) {
+        const auto program = cache.get(text, std::move(parsed));
+
+        if (!program->diagnostics.empty()) {
+            for (const auto &diagnostic: program->diagnostics) {
+                fmt::println("ERROR: {}:{}: {}", line_number + diagnostic.line - 1, diagnostic.column,
+                             diagnostic.message);
+            }
+            return;
+        }
+
+        for (const auto &chunk: program->chunks) {
+            try {
+                const auto object = interpreter.run(chunk);
+                fmt::println("{}", object.toString());
+            } catch (...) {
+                fmt::println("ERROR");
+            }
+            Heap::local().maybeCollect();
+        }
+    }
+
+    // Calls `visit(text, line_number, next)` for each line of `script`, where
+    // `next` is the offset of the line after it.
+    template<typename Visit>
+    void ForEachLine(const std::string_view script, Visit &&visit) {
+        std::size_t line_start = 0;
+        std::size_t line_number = 1;
+        while (line_start < script.size()) {
+            auto line_end = script.find('\n', line_start);
+            if (line_end == std::string_view::npos) {
+                line_end = script.size();
+            }
+            if (!visit(script.substr(line_start, line_end - line_start), line_number, line_end + 1)) {
+                return;
+            }
+            line_start = line_end + 1;
+            line_number++;
+        }
+    }
+
+    // Hands the pages of a script back to the kernel as the run gets past them.
+    class Releaser {
+        MappedFile &file;
+        std::size_t released{0};
+
+    public:
+        explicit Releaser(MappedFile &file) : file(file) {
+        }
+
+        // everything before `offset` has run
+        void operator()(const std::size_t offset) {
+            if (offset - this->released >= RELEASE_INTERVAL) {
+                this->file.release(offset);
+                this->released = offset;
+            }
+        }
+    };
+
+    // A line on its way from the parsing thread to the interpreter's.
+    struct Statement {
+        std::string_view text;
+        // 0 past the last line
+        std::size_t line_number{0};
+        std::size_t next{0};
+        // its parse, unless the cache will hold it by the time it runs
+        std::shared_ptr<ParsedProgram> parsed;
+        // what parsing it threw, rethrown when its turn comes
+        std::exception_ptr error;
+    };
+
+    // Whole lines of a script, parsed by one task of a WorkStealingPool.
+    struct ParsedChunk {
+        struct Line {
+            std::string_view text;
+            std::shared_ptr<ParsedProgram> parsed;
+        };
+
+        std::string_view text;
+        // up to the one that failed to parse, if one did
+        std::vector<Line> lines;
+        // what parsing the line after the last of `lines` threw
+        std::exception_ptr error;
+        std::atomic<bool> parsed{false};
+
+        explicit ParsedChunk(const std::string_view text) : text(text) {
+        }
+
+        void parse() {
+            AstArena arena;
+            ForEachLine(this->text, [&](const std::string_view line, std::size_t, std::size_t) {
+                try {
+                    this->lines.push_back({line, ParseCache::parse(line, arena)});
+                    return true;
+                } catch (...) {
+                    this->error = std::current_exception();
+                    return false;
+                }
+            });
+            this->parsed.store(true, std::memory_order_release);
+            this->parsed.notify_one();
+        }
+
+        void wait() const {
+            this->parsed.wait(false, std::memory_order_acquire);
+        }
+    };
+
+    void RunSerial(Interpreter &interpreter, ParseCache &cache, MappedFile &file) {
+        Releaser release(file);
+        ForEachLine(file.contents(), [&](const std::string_view text, const std::size_t line_number,
+                                         const std::size_t next) {
+            Execute(interpreter, cache, text, line_number);
+            release(next);
+            return true;
+        });
+    }
+
+    // Lexing and parsing run ahead on a thread of their own. Compiling stays
+    // on this one with the rest: it declares globals and allocates constants,
+    // which belong to this thread.
+    void RunPipelined(Interpreter &interpreter, ParseCache &cache, MappedFile &file) {
+        const auto script = file.contents();
+        Releaser release(file);
+        const auto ring = std::make_unique<SpscRing<Statement, PIPELINE_DEPTH> >();
+        std::atomic<bool> abandoned{false};
+        std::thread parser([&] {
+            AstArena arena;
+            // parses only what the cache will miss, as this side looks it up
+            // in the same order
+            ParseCacheShadow shadow(cache.capacity());
+            ForEachLine(script, [&](const std::string_view text, const std::size_t line_number,
+                                    const std::size_t next) {
+                auto statement = Statement{.text = text, .line_number = line_number, .next = next};
+                try {
+                    if (!shadow.lookup(text)) {
+                        statement.parsed = ParseCache::parse(text, arena);
+                    }
+                } catch (...) {
+                    statement.error = std::current_exception();
+                }
+                ring->push(std::move(statement));
+                return !abandoned.load(std::memory_order_relaxed);
+            });
+            ring->push(Statement{});
+        });
+
+        try {
+            for (auto statement = ring->pop(); statement.line_number != 0; statement = ring->pop()) {
+                if (statement.error) {
+                    std::rethrow_exception(statement.error);
+                }
+                Execute(interpreter, cache, statement.text, statement.line_number, std::move(statement.parsed));
+                release(statement.next);
+            }
+        } catch (...) {
+            // unblock the parser and let it finish before leaving
+            abandoned.store(true, std::memory_order_relaxed);
+            while (ring->pop().line_number != 0) {
+            }
+            parser.join();
+            throw;
+        }
+        parser.join();
+    }
+
+    // The script is cut at line boundaries into chunks that `jobs` threads
+    // parse in any order, a bounded number ahead of the one running them in
+    // order. Every line is parsed, as which will hit the cache depends on the
+    // order; a hit just drops its parse.
+    void RunParallel(Interpreter &interpreter, ParseCache &cache, MappedFile &file, const std::size_t jobs) {
+        const auto script = file.contents();
+        Releaser release(file);
+        // declared after `file`, so queued tasks finish before it is unmapped
+        WorkStealingPool pool(jobs);
+        std::deque<std::shared_ptr<ParsedChunk> > window;
+        std::size_t chunk_start = 0;
+        std::size_t line_number = 1;
+        while (chunk_start < script.size() || !window.empty()) {
+            while (chunk_start < script.size() && window.size() < PARALLEL_WINDOW * jobs) {
+                auto chunk_end = script.size();
+                if (chunk_start + PARALLEL_CHUNK < script.size()) {
+                    const auto newline = script.find('\n', chunk_start + PARALLEL_CHUNK);
+                    chunk_end = newline == std::string_view::npos ? script.size() : newline + 1;
+                }
+                auto chunk = std::make_shared<ParsedChunk>(script.substr(chunk_start, chunk_end - chunk_start));
+                pool.submit([chunk] { chunk->parse(); });
+                window.push_back(std::move(chunk));
+                chunk_start = chunk_end;
+            }
+
+            const auto chunk = std::move(window.front());
+            window.pop_front();
+            chunk->wait();
+            for (auto &line: chunk->lines) {
+                Execute(interpreter, cache, line.text, line_number++, std::move(line.parsed));
+            }
+            if (chunk->error) {
+                std::rethrow_exception(chunk->error);
+            }
+            release(chunk->text.data() + chunk->text.size() - script.data());
+        }
+    }
+}
+
+[[noreturn]] void REPL::Start(const std::size_t cache_capacity) {
     std::cout << "------------------ REPL::Start() ------------------" << std::endl;
 
     const auto interpreter = std::make_unique<Interpreter>();
+    ParseCache cache(interpreter->global_scope(), cache_capacity);
 
     while (true) {
         std::string input_line;
@@ -25,16 +261,80 @@
             continue;
         }
 
-        try {
-            auto lexer = std::make_unique<Lexer>(input_line);
-            const auto parser = std::make_unique<Parser>(lexer);
+        if (input_line.starts_with(":bytecode ")) {
+            const auto program = cache.get(std::string_view(input_line).substr(10));
+            for (const auto &chunk: program->chunks) {
+                fmt::print("{}", disassemble(chunk));
+            }
+            continue;
+        }
+        if (input_line.starts_with(":ic ")) {
+            const auto program = cache.get(std::string_view(input_line).substr(4));
+            for (const auto &chunk: program->chunks) {
+                fmt::print("{}", describeCaches(chunk));
+            }
+            continue;
+        }
+        if (input_line == ":gc") {
+            const auto collected = Heap::local().collect();
+            fmt::println("collected {} objects; {}", collected, Heap::local().describe());
+            continue;
+        }
+        if (input_line == ":pools") {
+            fmt::print("{}", Heap::local().describePools());
+            continue;
+        }
+        if (input_line == ":commit") {
+            fmt::println("committed epoch {}", interpreter->commit());
+            continue;
+        }
+        if (input_line == ":cache") {
+            fmt::println("{} of {} entries, {} hits, {} misses, {} shared", cache.size(), cache.capacity(),
+                         cache.hits(), cache.misses(), cache.shared());
+            continue;
+        }
 
-            auto expr = parser->parse();
+        Execute(*interpreter, cache, input_line, 1);
+    }
+}
 
-            const auto object = interpreter->visit(*expr);
-            fmt::println("{}", object->toString());
-        } catch (...) {
-            fmt::println("ERROR");
-        }
+std::size_t REPL::ParseJobs() {
+    return std::max(1u, std::thread::hardware_concurrency()) - 1;
+}
+
+void REPL::RunFile(const std::string &path, const std::size_t cache_capacity, const std::size_t jobs) {
+    const auto interpreter = std::make_unique<Interpreter>();
+    ParseCache cache(interpreter->global_scope(), cache_capacity);
+    RunFile(*interpreter, cache, path, jobs);
+}
+
+void REPL::RunFile(Interpreter &interpreter, ParseCache &cache, const std::string &path, const std::size_t jobs) {
+    MappedFile file(path);
+    if (jobs == 0) {
+        RunSerial(interpreter, cache, file);
+    } else if (jobs == 1) {
+        RunPipelined(interpreter, cache, file);
+    } else {
+        RunParallel(interpreter, cache, file, jobs);
+    }
+}
+
+void REPL::Serve(const std::string &socket_path, const std::string &preload, const std::size_t cache_capacity) {
+    const auto workers = std::max(2u, std::thread::hardware_concurrency());
+    Server server(socket_path, workers, cache_capacity, preload);
+    fmt::println("serving {} with {} workers", socket_path, workers);
+    server.run();
+}
+
+std::size_t REPL::CheckFile(const std::string &path) {
+    const MappedFile file(path);
+    auto lexer = std::make_unique<Lexer>(file.contents());
+    AstArena arena;
+    Parser parser(lexer, arena);
+    parser.parse_program();
+
+    for (const auto &diagnostic: parser.diagnostics()) {
+        fmt::println("{}:{}:{}: {}", path, diagnostic.line, diagnostic.column, diagnostic.message);
     }
+    return parser.diagnostics().size();
 }
@@ -0,0 +1,573 @@
+//
+// Created by mizuk on 2025/3/28.
+//
+
+#include <algorithm>
+#include <array>
+#include <functional>
+#include <iterator>
+#include <stdexcept>
+#include <string_view>
+#include <system_error>
+#include <utility>
+#include <fmt/format.h>
+#include <repl/heap.h>
+#include <repl/interpreter.h>
+#include <repl/parse_cache.h>
+#include <repl/repl.h>
+#include <repl/server.h>
+#include <repl/versions.h>
+
+#ifdef __linux__
+#include <cerrno>
+#include <sys/epoll.h>
+#include <sys/eventfd.h>
+#include <sys/socket.h>
+#include <sys/stat.h>
+#include <sys/un.h>
+#include <unistd.h>
+#endif
+
+void Server::Queue::push(Request request) {
+    {
+        const std::lock_guard lock(this->mutex);
+        this->requests.push_back(std::move(request));
+    }
+    this->ready.notify_one();
+}
+
+std::optional<Server::Request> Server::Queue::pop() {
+    std::unique_lock lock(this->mutex);
+    this->ready.wait(lock, [this] { return this->closed || !this->requests.empty(); });
+    if (this->requests.empty()) {
+        return std::nullopt;
+    }
+    auto request = std::move(this->requests.front());
+    this->requests.pop_front();
+    return request;
+}
+
+std::vector<Server::Request> Server::Queue::drain() {
+    std::unique_lock lock(this->mutex);
+    this->ready.wait(lock, [this] { return this->closed || !this->requests.empty(); });
+    auto batch = std::vector<Request>(std::make_move_iterator(this->requests.begin()),
+                                      std::make_move_iterator(this->requests.end()));
+    this->requests.clear();
+    return batch;
+}
+
+void Server::Queue::close() {
+    {
+        const std::lock_guard lock(this->mutex);
+        this->closed = true;
+    }
+    this->ready.notify_all();
+}
+
+#ifdef __linux__
+
+namespace {
+    // epoll keys; connections are numbered from 2
+    constexpr std::uint64_t LISTENER = 0;
+    constexpr std::uint64_t WAKE = 1;
+
+    // bytes of responses a client has left unread before no more of its
+    // requests are taken
+    constexpr std::size_t MAX_UNREAD = 1 << 20;
+
+    constexpr std::size_t HEADER = 4;
+
+    [[noreturn]] void fail(const std::string &what) {
+        throw std::system_error(errno, std::generic_category(), what);
+    }
+
+    sockaddr_un socketAddress(const std::string &path) {
+        sockaddr_un address{};
+        if (path.empty() || path.size() >= sizeof(address.sun_path)) {
+            throw std::invalid_argument(fmt::format("Not a usable socket path: {}", path));
+        }
+        address.sun_family = AF_UNIX;
+        std::ranges::copy(path, address.sun_path);
+        return address;
+    }
+
+    std::string frame(const std::string_view text) {
+        const auto length = static_cast<std::uint32_t>(text.size());
+        auto bytes = std::string(HEADER, '\0');
+        for (std::size_t i = 0; i < HEADER; i++) {
+            bytes[i] = static_cast<char>(length >> (8 * i) & 0xff);
+        }
+        bytes += text;
+        return bytes;
+    }
+
+    std::uint32_t frameLength(const std::string_view header) {
+        std::uint32_t length = 0;
+        for (std::size_t i = 0; i < HEADER; i++) {
+            length |= static_cast<std::uint32_t>(static_cast<unsigned char>(header[i])) << (8 * i);
+        }
+        return length;
+    }
+
+    // a whole request is waiting in `input`
+    bool framed(const std::string &input) {
+        return input.size() >= HEADER && input.size() - HEADER >= frameLength(input);
+    }
+
+    // Sends an interpreter's print output to a sink for as long as it lives,
+    // so the sink, which usually refers to a local, is never left behind.
+    class OutputGuard {
+        Interpreter &interpreter;
+
+    public:
+        OutputGuard(Interpreter &interpreter, std::function<void(std::string_view)> sink)
+            : interpreter(interpreter) {
+            this->interpreter.set_output(std::move(sink));
+        }
+
+        OutputGuard(const OutputGuard &) = delete;
+
+        OutputGuard &operator=(const OutputGuard &) = delete;
+
+        ~OutputGuard() {
+            this->interpreter.set_output(nullptr);
+        }
+    };
+
+    // What the prompt would print for `text`, print statements' output
+    // included, lines joined by '\n'.
+    std::string execute(Interpreter &interpreter, ParseCache &cache, const std::string_view text) {
+        const auto program = cache.get(text);
+        std::string response;
+        const auto line = [&response](const std::string_view printed) {
+            if (!response.empty()) {
+                response += '\n';
+            }
+            response += printed;
+        };
+        for (const auto &diagnostic: program->diagnostics) {
+            line(fmt::format("ERROR: {}:{}: {}", diagnostic.line, diagnostic.column, diagnostic.message));
+        }
+        const OutputGuard output(interpreter, line);
+        for (const auto &chunk: program->chunks) {
+            try {
+                line(interpreter.run(chunk).toString());
+            } catch (...) {
+                line("ERROR");
+            }
+            Heap::local().maybeCollect();
+        }
+        return response;
+    }
+
+    void sendAll(const int fd, std::string_view bytes) {
+        while (!bytes.empty()) {
+            const auto sent = ::send(fd, bytes.data(), bytes.size(), MSG_NOSIGNAL);
+            if (sent < 0) {
+                if (errno == EINTR) {
+                    continue;
+                }
+                fail("send");
+            }
+            bytes.remove_prefix(static_cast<std::size_t>(sent));
+        }
+    }
+
+    void receiveAll(const int fd, char *bytes, std::size_t size) {
+        while (size > 0) {
+            const auto received = ::recv(fd, bytes, size, 0);
+            if (received == 0) {
+                throw std::runtime_error("Server hung up");
+            }
+            if (received < 0) {
+                if (errno == EINTR) {
+                    continue;
+                }
+                fail("recv");
+            }
+            bytes += received;
+            size -= static_cast<std::size_t>(received);
+        }
+    }
+}
+
+Server::Server(std::string path, const std::size_t workers, const std::size_t cache_capacity, std::string preload)
+    : path(std::move(path)) {
+    try {
+        const auto address = socketAddress(this->path);
+        // what a server that is gone left behind would make bind fail
+        struct stat status{};
+        if (::stat(this->path.c_str(), &status) == 0 && S_ISSOCK(status.st_mode)) {
+            ::unlink(this->path.c_str());
+        }
+        this->listener = ::socket(AF_UNIX, SOCK_STREAM | SOCK_NONBLOCK | SOCK_CLOEXEC, 0);
+        if (this->listener < 0) {
+            fail("socket");
+        }
+        if (::bind(this->listener, reinterpret_cast<const sockaddr *>(&address), sizeof(address)) != 0) {
+            fail(this->path);
+        }
+        this->bound = true;
+        if (::listen(this->listener, SOMAXCONN) != 0) {
+            fail("listen");
+        }
+
+        this->epoll = ::epoll_create1(EPOLL_CLOEXEC);
+        this->wake = ::eventfd(0, EFD_NONBLOCK | EFD_CLOEXEC);
+        if (this->epoll < 0 || this->wake < 0) {
+            fail("epoll");
+        }
+        for (const auto &[fd, key]: {std::pair{this->listener, LISTENER}, std::pair{this->wake, WAKE}}) {
+            epoll_event event{.events = EPOLLIN, .data = {.u64 = key}};
+            if (::epoll_ctl(this->epoll, EPOLL_CTL_ADD, fd, &event) != 0) {
+                fail("epoll_ctl");
+            }
+        }
+
+        std::promise<Versions *> started;
+        auto versions = started.get_future();
+        this->writer = std::thread([this, cache_capacity, &preload, &started] {
+            this->runWriter(cache_capacity, preload, started);
+        });
+        this->versions = versions.get();
+        // each holds at most one snapshot
+        for (std::size_t i = 0; i < std::clamp<std::size_t>(workers, 1, Versions::MAX_READERS); i++) {
+            this->workers.emplace_back(&Server::runWorker, this);
+        }
+    } catch (...) {
+        this->shutdown();
+        throw;
+    }
+}
+
+Server::~Server() {
+    this->shutdown();
+}
+
+void Server::shutdown() {
+    // workers hand writes on, so they stop first; the writer stops last, as
+    // it owns the versions they read
+    this->reads.close();
+    for (auto &worker: this->workers) {
+        worker.join();
+    }
+    this->workers.clear();
+    this->writes.close();
+    if (this->writer.joinable()) {
+        this->writer.join();
+    }
+
+    for (const auto &[id, connection]: this->connections) {
+        ::close(connection.fd);
+    }
+    this->connections.clear();
+    for (const auto fd: {this->listener, this->epoll, this->wake}) {
+        if (fd >= 0) {
+            ::close(fd);
+        }
+    }
+    this->listener = this->epoll = this->wake = -1;
+    if (this->bound) {
+        ::unlink(this->path.c_str());
+        this->bound = false;
+    }
+}
+
+void Server::runWriter(const std::size_t cache_capacity, const std::string &preload,
+                       std::promise<Versions *> &started) {
+    // everything the interpreter allocates lives and dies on this thread
+    const auto interpreter = std::make_unique<Interpreter>();
+    ParseCache cache(interpreter->global_scope(), cache_capacity);
+    try {
+        if (!preload.empty()) {
+            REPL::RunFile(*interpreter, cache, preload);
+        }
+        interpreter->commit();
+    } catch (...) {
+        started.set_exception(std::current_exception());
+        return;
+    }
+    started.set_value(&interpreter->versions());
+
+    while (true) {
+        auto batch = this->writes.drain();
+        if (batch.empty()) {
+            return;
+        }
+        auto responses = std::vector<std::string>();
+        responses.reserve(batch.size());
+        for (const auto &request: batch) {
+            responses.push_back(execute(*interpreter, cache, request.text));
+        }
+        // one commit for the batch, before any of it is answered
+        interpreter->commit();
+        for (std::size_t i = 0; i < batch.size(); i++) {
+            this->respond(batch[i].connection, std::move(responses[i]));
+        }
+    }
+}
+
+void Server::runWorker() {
+    while (auto request = this->reads.pop()) {
+        std::string response;
+        try {
+            const auto snapshot = this->versions->pin();
+            response = snapshot.read(request->text);
+        } catch (const std::invalid_argument &) {
+            // not a read
+            this->writes.push(std::move(*request));
+            continue;
+        } catch (...) {
+            response = "ERROR";
+        }
+        this->respond(request->connection, std::move(response));
+    }
+}
+
+void Server::respond(const std::uint64_t connection, std::string text) {
+    {
+        const std::lock_guard lock(this->finished_mutex);
+        this->finished.push_back({connection, std::move(text)});
+    }
+    constexpr std::uint64_t one = 1;
+    static_cast<void>(::write(this->wake, &one, sizeof(one)));
+}
+
+void Server::run() {
+    auto events = std::array<epoll_event, 64>();
+    while (!this->stopping.load()) {
+        const auto count = ::epoll_wait(this->epoll, events.data(), static_cast<int>(events.size()), -1);
+        if (count < 0) {
+            if (errno == EINTR) {
+                continue;
+            }
+            fail("epoll_wait");
+        }
+        for (int i = 0; i < count; i++) {
+            const auto id = events[i].data.u64;
+            if (id == LISTENER) {
+                this->accept();
+                continue;
+            }
+            if (id == WAKE) {
+                this->deliver();
+                continue;
+            }
+            // may have been closed by an earlier event of this round
+            const auto found = this->connections.find(id);
+            if (found == this->connections.end()) {
+                continue;
+            }
+            if (events[i].events & (EPOLLHUP | EPOLLERR)) {
+                // gone both ways, so nothing can be answered
+                this->close(id);
+                continue;
+            }
+            if (events[i].events & EPOLLIN && !this->receive(id, found->second)) {
+                continue;
+            }
+            this->progress(id, found->second);
+        }
+    }
+}
+
+void Server::stop() {
+    this->stopping.store(true);
+    constexpr std::uint64_t one = 1;
+    static_cast<void>(::write(this->wake, &one, sizeof(one)));
+}
+
+void Server::accept() {
+    while (true) {
+        const auto fd = ::accept4(this->listener, nullptr, nullptr, SOCK_NONBLOCK | SOCK_CLOEXEC);
+        if (fd < 0) {
+            if (errno == EINTR || errno == ECONNABORTED) {
+                continue;
+            }
+            // EAGAIN once the backlog is empty; anything else, such as running
+            // out of descriptors, is retried when the loop comes round again
+            return;
+        }
+        const auto id = this->next_connection++;
+        epoll_event event{.events = EPOLLIN, .data = {.u64 = id}};
+        if (::epoll_ctl(this->epoll, EPOLL_CTL_ADD, fd, &event) != 0) {
+            ::close(fd);
+            continue;
+        }
+        this->connections.emplace(id, Connection{.fd = fd, .events = EPOLLIN});
+    }
+}
+
+void Server::deliver() {
+    std::uint64_t count;
+    static_cast<void>(::read(this->wake, &count, sizeof(count)));
+
+    auto responses = std::vector<Request>();
+    {
+        const std::lock_guard lock(this->finished_mutex);
+        std::swap(responses, this->finished);
+    }
+    for (auto &response: responses) {
+        // one that hung up completely while its request was running is gone
+        const auto found = this->connections.find(response.connection);
+        if (found == this->connections.end()) {
+            continue;
+        }
+        auto &connection = found->second;
+        connection.output += frame(response.text);
+        connection.busy = false;
+        this->progress(response.connection, connection);
+    }
+}
+
+bool Server::receive(const std::uint64_t id, Connection &connection) {
+    auto buffer = std::array<char, 64 * 1024>();
+    while (true) {
+        const auto received = ::recv(connection.fd, buffer.data(), buffer.size(), 0);
+        if (received > 0) {
+            connection.input.append(buffer.data(), static_cast<std::size_t>(received));
+            // one frame may be waiting; no need to read more behind it yet
+            if (framed(connection.input)) {
+                break;
+            }
+            continue;
+        }
+        if (received == 0) {
+            connection.hung_up = true;
+            break;
+        }
+        if (errno == EINTR) {
+            continue;
+        }
+        if (errno == EAGAIN || errno == EWOULDBLOCK) {
+            break;
+        }
+        this->close(id);
+        return false;
+    }
+    if (connection.input.size() >= HEADER && frameLength(connection.input) > MAX_FRAME) {
+        this->close(id);
+        return false;
+    }
+    return true;
+}
+
+bool Server::progress(const std::uint64_t id, Connection &connection) {
+    if (!connection.busy && connection.output.size() < MAX_UNREAD && framed(connection.input)) {
+        const auto length = frameLength(connection.input);
+        auto text = connection.input.substr(HEADER, length);
+        connection.input.erase(0, HEADER + length);
+        connection.busy = true;
+        // workers hand anything but a read on to the writer
+        this->reads.push({id, std::move(text)});
+    }
+
+    std::size_t written = 0;
+    while (written < connection.output.size()) {
+        const auto sent = ::send(connection.fd, connection.output.data() + written, connection.output.size() - written,
+                                 MSG_NOSIGNAL);
+        if (sent > 0) {
+            written += static_cast<std::size_t>(sent);
+            continue;
+        }
+        if (sent < 0 && errno == EINTR) {
+            continue;
+        }
+        if (sent < 0 && (errno == EAGAIN || errno == EWOULDBLOCK)) {
+            break;
+        }
+        this->close(id);
+        return false;
+    }
+    connection.output.erase(0, written);
+
+    if (connection.hung_up && !connection.busy && connection.output.empty()) {
+        this->close(id);
+        return false;
+    }
+
+    // stop reading while a whole request already waits its turn, so a client
+    // that sends faster than it is answered is held back by its socket buffer
+    std::uint32_t events = 0;
+    if (!connection.hung_up && !framed(connection.input)) {
+        events |= EPOLLIN;
+    }
+    if (!connection.output.empty()) {
+        events |= EPOLLOUT;
+    }
+    if (events != connection.events) {
+        epoll_event event{.events = events, .data = {.u64 = id}};
+        ::epoll_ctl(this->epoll, EPOLL_CTL_MOD, connection.fd, &event);
+        connection.events = events;
+    }
+    return true;
+}
+
+void Server::close(const std::uint64_t id) {
+    const auto found = this->connections.find(id);
+    ::close(found->second.fd);
+    this->connections.erase(found);
+}
+
+Client::Client(const std::string &path) {
+    const auto address = socketAddress(path);
+    this->fd = ::socket(AF_UNIX, SOCK_STREAM | SOCK_CLOEXEC, 0);
+    if (this->fd < 0) {
+        fail("socket");
+    }
+    if (::connect(this->fd, reinterpret_cast<const sockaddr *>(&address), sizeof(address)) != 0) {
+        const auto error = errno;
+        ::close(this->fd);
+        throw std::system_error(error, std::generic_category(), path);
+    }
+}
+
+Client::~Client() {
+    ::close(this->fd);
+}
+
+void Client::send(const std::string_view request) const {
+    sendAll(this->fd, frame(request));
+}
+
+std::string Client::receive() const {
+    auto header = std::array<char, HEADER>();
+    receiveAll(this->fd, header.data(), header.size());
+    auto text = std::string(frameLength(std::string_view(header.data(), header.size())), '\0');
+    receiveAll(this->fd, text.data(), text.size());
+    return text;
+}
+
+#else
+
+Server::Server(std::string path, std::size_t, std::size_t, std::string) : path(std::move(path)) {
+    throw std::runtime_error("Serving needs epoll, which only Linux has");
+}
+
+Server::~Server() = default;
+
+void Server::run() {
+}
+
+void Server::stop() {
+}
+
+Client::Client(const std::string &) {
+    throw std::runtime_error("Serving needs epoll, which only Linux has");
+}
+
+Client::~Client() = default;
+
+void Client::send(std::string_view) const {
+}
+
+std::string Client::receive() const {
+    return {};
+}
+
+#endif
+
+std::string Client::request(const std::string_view request) const {
+    this->send(request);
+    return this->receive();
+}
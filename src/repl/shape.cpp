@@ -0,0 +1,147 @@
+//
+// Created by mizuk on 2025/3/20.
+//
+
+#include <algorithm>
+#include <mutex>
+#include <repl/shape.h>
+
+Shape::Shape() : parent(nullptr), key(Atom::fromId(0)), count(0), is_dictionary(false) {
+}
+
+Shape::Shape(const Shape *parent, const Atom key)
+    : parent(parent), key(key), count(parent->count + 1), is_dictionary(false) {
+}
+
+Shape::Shape(std::vector<Atom> keys)
+    : parent(nullptr), key(Atom::fromId(0)), count(static_cast<std::uint32_t>(keys.size())), is_dictionary(true) {
+    std::call_once(this->table_built, [&] {
+        this->table = std::make_unique<Table>();
+        this->table->offsets.reserve(keys.size());
+        for (std::uint32_t offset = 0; offset < keys.size(); offset++) {
+            this->table->offsets.try_emplace(keys[offset], offset);
+        }
+        this->table->keys = std::move(keys);
+    });
+}
+
+const Shape *Shape::empty() {
+    static Shape root;
+    return &root;
+}
+
+const Shape::Table &Shape::tableOf() const {
+    std::call_once(this->table_built, [&] {
+        auto built = std::make_unique<Table>();
+        built->keys.reserve(this->count);
+        built->offsets.reserve(this->count);
+        for (auto *shape = this; shape->count != 0; shape = shape->parent) {
+            built->keys.push_back(shape->key);
+            built->offsets.try_emplace(shape->key, shape->count - 1);
+        }
+        std::ranges::reverse(built->keys);
+        this->table = std::move(built);
+    });
+    return *this->table;
+}
+
+std::optional<std::uint32_t> Shape::offset(const Atom key) const {
+    if (this->count > CHAIN_KEYS) {
+        const auto &offsets = this->tableOf().offsets;
+        if (const auto found = offsets.find(key); found != offsets.end()) {
+            return found->second;
+        }
+        return std::nullopt;
+    }
+    for (auto *shape = this; shape->count != 0; shape = shape->parent) {
+        if (shape->key == key) {
+            return shape->count - 1;
+        }
+    }
+    return std::nullopt;
+}
+
+std::vector<Atom> Shape::keyList() const {
+    if (this->count > CHAIN_KEYS) {
+        return this->tableOf().keys;
+    }
+    auto keys = std::vector<Atom>();
+    keys.reserve(this->count);
+    for (auto *shape = this; shape->count != 0; shape = shape->parent) {
+        keys.push_back(shape->key);
+    }
+    std::ranges::reverse(keys);
+    return keys;
+}
+
+const Shape *Shape::shared(const std::span<const Atom> keys) {
+    auto shape = empty();
+    // not shape->offset(), which would build a table for every prefix
+    auto seen = FlatHashMap<Atom, bool>();
+    seen.reserve(std::min<std::size_t>(keys.size(), MAX_SHARED_KEYS + 1));
+    for (const auto key: keys) {
+        if (!seen.try_emplace(key, true).second) {
+            continue;
+        }
+        if (shape->count == MAX_SHARED_KEYS) {
+            return nullptr;
+        }
+        shape = shape->child(key);
+    }
+    return shape;
+}
+
+const Shape *Shape::of(const std::span<const Atom> keys) {
+    if (const auto *shape = shared(keys)) {
+        return shape;
+    }
+    auto distinct = std::vector<Atom>();
+    auto seen = FlatHashMap<Atom, bool>();
+    seen.reserve(keys.size());
+    for (const auto key: keys) {
+        if (seen.try_emplace(key, true).second) {
+            distinct.push_back(key);
+        }
+    }
+    return new Shape(std::move(distinct));
+}
+
+const Shape *Shape::with(const Atom key) const {
+    if (this->offset(key)) {
+        return this;
+    }
+    if (this->count < MAX_SHARED_KEYS && !this->is_dictionary) {
+        return this->child(key);
+    }
+    auto keys = this->keyList();
+    keys.push_back(key);
+    return new Shape(std::move(keys));
+}
+
+const Shape *Shape::child(const Atom key) const {
+    {
+        std::shared_lock lock(this->mutex);
+        if (const auto found = this->transitions.find(key); found != this->transitions.end()) {
+            return found->second.get();
+        }
+    }
+    std::unique_lock lock(this->mutex);
+    // another thread may have added it between the two locks
+    auto &child = this->transitions[key];
+    if (child == nullptr) {
+        child.reset(new Shape(this, key));
+    }
+    return child.get();
+}
+
+void Shape::retain() const {
+    if (this->is_dictionary) {
+        this->references.fetch_add(1, std::memory_order_relaxed);
+    }
+}
+
+void Shape::release() const {
+    if (this->is_dictionary && this->references.fetch_sub(1, std::memory_order_acq_rel) == 1) {
+        delete this;
+    }
+}
@@ -3,3 +3,47 @@
 //
 
 #include <repl/token.h>
+
+std::string_view toString(const TokenType type) {
+    switch (type) {
+        case TokenType::DOLLAR:
+            return "'$'";
+        case TokenType::EQ:
+            return "'='";
+        case TokenType::LEFT_CURLY:
+            return "'{'";
+        case TokenType::RIGHT_CURLY:
+            return "'}'";
+        case TokenType::LEFT_SQUARE:
+            return "'['";
+        case TokenType::RIGHT_SQUARE:
+            return "']'";
+        case TokenType::LEFT_PAREN:
+            return "'('";
+        case TokenType::RIGHT_PAREN:
+            return "')'";
+        case TokenType::AT:
+            return "'@'";
+        case TokenType::PRINT:
+            return "'print'";
+        case TokenType::NIL:
+            return "'nil'";
+        case TokenType::DOT:
+            return "'.'";
+        case TokenType::COMMA:
+            return "','";
+        case TokenType::SEMICOLON:
+            return "';'";
+        case TokenType::NEWLINE:
+            return "newline";
+        case TokenType::IDENTIFIER:
+            return "identifier";
+        case TokenType::NUMBER:
+            return "number";
+        case TokenType::INVALID:
+            return "invalid token";
+        case TokenType::EOF_:
+            return "end of input";
+    }
+    return "unknown token";
+}
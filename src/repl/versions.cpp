@@ -0,0 +1,428 @@
+//
+// Created by mizuk on 2025/3/26.
+//
+
+#include <algorithm>
+#include <bit>
+#include <stdexcept>
+#include <fmt/format.h>
+#include <repl/flat_ast.h>
+#include <repl/interpreter.h>
+#include <repl/lexer.h>
+#include <repl/object.h>
+#include <repl/parser.h>
+#include <repl/versions.h>
+
+namespace {
+    // f(position, child) for each object `object` holds, by Array index or
+    // Map offset
+    template<typename F>
+    void forEachHeld(const Object &object, F f) {
+        if (const auto *array = dynamic_cast<const Array *>(&object)) {
+            if (array->packed()) {
+                return;
+            }
+            for (std::uint32_t i = 0; i < array->size(); i++) {
+                if (auto *child = array->element(i).object()) {
+                    f(i, *child);
+                }
+            }
+        } else if (const auto *map = dynamic_cast<const Map *>(&object)) {
+            for (std::uint32_t offset = 0; offset < map->size(); offset++) {
+                if (auto *child = map->value(offset).object()) {
+                    f(offset, *child);
+                }
+            }
+        }
+    }
+
+    Value held(const Object &object, const std::uint32_t position) {
+        if (const auto *array = dynamic_cast<const Array *>(&object)) {
+            return array->get(position);
+        }
+        return dynamic_cast<const Map &>(object).value(position);
+    }
+
+    // a copy of the frozen `object`, sharing its contents until hold() stores
+    Value copyOf(const Object &object) {
+        if (const auto *array = dynamic_cast<const Array *>(&object)) {
+            return Value::make<Array>(*array);
+        }
+        return Value::make<Map>(dynamic_cast<const Map &>(object));
+    }
+
+    void hold(Object &copy, const std::uint32_t position, const Value &value) {
+        if (auto *array = dynamic_cast<Array *>(&copy)) {
+            array->set(position, value);
+        } else {
+            dynamic_cast<Map &>(copy).setValue(position, value);
+        }
+    }
+
+    void unhold(VersionLink &link, const VersionLink *holder, const std::uint32_t position) {
+        const auto found = std::ranges::find(link.holders, std::pair(const_cast<VersionLink *>(holder), position));
+        if (found != link.holders.end()) {
+            *found = link.holders.back();
+            link.holders.pop_back();
+        }
+    }
+}
+
+Freezer::Freezer(Versions *versions, const std::uint64_t epoch) : versions(versions), epoch(epoch) {
+}
+
+Value Freezer::freeze(const Value &value) {
+    const auto *object = value.object();
+    if (object == nullptr) {
+        return value;
+    }
+    if (object->link != nullptr && object->link->versions == this->versions) {
+        return object->link->copy;
+    }
+    if (const auto found = this->copies.find(object); found != this->copies.end()) {
+        return found->second;
+    }
+    auto *copy = object->freeze(*this);
+    if (copy == nullptr) {
+        return value;
+    }
+    return this->copies.find(object)->second;
+}
+
+void Freezer::remember(const Object *original, Object *copy) {
+    this->copies.try_emplace(original, Value(copy));
+    auto *link = original->link;
+    if (link == nullptr) {
+        link = this->versions->adopt(*original);
+    } else if (link->versions != this->versions) {
+        // committed by another Versions, which follows its stores
+        return;
+    }
+    link->copy = Value(copy);
+    link->epoch = this->epoch;
+    this->adopted.push_back(original);
+}
+
+Snapshot::Snapshot(Versions *versions, const std::size_t reader, const GlobalsVersion *version)
+    : versions(versions), reader(reader), version(version) {
+}
+
+Snapshot::Snapshot(Snapshot &&other) noexcept
+    : versions(std::exchange(other.versions, nullptr)), reader(other.reader), version(other.version) {
+}
+
+Snapshot::~Snapshot() {
+    if (this->versions != nullptr) {
+        this->versions->unpin(this->reader);
+    }
+}
+
+std::uint64_t Snapshot::epoch() const {
+    return this->version == nullptr ? 0 : this->version->epoch;
+}
+
+const Value *Snapshot::get(const Atom name) const {
+    if (this->version == nullptr) {
+        return nullptr;
+    }
+    const auto found = this->version->directory->find(name);
+    if (found == this->version->directory->end() || found->second >= this->version->slots.size()) {
+        return nullptr;
+    }
+    const auto &value = this->version->slots[found->second];
+    return value ? &value : nullptr;
+}
+
+std::string Snapshot::read(const std::string_view path) const {
+    auto lexer = std::make_unique<Lexer>(path);
+    Parser parser(lexer);
+    const auto ast = parser.parse_program_flat();
+    // exactly one statement, which parsed cleanly
+    const auto statements = ast.childrenOf(ast.root());
+    if (!parser.diagnostics().empty() || statements.size() != 1) {
+        throw std::invalid_argument(fmt::format("Not a single statement: {}", path));
+    }
+    const auto root = statements[0];
+    if (ast.kind(root) != NodeKind::VARIABLE && ast.kind(root) != NodeKind::ACCESS_PATH) {
+        throw std::invalid_argument(fmt::format("Not an access path: {}", path));
+    }
+
+    // children: root variable, then one NUMBER or SYMBOL per step
+    const auto nodes = ast.kind(root) == NodeKind::VARIABLE
+                           ? std::span<const NodeIndex>(&root, 1)
+                           : ast.childrenOf(root);
+    if (ast.kind(root) == NodeKind::ACCESS_PATH && nodes.size() > ast.operand(root) + 1) {
+        throw std::invalid_argument(fmt::format("Not a read: {}", path));
+    }
+    const auto *value = this->get(ast.atom(nodes[0]));
+    if (value == nullptr) {
+        throw InterpreterError(InterpretErrorType::UNDEFINED_VARIABLE);
+    }
+
+    // Walked by reference, never copying a Value that refers to an object; a
+    // packed element is an immediate made here.
+    Value element;
+    for (const auto step: nodes.subspan(1)) {
+        if (ast.kind(step) == NodeKind::NUMBER) {
+            const auto index = std::bit_cast<int>(ast.operand(step));
+            const auto *array = dynamic_cast<const Array *>(value->object());
+            if (array == nullptr) {
+                throw std::logic_error(fmt::format("Not implemented _get_item on {}", value->toString()));
+            }
+            if (index < 0 || static_cast<std::size_t>(index) >= array->size()) {
+                throw std::out_of_range(fmt::format("Index {} out of range", index));
+            }
+            if (array->packed()) {
+                element = array->get(index);
+                value = &element;
+            } else {
+                value = &array->element(index);
+            }
+        } else {
+            const auto key = ast.atom(step);
+            const auto *map = dynamic_cast<const Map *>(value->object());
+            if (map == nullptr) {
+                throw std::logic_error(fmt::format("Not implemented _get_item on {}", value->toString()));
+            }
+            const auto offset = map->shape->offset(key);
+            if (!offset) {
+                throw std::out_of_range(fmt::format("Key {} not found", key.str()));
+            }
+            value = &map->value(*offset);
+        }
+    }
+    return value->toString();
+}
+
+Versions::~Versions() {
+    // the objects outlive the links' use
+    for (auto *link = this->links; link != nullptr; link = link->next) {
+        link->versions = nullptr;
+    }
+    delete this->current.load();
+}
+
+VersionLink *Versions::adopt(const Object &object) {
+    auto *link = new VersionLink{this, Value(), 0};
+    link->next = std::exchange(this->links, link);
+    if (link->next != nullptr) {
+        link->next->previous = link;
+    }
+    object.link = link;
+    return link;
+}
+
+void Versions::queue(Object &object, VersionLink &link) {
+    if (!link.queued) {
+        link.queued = true;
+        this->stored.emplace_back(&object);
+    }
+}
+
+void Versions::storing(Object &object, const std::uint32_t position, const Value &old) {
+    auto &link = *object.link;
+    if (link.versions == nullptr) {
+        return;
+    }
+    if (const auto *child = old.object(); child != nullptr && child->link != nullptr) {
+        unhold(*child->link, &link, position);
+    }
+    link.stored.push_back(position);
+    link.versions->queue(object, link);
+}
+
+void Versions::refilling(Object &object) {
+    auto &link = *object.link;
+    if (link.versions == nullptr) {
+        return;
+    }
+    forEachHeld(object, [&](const std::uint32_t position, const Object &child) {
+        if (child.link != nullptr) {
+            unhold(*child.link, &link, position);
+        }
+    });
+    link.refilled = true;
+    link.versions->queue(object, link);
+}
+
+void Versions::unslot(const Object &old, const std::uint32_t slot) {
+    unhold(*old.link, nullptr, slot);
+}
+
+void Versions::forget(Object &object) {
+    auto *link = std::exchange(object.link, nullptr);
+    forEachHeld(object, [&](const std::uint32_t position, const Object &child) {
+        if (child.link != nullptr) {
+            unhold(*child.link, link, position);
+        }
+    });
+    if (link->versions != nullptr) {
+        (link->previous != nullptr ? link->previous->next : link->versions->links) = link->next;
+        if (link->next != nullptr) {
+            link->next->previous = link->previous;
+        }
+    }
+    delete link;
+}
+
+std::uint64_t Versions::commit(Globals &globals) {
+    auto version = std::make_unique<GlobalsVersion>();
+    version->epoch = this->next_epoch++;
+
+    // names are only ever added, so an unchanged count is an unchanged table
+    auto *previous = this->current.load();
+    if (previous != nullptr && previous->directory->size() == globals.slot_count()) {
+        version->directory = previous->directory;
+    } else {
+        auto directory = std::make_shared<FlatHashMap<Atom, std::uint32_t> >();
+        directory->reserve(globals.slot_count());
+        for (std::uint32_t slot = 0; slot < globals.slot_count(); slot++) {
+            directory->try_emplace(globals.name(slot), slot);
+        }
+        version->directory = std::move(directory);
+    }
+
+    const auto epoch = version->epoch;
+    if (previous != nullptr && previous->slots.size() == globals.slot_count()) {
+        version->slots = previous->slots;
+    } else {
+        version->slots = decltype(version->slots)::generate(globals.slot_count(), [&](const std::size_t slot) {
+            return previous != nullptr && slot < previous->slots.size() ? previous->slots[slot] : Value();
+        });
+    }
+    Freezer freezer(this, epoch);
+    const auto linked = [&](const Object *object) {
+        return object != nullptr && object->link != nullptr && object->link->versions == this ? object->link : nullptr;
+    };
+    // links whose copy this commit replaced, for what holds them to follow
+    auto replaced = std::vector<VersionLink *>();
+    const auto replace = [&](VersionLink &link) {
+        if (link.epoch != epoch) {
+            link.copy = copyOf(*link.copy.object());
+            link.epoch = epoch;
+            replaced.push_back(&link);
+        }
+    };
+
+    // the slots set since the last commit
+    for (const auto slot: globals.take_changed()) {
+        if (!globals.defined(slot)) {
+            version->slots.unique(slot) = Value();
+            continue;
+        }
+        const auto &value = globals.get(slot);
+        version->slots.unique(slot) = freezer.freeze(value);
+        if (auto *link = linked(value.object())) {
+            link->holders.emplace_back(nullptr, slot);
+        }
+    }
+
+    // the committed objects stored into since, kept alive to the end
+    const auto stored = std::exchange(this->stored, {});
+    for (const auto &value: stored) {
+        auto &object = *value.object();
+        auto &link = *object.link;
+        link.queued = false;
+        auto positions = std::exchange(link.stored, {});
+        if (std::exchange(link.refilled, false)) {
+            // Every position changed, so copy it whole, after dropping the
+            // holdings of those stored over since the fill.
+            forEachHeld(object, [&](const std::uint32_t position, const Object &child) {
+                if (child.link != nullptr) {
+                    unhold(*child.link, &link, position);
+                }
+            });
+            static_cast<void>(object.freeze(freezer));
+            replaced.push_back(&link);
+            continue;
+        }
+        std::ranges::sort(positions);
+        const auto [first, last] = std::ranges::unique(positions);
+        positions.erase(first, last);
+        replace(link);
+        for (const auto position: positions) {
+            const auto child = held(object, position);
+            hold(*link.copy.object(), position, freezer.freeze(child));
+            if (auto *child_link = linked(child.object())) {
+                child_link->holders.emplace_back(&link, position);
+            }
+        }
+    }
+
+    // what the objects frozen whole hold
+    for (const auto *original: freezer.adopted) {
+        forEachHeld(*original, [&](const std::uint32_t position, const Object &child) {
+            if (auto *child_link = linked(&child)) {
+                child_link->holders.emplace_back(original->link, position);
+            }
+        });
+    }
+
+    // Every holder of a replaced copy, as of this commit, takes the new one,
+    // replacing its own copy first unless this commit made it.
+    for (std::size_t i = 0; i < replaced.size(); i++) {
+        auto &link = *replaced[i];
+        for (const auto &[holder, position]: link.holders) {
+            if (holder == nullptr) {
+                version->slots.unique(position) = link.copy;
+                continue;
+            }
+            replace(*holder);
+            hold(*holder->copy.object(), position, link.copy);
+        }
+    }
+
+    if (auto *replaced = this->current.exchange(version.release())) {
+        this->retired.emplace_back(replaced);
+    }
+    this->latest.store(epoch);
+    this->reclaim();
+    return epoch;
+}
+
+void Versions::reclaim() {
+    auto oldest = this->latest.load();
+    for (const auto &reader: this->readers) {
+        if (const auto pinned = reader.pinned.load(); pinned != 0) {
+            oldest = std::min(oldest, pinned);
+        }
+    }
+    // A reader that pinned `oldest` may be using any version published since,
+    // but none replaced before it.
+    std::erase_if(this->retired, [&](const std::unique_ptr<GlobalsVersion> &version) {
+        return version->epoch < oldest;
+    });
+}
+
+Snapshot Versions::pin() {
+    for (std::size_t i = 0; i < MAX_READERS; i++) {
+        auto &reader = this->readers[i];
+        auto expected = false;
+        if (reader.claimed.load() || !reader.claimed.compare_exchange_strong(expected, true)) {
+            continue;
+        }
+        // Announce an epoch, then check it is still the latest: a commit that
+        // missed the announcement has published a newer one by then, and the
+        // version it might free is older than anything read from here on.
+        auto epoch = this->latest.load();
+        while (true) {
+            reader.pinned.store(epoch == 0 ? 1 : epoch);
+            const auto again = this->latest.load();
+            if (again == epoch) {
+                break;
+            }
+            epoch = again;
+        }
+        return {this, i, this->current.load()};
+    }
+    throw std::runtime_error(fmt::format("More than {} readers", MAX_READERS));
+}
+
+void Versions::unpin(const std::size_t reader) {
+    this->readers[reader].pinned.store(0);
+    this->readers[reader].claimed.store(false);
+}
+
+std::size_t Versions::retained() const {
+    return this->retired.size() + (this->current.load() != nullptr ? 1 : 0);
+}
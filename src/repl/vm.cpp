@@ -0,0 +1,206 @@
+//
+// Created by mizuk on 2025/3/16.
+//
+
+#include <bit>
+#include <cstring>
+#include <iterator>
+#include <stdexcept>
+#include <repl/builtins.h>
+#include <repl/bytecode.h>
+#include <repl/interpreter.h>
+#include <repl/object.h>
+
+// GCC and Clang can jump through a table of label addresses, giving each
+// opcode its own indirect branch; elsewhere the loop falls back to a switch.
+#if defined(__GNUC__)
+#define REPL_COMPUTED_GOTO 1
+#endif
+
+namespace {
+    // Leaves the operand stack as it was found, even when an instruction throws.
+    class StackFrame {
+        std::vector<Value> &stack;
+        std::size_t base;
+
+    public:
+        StackFrame(std::vector<Value> &stack, const std::uint32_t max_stack)
+            : stack(stack), base(stack.size()) {
+            stack.reserve(this->base + max_stack);
+        }
+
+        ~StackFrame() {
+            this->stack.resize(this->base);
+        }
+    };
+}
+
+Value Interpreter::run(const Chunk &chunk) {
+    if (chunk.globals != this->globals.get()) {
+        throw std::logic_error("Chunk was compiled for another interpreter");
+    }
+    auto &globals = *this->globals;
+    auto &stack = this->stack;
+    StackFrame frame(stack, chunk.max_stack);
+    const std::uint8_t *ip = chunk.code.data();
+    const auto operand = [&ip] {
+        std::uint32_t value;
+        std::memcpy(&value, ip, sizeof(value));
+        ip += sizeof(value);
+        return value;
+    };
+
+#ifdef REPL_COMPUTED_GOTO
+#define REPL_OPCODE_LABEL(name, width) &&op_##name,
+    static const void *const labels[] = {REPL_OPCODES(REPL_OPCODE_LABEL)};
+#undef REPL_OPCODE_LABEL
+#define OP(name) op_##name:
+#define DISPATCH() goto *labels[*ip++]
+    DISPATCH();
+#else
+#define OP(name) case OpCode::name:
+#define DISPATCH() break
+    for (;;) {
+        switch (static_cast<OpCode>(*ip++)) {
+#endif
+
+    OP(PUSH_INT) {
+        stack.push_back(Value::number(std::bit_cast<int>(operand())));
+        DISPATCH();
+    }
+    OP(PUSH_NIL) {
+        stack.push_back(Value::nil());
+        DISPATCH();
+    }
+    OP(LOAD_GLOBAL) {
+        stack.push_back(globals.get(operand()));
+        DISPATCH();
+    }
+    OP(CHECK_DEFINED) {
+        if (!globals.defined(operand())) {
+            throw InterpreterError(InterpretErrorType::UNDEFINED_VARIABLE);
+        }
+        DISPATCH();
+    }
+    OP(CHECK_UNDEFINED) {
+        if (globals.defined(operand())) {
+            throw InterpreterError(InterpretErrorType::DUPLICATE_VARIABLES_DEFINED);
+        }
+        DISPATCH();
+    }
+    OP(STORE_GLOBAL) {
+        globals.set(operand(), stack.back());
+        DISPATCH();
+    }
+    OP(DEFINE_GLOBAL) {
+        globals.set(operand(), stack.back());
+        stack.back() = Value::nil();
+        DISPATCH();
+    }
+    OP(GET_INDEX) {
+        stack.back() = stack.back().get_item(std::bit_cast<int>(operand()));
+        DISPATCH();
+    }
+    OP(GET_KEY) {
+        auto &site = chunk.caches[operand()];
+        auto &target = stack.back();
+        if (const auto *shape = target.shapeOf()) {
+            stack.back() = static_cast<Map &>(*target.object()).navigate(site.offset(shape));
+        } else {
+            stack.back() = target.get_item(site.key);
+        }
+        DISPATCH();
+    }
+    OP(SET_INDEX) {
+        auto value = std::move(stack.back());
+        stack.pop_back();
+        stack.back().set_item(std::bit_cast<int>(operand()), value);
+        stack.back() = std::move(value);
+        DISPATCH();
+    }
+    OP(SET_KEY) {
+        auto value = std::move(stack.back());
+        stack.pop_back();
+        auto &site = chunk.caches[operand()];
+        auto &target = stack.back();
+        if (const auto *shape = target.shapeOf()) {
+            static_cast<Map &>(*target.object()).setValue(site.offset(shape), value);
+        } else {
+            target.set_item(site.key, value);
+        }
+        stack.back() = std::move(value);
+        DISPATCH();
+    }
+    OP(MAKE_ARRAY) {
+        const auto first = stack.end() - operand();
+        auto array = Value::make<Array>(std::span<Value>(first, stack.end()));
+        stack.erase(first, stack.end());
+        stack.push_back(std::move(array));
+        DISPATCH();
+    }
+    OP(MAKE_MAP) {
+        const auto list = operand();
+        const auto &keys = chunk.key_lists[list];
+        const auto *shape = chunk.shapes[list] != nullptr ? chunk.shapes[list] : Shape::of(keys);
+        const auto first = stack.end() - static_cast<std::ptrdiff_t>(keys.size());
+        auto map = Value();
+        if (shape->size() == keys.size()) {
+            // keys are distinct, so values are already in offset order
+            map = Value::make<Map>(shape, std::span<Value>(first, stack.end()));
+        } else {
+            auto values = std::vector<Value>();
+            // a repeated key keeps its first value
+            values.resize(shape->size());
+            for (std::size_t i = 0; i < keys.size(); i++) {
+                auto &value = values[*shape->offset(keys[i])];
+                if (!value) {
+                    value = std::move(first[static_cast<std::ptrdiff_t>(i)]);
+                }
+            }
+            map = Value::make<Map>(shape, std::move(values));
+        }
+        stack.erase(first, stack.end());
+        stack.push_back(std::move(map));
+        DISPATCH();
+    }
+    OP(COPY_ARRAY) {
+        stack.push_back(Value::make<Array>(static_cast<const Array &>(*globals.constant(operand()).object())));
+        DISPATCH();
+    }
+    OP(COPY_MAP) {
+        stack.push_back(Value::make<Map>(static_cast<const Map &>(*globals.constant(operand()).object())));
+        DISPATCH();
+    }
+    OP(CALL) {
+        const auto &call = chunk.calls[operand()];
+        if (!call.builtin) {
+            throw InterpreterError(InterpretErrorType::UNKNOWN_FUNCTION);
+        }
+        const auto first = stack.end() - static_cast<std::ptrdiff_t>(call.argument_count);
+        auto result = callBuiltin(*call.builtin, std::span<const Value>(first, stack.end()));
+        stack.erase(first, stack.end());
+        stack.push_back(std::move(result));
+        DISPATCH();
+    }
+    OP(PRINT) {
+        this->print(stack.back());
+        stack.back() = Value::nil();
+        DISPATCH();
+    }
+    OP(POP) {
+        stack.pop_back();
+        DISPATCH();
+    }
+    OP(RETURN) {
+        auto result = std::move(stack.back());
+        stack.pop_back();
+        return result;
+    }
+
+#ifndef REPL_COMPUTED_GOTO
+        }
+    }
+#endif
+#undef OP
+#undef DISPATCH
+}
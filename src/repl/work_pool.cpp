@@ -0,0 +1,100 @@
+//
+// Created by mizuk on 2025/4/1.
+//
+
+#include <algorithm>
+#include <repl/work_pool.h>
+
+namespace {
+    // the pool whose thread this is, and which of its threads
+    thread_local const WorkStealingPool *current_pool = nullptr;
+    thread_local std::size_t current_index = 0;
+}
+
+WorkStealingPool::WorkStealingPool(const std::size_t threads) {
+    const auto count = std::max<std::size_t>(threads, 1);
+    for (std::size_t i = 0; i < count; i++) {
+        this->queues.push_back(std::make_unique<Queue>());
+    }
+    for (std::size_t i = 0; i < count; i++) {
+        this->threads.emplace_back(&WorkStealingPool::run, this, i);
+    }
+}
+
+WorkStealingPool::~WorkStealingPool() {
+    {
+        const std::lock_guard lock(this->idle_mutex);
+        this->stopping = true;
+    }
+    this->idle.notify_all();
+    for (auto &thread: this->threads) {
+        thread.join();
+    }
+}
+
+void WorkStealingPool::submit(std::function<void()> task) {
+    const auto index = current_pool == this
+                           ? current_index
+                           : this->next.fetch_add(1, std::memory_order_relaxed) % this->queues.size();
+    {
+        const std::lock_guard lock(this->queues[index]->mutex);
+        this->queues[index]->tasks.push_back(std::move(task));
+    }
+    this->queued.fetch_add(1);
+    // a thread that found nothing to do is either asleep by now, or about to
+    // check `queued` again under the lock
+    {
+        const std::lock_guard lock(this->idle_mutex);
+    }
+    this->idle.notify_one();
+}
+
+bool WorkStealingPool::take(const std::size_t index, std::function<void()> &task) {
+    {
+        auto &own = *this->queues[index];
+        const std::lock_guard lock(own.mutex);
+        if (!own.tasks.empty()) {
+            task = std::move(own.tasks.back());
+            own.tasks.pop_back();
+            return true;
+        }
+    }
+    for (std::size_t i = 1; i < this->queues.size(); i++) {
+        auto &other = *this->queues[(index + i) % this->queues.size()];
+        const std::lock_guard lock(other.mutex);
+        if (!other.tasks.empty()) {
+            task = std::move(other.tasks.front());
+            other.tasks.pop_front();
+            this->steal_count.fetch_add(1, std::memory_order_relaxed);
+            return true;
+        }
+    }
+    return false;
+}
+
+void WorkStealingPool::run(const std::size_t index) {
+    current_pool = this;
+    current_index = index;
+    std::function<void()> task;
+    while (true) {
+        if (this->take(index, task)) {
+            this->queued.fetch_sub(1);
+            task();
+            task = nullptr;
+            continue;
+        }
+        std::unique_lock lock(this->idle_mutex);
+        if (this->stopping && this->queued.load() == 0) {
+            return;
+        }
+        this->idle.wait(lock, [this] { return this->stopping || this->queued.load() > 0; });
+    }
+}
+
+std::size_t WorkStealingPool::size() const {
+    return this->threads.size();
+}
+
+std::size_t WorkStealingPool::steals() const {
+    return this->steal_count.load(std::memory_order_relaxed);
+}
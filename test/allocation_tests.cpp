@@ -0,0 +1,277 @@
+// Tests that count heap allocations on the hot paths
+// Replaces the global operator new for the whole test binary; counting is only
+// switched on inside an AllocationCounter scope, so other tests are unaffected.
+
+#include <gtest/gtest.h>
+#include <cstdlib>
+#include <new>
+#include <string>
+#include <repl/arena.h>
+#include <repl/interpreter.h>
+#include <repl/lexer.h>
+#include <repl/object.h>
+#include <repl/parser.h>
+#include <repl/token.h>
+
+namespace {
+    thread_local bool counting = false;
+    thread_local std::size_t allocations = 0;
+
+    class AllocationCounter {
+    public:
+        AllocationCounter() {
+            allocations = 0;
+            counting = true;
+        }
+
+        ~AllocationCounter() {
+            counting = false;
+        }
+
+        [[nodiscard]] static std::size_t count() {
+            return allocations;
+        }
+    };
+}
+
+void *operator new(const std::size_t size) {
+    if (counting) {
+        allocations++;
+    }
+    if (void *ptr = std::malloc(size == 0 ? 1 : size)) {
+        return ptr;
+    }
+    throw std::bad_alloc();
+}
+
+void operator delete(void *ptr) noexcept {
+    std::free(ptr);
+}
+
+void operator delete(void *ptr, std::size_t) noexcept {
+    std::free(ptr);
+}
+
+static std::string largeScript() {
+    std::string script;
+    for (int i = 0; i < 2000; i++) {
+        script += "$variableNumber" + std::to_string(i) + " = @{key = @[1, 22, 333, nil,], other = value.path[7],}\n";
+        script += "print someLongIdentifierName.property[12345].anotherPropertyName\n";
+    }
+    return script;
+}
+
+// Interning allocates the first time a name is seen, so every test lexes the
+// script once up front and only counts the second pass.
+static void internNames(const std::string &script) {
+    Lexer lexer{std::string_view(script)};
+    lexer.tokenize();
+}
+
+TEST(AllocationTest, LexerAllocatesNothingPerToken) {
+    const auto script = largeScript();
+    internNames(script);
+    Lexer lexer{std::string_view(script)};
+
+    std::size_t tokens = 0;
+    std::size_t identifiers = 0;
+    {
+        AllocationCounter counter;
+        for (auto token = lexer.nextToken(); token.type != TokenType::EOF_; token = lexer.nextToken()) {
+            if (token.type == TokenType::IDENTIFIER) {
+                identifiers++;
+            }
+            tokens++;
+        }
+        EXPECT_EQ(AllocationCounter::count(), 0);
+    }
+    EXPECT_GT(tokens, 50000);
+    EXPECT_GT(identifiers, 0);
+}
+
+TEST(AllocationTest, PeekTokenAllocatesNothing) {
+    const auto script = largeScript();
+    internNames(script);
+    Lexer lexer{std::string_view(script)};
+
+    AllocationCounter counter;
+    for (auto token = lexer.peekToken(); token.type != TokenType::EOF_; token = lexer.peekToken()) {
+        lexer.nextToken();
+    }
+    EXPECT_EQ(AllocationCounter::count(), 0);
+}
+
+TEST(AllocationTest, TokenizeAllocatesOnlyTheTokenArray) {
+    const auto script = largeScript();
+    internNames(script);
+    Lexer lexer{std::string_view(script)};
+
+    AllocationCounter counter;
+    const auto tokens = lexer.tokenize();
+    EXPECT_GT(tokens.size(), 50000);
+    // one reservation plus at most a few geometric regrowths, never per token
+    EXPECT_LE(AllocationCounter::count(), 4);
+}
+
+TEST(AllocationTest, RepeatedNamesInternOnce) {
+    const std::string input = "alpha beta alpha";
+    internNames(input);
+    const auto interned = Interner::global().size();
+
+    AllocationCounter counter;
+    Lexer lexer{std::string_view(input)};
+    const auto first = lexer.nextToken();
+    lexer.nextToken();
+    const auto third = lexer.nextToken();
+    EXPECT_EQ(AllocationCounter::count(), 0);
+    EXPECT_EQ(std::get<Atom>(first.value), std::get<Atom>(third.value));
+    EXPECT_EQ(Interner::global().size(), interned);
+}
+
+TEST(AllocationTest, ArenaParseOfLargeLiteralAvoidsMallocPerNode) {
+    std::string literal = "@[";
+    for (int i = 0; i < 20000; i++) {
+        literal += "@{k = " + std::to_string(i) + ",},";
+    }
+    literal += "]";
+    internNames(literal);
+
+    AstArena arena;
+    // warm the arena so its blocks already exist
+    {
+        auto lexer = std::make_unique<Lexer>(literal);
+        Parser(lexer, arena).parse();
+        arena.reset();
+    }
+
+    auto lexer = std::make_unique<Lexer>(std::string_view(literal));
+    Parser parser(lexer, arena);
+    AllocationCounter counter;
+    auto expr = parser.parse();
+    // 80000 nodes; what remains is the token array and the per-literal
+    // child vectors (one for each inner map, a few regrowths for the array)
+    EXPECT_LT(AllocationCounter::count(), 20000 + 64);
+    EXPECT_EQ(arena.live_nodes(), 1 + 20000 * 4);
+}
+
+TEST(AllocationTest, DeepAccessPathWalksWithoutAllocating) {
+    // $deep = @[@[...@[7,]...,],], 1000 levels, read and written through a[0]...[0]
+    constexpr int depth = 1000;
+    std::string literal;
+    std::string path = "deep";
+    for (int i = 0; i < depth; i++) {
+        literal += "@[";
+        path += "[0]";
+    }
+    literal += "7,";
+    for (int i = 0; i < depth; i++) {
+        literal += "],";
+    }
+    literal.pop_back();
+
+    Interpreter interpreter;
+    auto declaration = std::make_unique<Lexer>("$deep = " + literal);
+    interpreter.execute(Parser(declaration).parse_flat());
+
+    auto get_lexer = std::make_unique<Lexer>(path);
+    const auto get_ast = Parser(get_lexer).parse_flat();
+    auto store_lexer = std::make_unique<Lexer>(path + " = deep" + path.substr(4));
+    const auto store_ast = Parser(store_lexer).parse_flat();
+    ASSERT_EQ(get_ast.size(), depth + 2);
+    const auto get = Compiler::compile(get_ast, get_ast.root(), interpreter.global_scope());
+    const auto store = Compiler::compile(store_ast, store_ast.root(), interpreter.global_scope());
+    // sizes the VM's operand stack
+    interpreter.run(store);
+
+    Value result;
+    {
+        AllocationCounter counter;
+        result = interpreter.run(get);
+        interpreter.run(store);
+        EXPECT_EQ(AllocationCounter::count(), 0);
+    }
+    EXPECT_EQ(result.toString(), "Number(7)");
+}
+
+TEST(AllocationTest, MapLiteralStoresOnlyItsValues) {
+    Interpreter interpreter;
+    interpreter.global_scope().global_set(Atom("three"), Value::number(3));
+    // not constant, so the map is built on every run
+    auto lexer = std::make_unique<Lexer>("@{name = 1, age = 2, city = three,}");
+    const auto ast = Parser(lexer).parse_flat();
+    const auto chunk = Compiler::compile(ast, ast.root(), interpreter.global_scope());
+    interpreter.run(chunk);
+
+    Value result;
+    {
+        AllocationCounter counter;
+        result = interpreter.run(chunk);
+        // nothing: the map and the node holding its values come from slab
+        // pools, numbers are immediates, and the keys live in the shape every
+        // map of this literal shares
+        EXPECT_EQ(AllocationCounter::count(), 0);
+    }
+    EXPECT_EQ(result.toString(), "Map(age = Number(2), city = Number(3), name = Number(1))");
+}
+
+TEST(AllocationTest, ConstantLiteralsAreCopiedOnWrite) {
+    Interpreter interpreter;
+    auto lexer = std::make_unique<Lexer>("@{retries = 3, timeout = 30, limits = @[1, 2, nil,],}");
+    const auto ast = Parser(lexer).parse_flat();
+    const auto chunk = Compiler::compile(ast, ast.root(), interpreter.global_scope());
+    interpreter.run(chunk);
+
+    // grow the heap's object list and slab pools first
+    std::vector<Value> configs;
+    configs.reserve(2000);
+    for (int i = 0; i < 2000; i++) {
+        configs.push_back(interpreter.run(chunk));
+    }
+    configs.clear();
+    {
+        AllocationCounter counter;
+        // the outer map holds an array, so it is built, in pooled memory;
+        // the inner array is a copy sharing its constant's elements
+        for (int i = 0; i < 1000; i++) {
+            configs.push_back(interpreter.run(chunk));
+        }
+        EXPECT_EQ(AllocationCounter::count(), 0);
+    }
+    EXPECT_EQ(interpreter.global_scope().constant_count(), 1);
+
+    auto lexer_flat = std::make_unique<Lexer>("@{retries = 3, timeout = 30,}");
+    const auto flat_ast = Parser(lexer_flat).parse_flat();
+    const auto flat = Compiler::compile(flat_ast, flat_ast.root(), interpreter.global_scope());
+    interpreter.run(flat);
+    configs.clear();
+    {
+        AllocationCounter counter;
+        for (int i = 0; i < 1000; i++) {
+            configs.push_back(interpreter.run(flat));
+        }
+        EXPECT_EQ(AllocationCounter::count(), 0);
+    }
+}
+
+TEST(AllocationTest, NumbersAndNilAreImmediates) {
+    constexpr int count = 1000000;
+    std::vector<Value> elements;
+    elements.reserve(count);
+    for (int i = 0; i < count; i++) {
+        elements.push_back(i % 2 == 0 ? Value::number(i) : Value::nil());
+    }
+
+    Value array;
+    {
+        AllocationCounter counter;
+        // the elements move into trie nodes of 32, which come from slab pools
+        // a few dozen at a time, as does the Array; nothing is allocated per
+        // element
+        array = Value::make<Array>(std::move(elements));
+        auto copy = array;
+        EXPECT_EQ(copy.get_item(4).asNumber(), 4);
+        EXPECT_TRUE(copy.get_item(5).isNil());
+        EXPECT_LT(AllocationCounter::count(), count / 1000);
+    }
+    EXPECT_EQ(array.as<Array>()->size(), count);
+}
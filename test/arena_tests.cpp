@@ -0,0 +1,72 @@
+#include <gtest/gtest.h>
+#include <memory>
+#include <string>
+#include <repl/arena.h>
+#include <repl/ast.h>
+#include <repl/lexer.h>
+#include <repl/parser.h>
+
+static std::string bigArrayLiteral(const int count) {
+    std::string literal = "@[";
+    for (int i = 0; i < count; i++) {
+        literal += std::to_string(i) + ",";
+    }
+    return literal + "]";
+}
+
+TEST(ArenaTest, ParserAllocatesNodesFromArena) {
+    AstArena arena;
+    auto lexer = std::make_unique<Lexer>(bigArrayLiteral(1000));
+    Parser parser(lexer, arena);
+
+    auto expr = parser.parse();
+    // the array definition plus one NumberLiteral per element
+    EXPECT_EQ(arena.live_nodes(), 1001);
+
+    expr.reset();
+    EXPECT_EQ(arena.live_nodes(), 0);
+    EXPECT_NO_THROW(arena.reset());
+}
+
+TEST(ArenaTest, ParsesSameTreeAsHeap) {
+    const std::string input = "$m = @{a = @[1, nil, x.y[2],], b = 3,}";
+    AstArena arena;
+    auto arena_lexer = std::make_unique<Lexer>(input);
+    auto heap_lexer = std::make_unique<Lexer>(input);
+
+    auto from_arena = Parser(arena_lexer, arena).parse();
+    auto from_heap = Parser(heap_lexer).parse();
+    EXPECT_TRUE(*from_arena == *from_heap);
+}
+
+TEST(ArenaTest, ResetReusesBlocks) {
+    AstArena arena;
+    for (int round = 0; round < 10; round++) {
+        auto lexer = std::make_unique<Lexer>(bigArrayLiteral(5000));
+        auto expr = Parser(lexer, arena).parse();
+        expr.reset();
+        arena.reset();
+    }
+    const auto reserved = arena.reserved_bytes();
+    auto lexer = std::make_unique<Lexer>(bigArrayLiteral(5000));
+    auto expr = Parser(lexer, arena).parse();
+    EXPECT_EQ(arena.reserved_bytes(), reserved);
+}
+
+TEST(ArenaTest, ResetRefusesWhileNodesAlive) {
+    AstArena arena;
+    auto lexer = std::make_unique<Lexer>("a.b");
+    auto expr = Parser(lexer, arena).parse();
+    EXPECT_THROW(arena.reset(), std::logic_error);
+}
+
+TEST(ArenaTest, NodesOutsideScopeUseHeap) {
+    AstArena arena;
+    {
+        AstArena::Scope scope(&arena);
+        const auto inside = std::make_unique<NilLiteral>();
+        EXPECT_EQ(arena.live_nodes(), 1);
+    }
+    const auto outside = std::make_unique<NilLiteral>();
+    EXPECT_EQ(arena.live_nodes(), 0);
+}
@@ -0,0 +1,182 @@
+#include <gtest/gtest.h>
+#include <memory>
+#include <string>
+#include <repl/builtins.h>
+#include <repl/bytecode.h>
+#include <repl/interpreter.h>
+#include <repl/lexer.h>
+#include <repl/object.h>
+#include <repl/parser.h>
+#include "vm_fixture.h"
+
+class BuiltinsTest : public VmTest {
+protected:
+    // runs a statement on the VM and through the tree walker, expecting both
+    // to agree
+    std::string run(const std::string &input) {
+        auto result = VmTest::run(input);
+        if (input.starts_with('$')) {
+            return result;
+        }
+        auto tree_lexer = std::make_unique<Lexer>(input);
+        const auto expr = Parser(tree_lexer).parse();
+        EXPECT_EQ(this->interpreter.visit(*expr).toString(), result) << input;
+        return result;
+    }
+};
+
+TEST_F(BuiltinsTest, FindsBuiltinsByName) {
+    EXPECT_EQ(findBuiltin(Atom("sum")), Builtin::SUM);
+    EXPECT_EQ(toString(Builtin::FILL), "fill");
+    EXPECT_EQ(findBuiltin(Atom("nope")), std::nullopt);
+}
+
+TEST_F(BuiltinsTest, ScansArrays) {
+    run("$a = @[3, 1, 4, 1, 5, 9, 2, 6, 5,]");
+    EXPECT_EQ(run("len(a)"), "Number(9)");
+    EXPECT_EQ(run("sum(a)"), "Number(36)");
+    EXPECT_EQ(run("min(a)"), "Number(1)");
+    EXPECT_EQ(run("max(a)"), "Number(9)");
+    EXPECT_EQ(run("find(a, 5)"), "Number(4)");
+    EXPECT_EQ(run("find(a, 7)"), "Nil()");
+    EXPECT_EQ(run("find(a, nil)"), "Nil()");
+    EXPECT_EQ(run("len(@{k = 1, j = 2,})"), "Number(2)");
+
+    run("$e = @[]");
+    EXPECT_EQ(run("sum(e)"), "Number(0)");
+    EXPECT_EQ(run("min(e)"), "Nil()");
+}
+
+TEST_F(BuiltinsTest, FillsInPlace) {
+    run("$a = @[1, 2, 3,]");
+    EXPECT_EQ(run("fill(a, 7)"), "Array(Number(7), Number(7), Number(7))");
+    EXPECT_EQ(run("a"), "Array(Number(7), Number(7), Number(7))");
+    EXPECT_TRUE(interpreter.global_scope().global_get("a").as<Array>()->packed());
+
+    EXPECT_EQ(run("fill(a, nil)"), "Array(Nil(), Nil(), Nil())");
+    EXPECT_FALSE(interpreter.global_scope().global_get("a").as<Array>()->packed());
+}
+
+TEST_F(BuiltinsTest, ClonesSnapshots) {
+    run("$x = @[@{k = 1,}, @[1, 2,], 3,]");
+    run("$snap = clone(x)");
+    // the clone shares x's storage, nested objects not copied until reached
+    const auto *x = interpreter.global_scope().global_get("x").as<Array>();
+    const auto *snap = interpreter.global_scope().global_get("snap").as<Array>();
+    EXPECT_TRUE(x->sharesStorage());
+    EXPECT_EQ(snap->element(1).object(), x->element(1).object());
+
+    // stores through either side, however deep, leave the other alone
+    run("x[0].k = 5");
+    run("x[1][0] = 9");
+    run("x[2] = nil");
+    run("snap[1][1] = 7");
+    EXPECT_EQ(run("x"), "Array(Map(k = Number(5)), Array(Number(9), Number(2)), Nil())");
+    EXPECT_EQ(run("snap"), "Array(Map(k = Number(1)), Array(Number(1), Number(7)), Number(3))");
+
+    // within one side, an element is still shared by reference
+    run("$y = x[0]");
+    run("y.k = 6");
+    EXPECT_EQ(run("x[0].k"), "Number(6)");
+
+    run("$m = @{a = @[1,], b = 2,}");
+    run("$n = clone(m)");
+    run("n.a[0] = 3");
+    EXPECT_EQ(run("m"), "Map(a = Array(Number(1)), b = Number(2))");
+    EXPECT_EQ(run("n"), "Map(a = Array(Number(3)), b = Number(2))");
+    EXPECT_EQ(run("clone(3)"), "Number(3)");
+    EXPECT_EQ(run("clone(nil)"), "Nil()");
+}
+
+TEST_F(BuiltinsTest, AliasesMadeBeforeACloneSeeTheOriginal) {
+    run("$x = @[1,]");
+    run("$a = @[x, @[x,],]");
+    run("$b = a[0]");
+    run("$c = clone(a)");
+    run("a[0][0] = 9");
+    EXPECT_EQ(run("x"), "Array(Number(9))");
+    EXPECT_EQ(run("b"), "Array(Number(9))");
+    EXPECT_EQ(run("a[1][0]"), "Array(Number(9))");
+    // the clone kept what it copied, once, however often it was reached
+    EXPECT_EQ(run("c"), "Array(Array(Number(1)), Array(Array(Number(1))))");
+    run("c[1][0][0] = 5");
+    EXPECT_EQ(run("c[0]"), "Array(Number(5))");
+    EXPECT_EQ(run("x"), "Array(Number(9))");
+
+    // writes through the original's elements directly, too
+    run("x[0] = 3");
+    EXPECT_EQ(run("c[0]"), "Array(Number(5))");
+
+    // and a cycle stays a cycle, of the copy's own
+    run("$r = @[nil,]");
+    run("r[0] = r");
+    run("$s = clone(r)");
+    auto *s = interpreter.global_scope().global_get("s").as<Array>();
+    EXPECT_EQ(s->navigate(0).object(), s);
+    EXPECT_NE(s, interpreter.global_scope().global_get("r").object());
+}
+
+TEST_F(BuiltinsTest, ClonesOfClonesSeeTheirOwnInstant) {
+    run("$x = @[@[1,], nil,]");
+    run("x[1] = x");
+    run("$s = clone(x)");
+    run("x[0][0] = 2");
+    run("$t = clone(s)");
+    run("s[0][0] = 3");
+    run("x[0][0] = 4");
+    // neither had reached x[0] before it changed
+    EXPECT_EQ(run("s[0]"), "Array(Number(3))");
+    EXPECT_EQ(run("t[0]"), "Array(Number(1))");
+    EXPECT_EQ(run("t[1][1][0]"), "Array(Number(1))");
+    auto *t = interpreter.global_scope().global_get("t").as<Array>();
+    EXPECT_EQ(t->navigate(1).object(), t);
+}
+
+TEST_F(BuiltinsTest, ScansLargeArraysByChunk) {
+    std::string literal = "$big = @[";
+    for (int i = 0; i < 1000; i++) {
+        literal += std::to_string(i % 100) + ", ";
+    }
+    run(literal + "]");
+    run("big[700] = 1000");
+    EXPECT_EQ(run("sum(big)"), "Number(50500)");
+    EXPECT_EQ(run("max(big)"), "Number(1000)");
+    EXPECT_EQ(run("find(big, 1000)"), "Number(700)");
+    EXPECT_EQ(run("find(big, 99)"), "Number(99)");
+    EXPECT_EQ(run("find(big, 100)"), "Nil()");
+    EXPECT_EQ(run("min(big)"), "Number(0)");
+}
+
+TEST_F(BuiltinsTest, RejectsBadCalls) {
+    run("$a = @[1, nil,]");
+    run("$m = @{k = 1,}");
+    EXPECT_THROW(run("nope(a)"), InterpreterError);
+    EXPECT_THROW(run("sum(a, a)"), InterpreterError);
+    EXPECT_THROW(run("sum(m)"), InterpreterError);
+    EXPECT_THROW(run("sum(a)"), InterpreterError);
+    EXPECT_EQ(run("find(a, nil)"), "Number(1)");
+
+    run("$big = @[2147483647, 1,]");
+    EXPECT_THROW(run("sum(big)"), std::out_of_range);
+}
+
+TEST(PackedArrayTest, PacksAllNumberArrays) {
+    Array packed(std::vector{Value::number(1), Value::number(-2)});
+    EXPECT_TRUE(packed.packed());
+    EXPECT_EQ(packed.size(), 2);
+    EXPECT_EQ(packed.get(1).asNumber(), -2);
+
+    Array generic(std::vector{Value::number(1), Value::nil()});
+    EXPECT_FALSE(generic.packed());
+    EXPECT_TRUE(generic.get(1).isNil());
+}
+
+TEST(PackedArrayTest, StoringANonNumberUnpacks) {
+    Array array(std::vector<std::int32_t>{1, 2, 3});
+    array.set(0, Value::number(9));
+    EXPECT_TRUE(array.packed());
+
+    array.set(1, Value::make<Array>(std::vector<Value>()));
+    EXPECT_FALSE(array.packed());
+    EXPECT_EQ(array.toString(), "Array(Number(9), Array(), Number(3))");
+}
@@ -0,0 +1,195 @@
+#include <gtest/gtest.h>
+#include <memory>
+#include <string>
+#include <repl/bytecode.h>
+#include <repl/interpreter.h>
+#include <repl/lexer.h>
+#include <repl/object.h>
+#include <repl/parser.h>
+#include "vm_fixture.h"
+
+class BytecodeTest : public VmTest {
+};
+
+TEST_F(BytecodeTest, DisassemblesEveryOperand) {
+    EXPECT_EQ(disassemble(compile("$m = @{k = @[1, nil, y,], j = @{z = 3,},}")),
+              "0000 CHECK_UNDEFINED #0 m\n"
+              "0005 PUSH_INT 1\n"
+              "0010 PUSH_NIL\n"
+              "0011 LOAD_GLOBAL #1 y\n"
+              "0016 MAKE_ARRAY 3\n"
+              "0021 COPY_MAP #0 Map(z = Number(3))\n"
+              "0026 MAKE_MAP {k, j}\n"
+              "0031 DEFINE_GLOBAL #0 m\n"
+              "0036 RETURN\n");
+
+    EXPECT_EQ(disassemble(compile("a.b[3].c = value")),
+              "0000 LOAD_GLOBAL #2 a\n"
+              "0005 GET_KEY b\n"
+              "0010 GET_INDEX 3\n"
+              "0015 LOAD_GLOBAL #3 value\n"
+              "0020 SET_KEY c\n"
+              "0025 RETURN\n");
+}
+
+TEST_F(BytecodeTest, CallsResolveTheirBuiltin) {
+    const auto chunk = compile("find(a, 2)");
+    EXPECT_EQ(disassemble(chunk),
+              "0000 LOAD_GLOBAL #0 a\n"
+              "0005 PUSH_INT 2\n"
+              "0010 CALL find/2\n"
+              "0015 RETURN\n");
+    EXPECT_EQ(chunk.calls[0].builtin, Builtin::FIND);
+    EXPECT_EQ(chunk.max_stack, 2);
+    EXPECT_EQ(compile("nope()").calls[0].builtin, std::nullopt);
+}
+
+TEST_F(BytecodeTest, TracksMaximumStackDepth) {
+    EXPECT_EQ(compile("1").max_stack, 1);
+    // a variable keeps each literal from being hoisted as a constant
+    EXPECT_EQ(compile("@[1, 2, @[3, 4, x,],]").max_stack, 5);
+    EXPECT_EQ(compile("a[0] = @[1, x,]").max_stack, 3);
+    EXPECT_EQ(compile("@[1, 2, @[3, 4, 5,],]").max_stack, 3);
+}
+
+TEST_F(BytecodeTest, RunsStatements) {
+    EXPECT_EQ(run("$a = @[1, @{k = 2,},]"), "Nil()");
+    EXPECT_EQ(run("a[1].k"), "Number(2)");
+    EXPECT_EQ(run("a[1].k = a[0]"), "Number(1)");
+    EXPECT_EQ(run("a"), "Array(Number(1), Map(k = Number(1)))");
+    EXPECT_EQ(run("a = 5"), "Number(5)");
+    EXPECT_EQ(run("a"), "Number(5)");
+}
+
+TEST_F(BytecodeTest, ChecksNamesBeforeEvaluatingTheValue) {
+    run("$a = @[0,]");
+    run("$b = 1");
+
+    // the duplicate is caught before a[0] is overwritten
+    EXPECT_THROW(run("$b = a[0] = 9"), InterpreterError);
+    EXPECT_EQ(run("a[0]"), "Number(0)");
+    EXPECT_THROW(run("c = a[0] = 9"), InterpreterError);
+    EXPECT_EQ(run("a[0]"), "Number(0)");
+}
+
+TEST_F(BytecodeTest, ThrowingLeavesTheVmUsable) {
+    run("$a = @[1,]");
+
+    EXPECT_THROW(run("@[1, 2, a[5],]"), std::out_of_range);
+    EXPECT_THROW(run("@{k = missing,}"), InterpreterError);
+    EXPECT_EQ(run("@[a[0], 2,]"), "Array(Number(1), Number(2))");
+}
+
+TEST_F(BytecodeTest, ProgramYieldsItsLastStatement) {
+    auto lexer = std::make_unique<Lexer>("$x = 3; $y = @[x,]; y[0]");
+    const auto ast = Parser(lexer).parse_program_flat();
+    EXPECT_EQ(interpreter.run(Compiler::compile(ast, ast.root(), interpreter.global_scope())).toString(), "Number(3)");
+
+    auto empty = std::make_unique<Lexer>("");
+    const auto nothing = Parser(empty).parse_program_flat();
+    EXPECT_EQ(interpreter.run(Compiler::compile(nothing, nothing.root(), interpreter.global_scope())).toString(), "Nil()");
+}
+
+TEST_F(BytecodeTest, ResolvesEachNameToOneSlot) {
+    auto &globals = interpreter.global_scope();
+    const auto chunk = compile("$x = @[y, nil, y,]");
+
+    EXPECT_EQ(globals.slot_count(), 2);
+    EXPECT_EQ(globals.name(0), Atom("x"));
+    EXPECT_EQ(globals.name(1), Atom("y"));
+    // resolved but never declared
+    EXPECT_FALSE(globals.defined(1));
+    EXPECT_FALSE(globals.exists("y"));
+
+    run("$y = 4");
+    interpreter.run(chunk);
+    EXPECT_TRUE(globals.defined(0));
+    EXPECT_EQ(globals.global_get("x").toString(), "Array(Number(4), Nil(), Number(4))");
+}
+
+TEST_F(BytecodeTest, RejectsChunksOfAnotherInterpreter) {
+    const auto chunk = compile("1");
+    Interpreter other;
+    EXPECT_THROW(other.run(chunk), std::logic_error);
+}
+
+TEST_F(BytecodeTest, KeyStepsHitTheirInlineCache) {
+    run("$a = @{b = @{c = 1,},}");
+    const auto get = compile("a.b.c");
+    for (int i = 0; i < 10; i++) {
+        EXPECT_EQ(this->interpreter.run(get).toString(), "Number(1)");
+    }
+    EXPECT_EQ(describeCaches(get),
+              "0005 GET_KEY b: 9 hits, 1 misses, monomorphic\n"
+              "0010 GET_KEY c: 9 hits, 1 misses, monomorphic\n");
+
+    const auto set = compile("a.b.c = 2");
+    this->interpreter.run(set);
+    this->interpreter.run(set);
+    EXPECT_EQ(run("a.b.c"), "Number(2)");
+    EXPECT_EQ(set.caches[1].key, Atom("c"));
+    EXPECT_EQ(set.caches[1].hits, 1);
+    EXPECT_EQ(set.caches[1].misses, 1);
+}
+
+TEST_F(BytecodeTest, InlineCacheGoesPolymorphicThenMegamorphic) {
+    const auto get = compile("m.k");
+    const char *layouts[] = {"@{k = 1,}", "@{j = 2, k = 1,}", "@{i = 3, k = 1,}", "@{h = 4, k = 1,}",
+                             "@{g = 5, k = 1,}"};
+    run("$m = nil");
+    for (std::size_t i = 0; i < std::size(layouts); i++) {
+        run(std::string("m = ") + layouts[i]);
+        EXPECT_EQ(this->interpreter.run(get).toString(), "Number(1)");
+        EXPECT_EQ(this->interpreter.run(get).toString(), "Number(1)");
+        EXPECT_EQ(get.caches[0].state(), i == 0 ? "monomorphic" : i < InlineCache::WAYS ? "polymorphic" : "megamorphic");
+    }
+    // the fifth layout is never cached, so both of its reads miss
+    EXPECT_EQ(get.caches[0].hits, 4);
+    EXPECT_EQ(get.caches[0].misses, 6);
+}
+
+TEST_F(BytecodeTest, InlineCacheMissOnAbsentKeyThrows) {
+    run("$m = @{k = 1,}");
+    const auto get = compile("m.absent");
+    EXPECT_THROW(this->interpreter.run(get), std::out_of_range);
+    EXPECT_EQ(get.caches[0].state(), "uninitialized");
+    EXPECT_EQ(run("m.k"), "Number(1)");
+}
+
+TEST_F(BytecodeTest, ConstantLiteralsAreHoistedOnce) {
+    const auto first = compile("$a = @[1, nil, 3,]");
+    const auto second = compile("$b = @[1, nil, 3,]");
+    EXPECT_EQ(disassemble(second),
+              "0000 CHECK_UNDEFINED #1 b\n"
+              "0005 COPY_ARRAY #0 Array(Number(1), Nil(), Number(3))\n"
+              "0010 DEFINE_GLOBAL #1 b\n"
+              "0015 RETURN\n");
+    compile("@{k = 1, k = 2,}");
+    compile("@{k = 1,}");
+    EXPECT_EQ(interpreter.global_scope().constant_count(), 2);
+    EXPECT_EQ(run("@{k = 1, k = 2,}"), "Map(k = Number(1))");
+    EXPECT_EQ(interpreter.global_scope().constant_count(), 2);
+}
+
+TEST_F(BytecodeTest, CopiesOfConstantsAreIndependent) {
+    run("$a = @[1, 2, 3,]");
+    run("$b = @[1, 2, 3,]");
+    run("$m = @{x = 1, y = nil,}");
+    run("$n = @{x = 1, y = nil,}");
+    const auto *array = interpreter.global_scope().global_get("a").as<Array>();
+    EXPECT_TRUE(array->sharesStorage());
+    EXPECT_TRUE(array->packed());
+    EXPECT_EQ(run("sum(a)"), "Number(6)");
+
+    EXPECT_EQ(run("a[0] = nil"), "Nil()");
+    EXPECT_FALSE(array->sharesStorage());
+    EXPECT_EQ(run("fill(b, 7)"), "Array(Number(7), Number(7), Number(7))");
+    EXPECT_EQ(run("m.y = m"), "Map(x = Number(1), y = Map(...))");
+    EXPECT_EQ(run("n.x"), "Number(1)");
+    EXPECT_TRUE(interpreter.global_scope().global_get("n").as<Map>()->sharesStorage());
+
+    EXPECT_EQ(run("a"), "Array(Nil(), Number(2), Number(3))");
+    EXPECT_EQ(run("@[1, 2, 3,]"), "Array(Number(1), Number(2), Number(3))");
+    EXPECT_EQ(run("@{x = 1, y = nil,}"), "Map(x = Number(1), y = Nil())");
+    EXPECT_EQ(interpreter.global_scope().constant_count(), 2);
+}
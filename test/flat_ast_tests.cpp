@@ -0,0 +1,82 @@
+#include <gtest/gtest.h>
+#include <memory>
+#include <string>
+#include <repl/ast.h>
+#include <repl/flat_ast.h>
+#include <repl/interpreter.h>
+#include <repl/lexer.h>
+#include <repl/object.h>
+#include <repl/parser.h>
+
+class FlatAstTest : public ::testing::Test {
+protected:
+    static FlatAst parse(const std::string &input) {
+        auto lexer = std::make_unique<Lexer>(input);
+        return Parser(lexer).parse_flat();
+    }
+};
+
+TEST_F(FlatAstTest, LaysOutNodesInPostOrder) {
+    const auto ast = parse("a.b[1] = nil");
+
+    ASSERT_EQ(ast.size(), 5);
+    EXPECT_EQ(ast.kind(0), NodeKind::VARIABLE);
+    EXPECT_EQ(ast.kind(1), NodeKind::SYMBOL);
+    EXPECT_EQ(ast.kind(2), NodeKind::NUMBER);
+    EXPECT_EQ(ast.kind(3), NodeKind::NIL);
+    EXPECT_EQ(ast.kind(4), NodeKind::ACCESS_PATH);
+    EXPECT_EQ(ast.root(), 4);
+
+    EXPECT_EQ(ast.atom(0), Atom("a"));
+    EXPECT_EQ(ast.atom(1), Atom("b"));
+    EXPECT_EQ(ast.number(2), 1);
+    EXPECT_EQ(ast.operand(4), 2);
+    EXPECT_EQ(ast.childrenOf(4).size(), 4);
+    EXPECT_EQ(ast.child(4, 3), 3);
+    EXPECT_EQ(ast.childrenOf(0).size(), 0);
+}
+
+TEST_F(FlatAstTest, LowersHandBuiltTreeIdentically) {
+    auto a = std::make_unique<Variable>("a");
+    const auto path = std::make_unique<AccessPath>(a, std::vector<Identifier>{Atom("b"), 3});
+
+    EXPECT_EQ(FlatAst::from(*path), parse("a.b[3]"));
+}
+
+TEST_F(FlatAstTest, EqualTreesHashEqual) {
+    const auto left = parse("$m = @{x = @[1, nil,], y = z[2],}");
+    const auto right = parse("$m   =   @{ x = @[ 1,nil, ], y = z [2], }");
+
+    EXPECT_EQ(left, right);
+    EXPECT_EQ(left.hash(), right.hash());
+}
+
+TEST_F(FlatAstTest, DifferentTreesDiffer) {
+    const auto inputs = {"a.b", "a.b = 1", "a.c", "b.b", "a[1]", "a[2]", "@[1, 2,]", "@[@[1,], 2,]", "@[@[1, 2,],]", "print a"};
+    std::vector<FlatAst> asts;
+    for (const auto *input: inputs) {
+        asts.push_back(parse(input));
+    }
+    for (size_t i = 0; i < asts.size(); i++) {
+        for (size_t j = i + 1; j < asts.size(); j++) {
+            EXPECT_NE(asts[i], asts[j]) << i << " vs " << j;
+            EXPECT_NE(asts[i].hash(), asts[j].hash()) << i << " vs " << j;
+        }
+    }
+}
+
+TEST_F(FlatAstTest, InterpreterExecutesFlatForm) {
+    Interpreter interpreter;
+    interpreter.execute(parse("$a = @[1, @{k = 2,},]"));
+
+    const auto result = interpreter.execute(parse("a[1].k"));
+    ASSERT_TRUE(result.isNumber());
+    EXPECT_EQ(result.asNumber(), 2);
+
+    interpreter.execute(parse("a[1].k = 7"));
+    const auto updated = interpreter.execute(parse("a[1]"));
+    EXPECT_EQ(updated.toString(), "Map(k = Number(7))");
+
+    EXPECT_THROW(interpreter.execute(parse("$a = 1")), InterpreterError);
+    EXPECT_THROW(interpreter.execute(parse("missing")), InterpreterError);
+}
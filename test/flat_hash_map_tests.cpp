@@ -0,0 +1,105 @@
+#include <gtest/gtest.h>
+#include <map>
+#include <memory>
+#include <string>
+#include <string_view>
+#include <repl/flat_hash_map.h>
+#include <repl/interner.h>
+
+TEST(FlatHashMapTest, InsertsAndFinds) {
+    FlatHashMap<int, int> map;
+    EXPECT_TRUE(map.empty());
+    EXPECT_EQ(map.find(1), map.end());
+
+    EXPECT_TRUE(map.try_emplace(1, 10).second);
+    EXPECT_FALSE(map.try_emplace(1, 20).second);
+    map[2] = 30;
+    EXPECT_EQ(map.size(), 2);
+    EXPECT_EQ(map.find(1)->second, 10);
+    EXPECT_EQ(map.at(2), 30);
+    EXPECT_THROW(map.at(3), std::out_of_range);
+}
+
+TEST(FlatHashMapTest, GrowsAndMatchesStdMap) {
+    FlatHashMap<int, int> map;
+    std::map<int, int> expected;
+    for (int i = 0; i < 5000; i++) {
+        map[i * 7] = i;
+        expected[i * 7] = i;
+    }
+    EXPECT_EQ(map.size(), expected.size());
+    // load factor stays at or below 7/8
+    EXPECT_LE(map.size() * 8, map.bucket_count() * 7);
+    for (const auto &[key, value]: expected) {
+        ASSERT_TRUE(map.contains(key));
+        EXPECT_EQ(map.at(key), value);
+    }
+    EXPECT_FALSE(map.contains(1));
+
+    std::size_t visited = 0;
+    for (const auto &[key, value]: map) {
+        EXPECT_EQ(expected.at(key), value);
+        visited++;
+    }
+    EXPECT_EQ(visited, expected.size());
+}
+
+TEST(FlatHashMapTest, EraseKeepsOtherKeysReachable) {
+    FlatHashMap<int, int> map;
+    for (int i = 0; i < 1000; i++) {
+        map[i] = i;
+    }
+    for (int i = 0; i < 1000; i += 2) {
+        EXPECT_EQ(map.erase(i), 1);
+    }
+    EXPECT_EQ(map.erase(0), 0);
+    EXPECT_EQ(map.size(), 500);
+    for (int i = 0; i < 1000; i++) {
+        EXPECT_EQ(map.contains(i), i % 2 == 1);
+    }
+
+    // churn through tombstones without the table growing without bound
+    const auto capacity = map.bucket_count();
+    for (int round = 0; round < 20; round++) {
+        for (int i = 0; i < 1000; i += 2) {
+            map[i + 100000] = i;
+        }
+        for (int i = 0; i < 1000; i += 2) {
+            map.erase(i + 100000);
+        }
+    }
+    EXPECT_EQ(map.size(), 500);
+    EXPECT_EQ(map.bucket_count(), capacity);
+}
+
+TEST(FlatHashMapTest, LooksUpStringKeysByView) {
+    FlatHashMap<std::string, int, StringHash, std::equal_to<> > map;
+    map.try_emplace("alpha", 1);
+    map.try_emplace(std::string("beta"), 2);
+
+    const std::string text = "alpha beta";
+    EXPECT_EQ(map.find(std::string_view(text).substr(0, 5))->second, 1);
+    EXPECT_EQ(map.at(std::string_view(text).substr(6)), 2);
+    EXPECT_TRUE(map.contains("beta"));
+    EXPECT_FALSE(map.contains(std::string_view("gamma")));
+}
+
+TEST(FlatHashMapTest, CopiesAndMovesOwningValues) {
+    FlatHashMap<Atom, std::shared_ptr<int> > map;
+    map["left"] = std::make_shared<int>(1);
+    map["right"] = std::make_shared<int>(2);
+    const auto shared = map.at("left");
+
+    auto copy = map;
+    EXPECT_EQ(copy, map);
+    EXPECT_EQ(shared.use_count(), 3);
+
+    auto moved = std::move(copy);
+    EXPECT_EQ(moved.size(), 2);
+    EXPECT_EQ(shared.use_count(), 3);
+
+    moved.clear();
+    map.erase("left");
+    EXPECT_EQ(shared.use_count(), 1);
+    EXPECT_EQ(*map.at("right"), 2);
+}
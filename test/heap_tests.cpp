@@ -0,0 +1,136 @@
+#include <gtest/gtest.h>
+#include <memory>
+#include <string>
+#include <repl/bytecode.h>
+#include <repl/heap.h>
+#include <repl/interpreter.h>
+#include <repl/lexer.h>
+#include <repl/object.h>
+#include <repl/parser.h>
+#include "vm_fixture.h"
+
+class HeapTest : public VmTest {
+protected:
+    Heap &heap = Heap::local();
+
+    void SetUp() override {
+        // start without garbage left by other tests
+        this->heap.collect();
+    }
+};
+
+TEST_F(HeapTest, CountsLiveObjects) {
+    const auto before = heap.statistics();
+    auto array = Value::make<Array>(std::vector{Value::nil()});
+    EXPECT_EQ(heap.statistics().objects, before.objects + 1);
+    EXPECT_EQ(heap.statistics().bytes, before.bytes + sizeof(Array));
+
+    array = Value::nil();
+    EXPECT_EQ(heap.statistics().objects, before.objects);
+    EXPECT_EQ(heap.statistics().bytes, before.bytes);
+}
+
+TEST_F(HeapTest, PrintsCyclesOnce) {
+    run("$a = @[1, 2,]");
+    EXPECT_EQ(run("a[0] = a"), "Array(Array(...), Number(2))");
+    run("$m = @{k = nil,}");
+    EXPECT_EQ(run("m.k = @[m,]"), "Array(Map(k = Array(...)))");
+}
+
+TEST_F(HeapTest, CollectsUnreachableCycles) {
+    const auto before = heap.statistics();
+    run("$a = @[1,]");
+    run("$m = @{self = nil, other = a,}");
+    run("a[0] = a");
+    run("m.self = m");
+    // a, m, and the hoisted constant a was copied from
+    EXPECT_EQ(heap.statistics().objects, before.objects + 3);
+
+    // still reachable from the globals
+    EXPECT_EQ(heap.collect(), 0);
+    EXPECT_EQ(run("m.other[0][0]"), "Array(Array(...))");
+
+    // a still holds itself, and m itself, after the globals let go
+    run("a = nil");
+    run("m = nil");
+    EXPECT_EQ(heap.statistics().objects, before.objects + 3);
+    EXPECT_EQ(heap.collect(), 2);
+    EXPECT_EQ(heap.statistics().objects, before.objects + 1);
+    EXPECT_EQ(heap.statistics().collections, before.collections + 2);
+}
+
+TEST_F(HeapTest, ValuesHeldByCodeAreRoots) {
+    auto array = Value::make<Array>(std::vector{Value::nil()});
+    array.set_item(0, array);
+    Array on_stack(std::vector{array});
+
+    EXPECT_EQ(heap.collect(), 0);
+    EXPECT_EQ(on_stack.get(0).toString(), "Array(Array(...))");
+
+    array = Value::nil();
+    on_stack.set(0, Value::nil());
+    EXPECT_EQ(heap.collect(), 1);
+}
+
+TEST_F(HeapTest, CountsSharedNodesOnce) {
+    run("$c = @[1,]");
+    // two leaves, so a store into the second leaves the first shared
+    std::string literal = "$x = @[c";
+    for (int i = 0; i < 39; i++) {
+        literal += ", nil";
+    }
+    run(literal + ",]");
+    run("x[39] = x");
+    run("$s = clone(x)");
+    run("s[39] = s");
+    run("x = nil");
+    run("s = nil");
+
+    // c is held once by the leaf x and s share, and by its global
+    EXPECT_EQ(heap.collect(), 2);
+    EXPECT_EQ(run("c"), "Array(Number(1))");
+}
+
+TEST_F(HeapTest, DropsPastsNoCloneLooksBackTo) {
+    run("$x = @[@[1,],]");
+    run("$s = clone(x)");
+    const auto before = heap.statistics().objects;
+    // x keeps the array it held for s
+    run("x[0] = nil");
+    EXPECT_EQ(heap.statistics().objects, before);
+    EXPECT_EQ(run("s[0]"), "Array(Number(1))");
+
+    // s copied it in, and once s is gone nothing looks back
+    run("s = nil");
+    heap.collect();
+    EXPECT_EQ(heap.statistics().objects, before - 2);
+}
+
+TEST_F(HeapTest, CollectsLongChainsWithoutRecursion) {
+    const auto before = heap.statistics().objects;
+    auto head = Value::make<Array>(std::vector{Value::nil()});
+    auto tail = head;
+    for (int i = 0; i < 100000; i++) {
+        auto next = Value::make<Array>(std::vector{Value::nil()});
+        tail.set_item(0, next);
+        tail = next;
+    }
+    tail.set_item(0, head);
+    tail = head = Value();
+
+    EXPECT_EQ(heap.collect(), 100001);
+    EXPECT_EQ(heap.statistics().objects, before);
+}
+
+TEST_F(HeapTest, CollectsOnceTheHeapHasGrown) {
+    const auto collections = heap.statistics().collections;
+    heap.maybeCollect();
+    EXPECT_EQ(heap.statistics().collections, collections);
+
+    auto values = std::vector<Value>();
+    for (std::size_t i = 0; i < Heap::MIN_THRESHOLD; i++) {
+        values.push_back(Value::make<Array>(std::vector<Value>()));
+    }
+    heap.maybeCollect();
+    EXPECT_EQ(heap.statistics().collections, collections + 1);
+}
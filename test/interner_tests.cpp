@@ -0,0 +1,43 @@
+#include <gtest/gtest.h>
+#include <string>
+#include <thread>
+#include <vector>
+#include <repl/interner.h>
+
+TEST(InternerTest, SameNameSameAtom) {
+    const Atom first("interner_same");
+    const Atom second(std::string("interner_same"));
+    EXPECT_EQ(first, second);
+    EXPECT_EQ(first.id(), second.id());
+    EXPECT_EQ(first.str(), "interner_same");
+}
+
+TEST(InternerTest, DistinctNamesDistinctAtoms) {
+    EXPECT_NE(Atom("interner_left"), Atom("interner_right"));
+}
+
+TEST(InternerTest, FromIdRoundTrips) {
+    const Atom atom("interner_round_trip");
+    EXPECT_EQ(Atom::fromId(atom.id()), atom);
+    EXPECT_EQ(Atom::fromId(atom.id()).str(), "interner_round_trip");
+}
+
+TEST(InternerTest, ConcurrentInterningAgrees) {
+    constexpr int THREADS = 4;
+    constexpr int NAMES = 500;
+    std::vector<std::vector<std::uint32_t> > ids(THREADS);
+    std::vector<std::thread> threads;
+    for (int t = 0; t < THREADS; t++) {
+        threads.emplace_back([t, &ids] {
+            for (int i = 0; i < NAMES; i++) {
+                ids[t].push_back(Atom("interner_concurrent_" + std::to_string(i)).id());
+            }
+        });
+    }
+    for (auto &thread: threads) {
+        thread.join();
+    }
+    for (int t = 1; t < THREADS; t++) {
+        EXPECT_EQ(ids[t], ids[0]);
+    }
+}
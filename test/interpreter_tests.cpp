@@ -17,19 +17,17 @@ TEST_F(InterpreterTest, EvaluateNumberLiteral) {
     auto number = std::make_unique<NumberLiteral>(42);
     auto result = interpreter->visit(*number);
 
-    // Check if result is a Number object
-    auto *num_obj = dynamic_cast<Number *>(result.get());
-    ASSERT_NE(num_obj, nullptr);
-    EXPECT_EQ(num_obj->num, 42);
+    // Check if result is a number
+    ASSERT_TRUE(result.isNumber());
+    EXPECT_EQ(result.asNumber(), 42);
 }
 
 TEST_F(InterpreterTest, EvaluateNilLiteral) {
     auto nil = std::make_unique<NilLiteral>();
     auto result = interpreter->visit(*nil);
 
-    // Check if result is a Nil object
-    auto *nil_obj = dynamic_cast<Nil *>(result.get());
-    ASSERT_NE(nil_obj, nullptr);
+    // Check if result is nil
+    ASSERT_TRUE(result.isNil());
 }
 
 TEST_F(InterpreterTest, EvaluateVariableDeclaration) {
@@ -43,9 +41,8 @@ TEST_F(InterpreterTest, EvaluateVariableDeclaration) {
     auto var_access = std::make_unique<Variable>("x");
     auto result = interpreter->visit(*var_access);
 
-    auto *num_obj = dynamic_cast<Number *>(result.get());
-    ASSERT_NE(num_obj, nullptr);
-    EXPECT_EQ(num_obj->num, 42);
+    ASSERT_TRUE(result.isNumber());
+    EXPECT_EQ(result.asNumber(), 42);
 }
 
 TEST_F(InterpreterTest, ThrowsOnUndefinedVariable) {
@@ -80,13 +77,12 @@ TEST_F(InterpreterTest, EvaluateArrayDefinition) {
     auto array_def = std::make_unique<ArrayDefinition>(std::move(elements));
     auto result = interpreter->visit(*array_def);
 
-    auto *array_obj = dynamic_cast<Array *>(result.get());
+    auto *array_obj = result.as<Array>();
     ASSERT_NE(array_obj, nullptr);
-    EXPECT_EQ(array_obj->elements.size(), 3);
+    EXPECT_EQ(array_obj->size(), 3);
 
-    auto *first_num = dynamic_cast<Number *>(array_obj->elements[0].get());
-    ASSERT_NE(first_num, nullptr);
-    EXPECT_EQ(first_num->num, 1);
+    ASSERT_TRUE(array_obj->get(0).isNumber());
+    EXPECT_EQ(array_obj->get(0).asNumber(), 1);
 }
 
 TEST_F(InterpreterTest, EvaluateMapDefinition) {
@@ -99,13 +95,12 @@ TEST_F(InterpreterTest, EvaluateMapDefinition) {
     auto map_def = std::make_unique<MapDefinition>(std::move(entries));
     auto result = interpreter->visit(*map_def);
 
-    auto *map_obj = dynamic_cast<Map *>(result.get());
+    auto *map_obj = result.as<Map>();
     ASSERT_NE(map_obj, nullptr);
-    EXPECT_EQ(map_obj->map.size(), 1);
+    EXPECT_EQ(map_obj->size(), 1);
 
-    auto *value = dynamic_cast<Number *>(map_obj->map["name"].get());
-    ASSERT_NE(value, nullptr);
-    EXPECT_EQ(value->num, 42);
+    ASSERT_TRUE(map_obj->_get_item(Atom("name")).isNumber());
+    EXPECT_EQ(map_obj->_get_item(Atom("name")).asNumber(), 42);
 }
 
 TEST_F(InterpreterTest, ArrayAccessor) {
@@ -121,14 +116,12 @@ TEST_F(InterpreterTest, ArrayAccessor) {
     interpreter->visit(*declaration);
 
     // Create getter expression
-    std::unique_ptr<Expr> instance = std::make_unique<Variable>("arr");
-    std::unique_ptr<Expr> accessor = std::make_unique<NumberLiteral>(1);
-    auto getter = std::make_unique<GetterExpr>(instance, accessor);
+    auto instance = std::make_unique<Variable>("arr");
+    auto getter = std::make_unique<AccessPath>(instance, std::vector<Identifier>{1});
 
     auto result = interpreter->visit(*getter);
-    auto *num_obj = dynamic_cast<Number *>(result.get());
-    ASSERT_NE(num_obj, nullptr);
-    EXPECT_EQ(num_obj->num, 2);
+    ASSERT_TRUE(result.isNumber());
+    EXPECT_EQ(result.asNumber(), 2);
 }
 
 TEST_F(InterpreterTest, MapAccessor) {
@@ -145,14 +138,12 @@ TEST_F(InterpreterTest, MapAccessor) {
     interpreter->visit(*declaration);
 
     // Create getter expression
-    std::unique_ptr<Expr> instance = std::make_unique<Variable>("person");
-    std::unique_ptr<Expr> accessor = std::make_unique<Symbol>("age");
-    auto getter = std::make_unique<GetterExpr>(instance, accessor);
+    auto instance = std::make_unique<Variable>("person");
+    auto getter = std::make_unique<AccessPath>(instance, std::vector<Identifier>{Atom("age")});
 
     auto result = interpreter->visit(*getter);
-    auto *num_obj = dynamic_cast<Number *>(result.get());
-    ASSERT_NE(num_obj, nullptr);
-    EXPECT_EQ(num_obj->num, 25);
+    ASSERT_TRUE(result.isNumber());
+    EXPECT_EQ(result.asNumber(), 25);
 }
 
 TEST_F(InterpreterTest, EvaluateAssignment) {
@@ -169,16 +160,14 @@ TEST_F(InterpreterTest, EvaluateAssignment) {
     auto result = interpreter->visit(*assignment);
 
     // Check the result of the assignment
-    auto *num_obj = dynamic_cast<Number *>(result.get());
-    ASSERT_NE(num_obj, nullptr);
-    EXPECT_EQ(num_obj->num, 100);
+    ASSERT_TRUE(result.isNumber());
+    EXPECT_EQ(result.asNumber(), 100);
 
     // Verify the variable was actually updated
     auto var_access = std::make_unique<Variable>("x");
     auto stored_value = interpreter->visit(*var_access);
-    auto *stored_num = dynamic_cast<Number *>(stored_value.get());
-    ASSERT_NE(stored_num, nullptr);
-    EXPECT_EQ(stored_num->num, 100);
+    ASSERT_TRUE(stored_value.isNumber());
+    EXPECT_EQ(stored_value.asNumber(), 100);
 }
 
 TEST_F(InterpreterTest, AssignmentThrowsOnUndefinedVariable) {
@@ -203,25 +192,21 @@ TEST_F(InterpreterTest, ArraySetterExpr) {
     interpreter->visit(*declaration);
 
     // Create setter expression
-    std::unique_ptr<Expr> instance = std::make_unique<Variable>("arr");
-    std::unique_ptr<Expr> accessor = std::make_unique<NumberLiteral>(1);
+    auto instance = std::make_unique<Variable>("arr");
     std::unique_ptr<Expr> new_value = std::make_unique<NumberLiteral>(42);
-    auto setter = std::make_unique<SetterExpr>(instance, accessor, new_value);
+    auto setter = std::make_unique<AccessPath>(instance, std::vector<Identifier>{1}, new_value);
 
     // Test the setter
     auto result = interpreter->visit(*setter);
-    auto *num_obj = dynamic_cast<Number *>(result.get());
-    ASSERT_NE(num_obj, nullptr);
-    EXPECT_EQ(num_obj->num, 42);
+    ASSERT_TRUE(result.isNumber());
+    EXPECT_EQ(result.asNumber(), 42);
 
     // Verify the array was actually updated
-    std::unique_ptr<Expr> get_instance = std::make_unique<Variable>("arr");
-    std::unique_ptr<Expr> get_accessor = std::make_unique<NumberLiteral>(1);
-    auto getter = std::make_unique<GetterExpr>(get_instance, get_accessor);
+    auto get_instance = std::make_unique<Variable>("arr");
+    auto getter = std::make_unique<AccessPath>(get_instance, std::vector<Identifier>{1});
     auto stored_value = interpreter->visit(*getter);
-    auto *stored_num = dynamic_cast<Number *>(stored_value.get());
-    ASSERT_NE(stored_num, nullptr);
-    EXPECT_EQ(stored_num->num, 42);
+    ASSERT_TRUE(stored_value.isNumber());
+    EXPECT_EQ(stored_value.asNumber(), 42);
 }
 
 TEST_F(InterpreterTest, MapSetterExpr) {
@@ -237,23 +222,19 @@ TEST_F(InterpreterTest, MapSetterExpr) {
     interpreter->visit(*declaration);
 
     // Create setter expression
-    std::unique_ptr<Expr> instance = std::make_unique<Variable>("person");
-    std::unique_ptr<Expr> accessor = std::make_unique<Symbol>("age");
+    auto instance = std::make_unique<Variable>("person");
     std::unique_ptr<Expr> new_value = std::make_unique<NumberLiteral>(30);
-    auto setter = std::make_unique<SetterExpr>(instance, accessor, new_value);
+    auto setter = std::make_unique<AccessPath>(instance, std::vector<Identifier>{Atom("age")}, new_value);
 
     // Test the setter
     auto result = interpreter->visit(*setter);
-    auto *num_obj = dynamic_cast<Number *>(result.get());
-    ASSERT_NE(num_obj, nullptr);
-    EXPECT_EQ(num_obj->num, 30);
+    ASSERT_TRUE(result.isNumber());
+    EXPECT_EQ(result.asNumber(), 30);
 
     // Verify the map was actually updated
-    std::unique_ptr<Expr> get_instance = std::make_unique<Variable>("person");
-    std::unique_ptr<Expr> get_accessor = std::make_unique<Symbol>("age");
-    auto getter = std::make_unique<GetterExpr>(get_instance, get_accessor);
+    auto get_instance = std::make_unique<Variable>("person");
+    auto getter = std::make_unique<AccessPath>(get_instance, std::vector<Identifier>{Atom("age")});
     auto stored_value = interpreter->visit(*getter);
-    auto *stored_num = dynamic_cast<Number *>(stored_value.get());
-    ASSERT_NE(stored_num, nullptr);
-    EXPECT_EQ(stored_num->num, 30);
+    ASSERT_TRUE(stored_value.isNumber());
+    EXPECT_EQ(stored_value.asNumber(), 30);
 }
@@ -0,0 +1,50 @@
+#include <gtest/gtest.h>
+#include <algorithm>
+#include <cstdint>
+#include <limits>
+#include <numeric>
+#include <vector>
+#include <repl/kernels.h>
+
+namespace {
+    // lengths around each vector width, so both the vector loop and the
+    // scalar tail are exercised
+    std::vector<std::int32_t> numbers(const std::size_t count) {
+        auto result = std::vector<std::int32_t>(count);
+        for (std::size_t i = 0; i < count; i++) {
+            result[i] = static_cast<std::int32_t>((i * 7919) % 201) - 100;
+        }
+        return result;
+    }
+}
+
+TEST(KernelsTest, MatchScalarResults) {
+    for (std::size_t count = 1; count <= 37; count++) {
+        const auto input = numbers(count);
+        EXPECT_EQ(kernels::sum(input), std::accumulate(input.begin(), input.end(), std::int64_t{0})) << count;
+        EXPECT_EQ(kernels::min(input), *std::ranges::min_element(input)) << count;
+        EXPECT_EQ(kernels::max(input), *std::ranges::max_element(input)) << count;
+        for (const auto needle: {input.front(), input.back(), std::int32_t{1000}}) {
+            const auto expected = static_cast<std::size_t>(std::ranges::find(input, needle) - input.begin());
+            EXPECT_EQ(kernels::find(input, needle), expected) << count;
+        }
+    }
+    EXPECT_EQ(kernels::sum({}), 0);
+    EXPECT_EQ(kernels::find({}, 1), 0);
+}
+
+TEST(KernelsTest, SumDoesNotOverflow) {
+    const auto input = std::vector<std::int32_t>(19, std::numeric_limits<std::int32_t>::max());
+    EXPECT_EQ(kernels::sum(input), std::int64_t{19} * std::numeric_limits<std::int32_t>::max());
+
+    const auto negative = std::vector<std::int32_t>(19, std::numeric_limits<std::int32_t>::min());
+    EXPECT_EQ(kernels::sum(negative), std::int64_t{19} * std::numeric_limits<std::int32_t>::min());
+}
+
+TEST(KernelsTest, FillsEveryElement) {
+    for (std::size_t count = 0; count <= 19; count++) {
+        auto output = numbers(count);
+        kernels::fill(output, -3);
+        EXPECT_TRUE(std::ranges::all_of(output, [](const auto number) { return number == -3; })) << count;
+    }
+}
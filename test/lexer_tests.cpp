@@ -67,8 +67,8 @@ TEST(LexerTest, IdentifierToken) {
 
     Token token = lexer.nextToken();
     EXPECT_EQ(token.type, TokenType::IDENTIFIER);
-    auto idValue = std::get<std::string>(token.value);
-    EXPECT_EQ(idValue, "helloWorld");
+    auto idValue = std::get<Atom>(token.value);
+    EXPECT_EQ(idValue.str(), "helloWorld");
 
     token = lexer.nextToken();
     EXPECT_EQ(token.type, TokenType::EOF_);
@@ -84,8 +84,8 @@ TEST(LexerTest, SkipsWhiteSpace) {
 
     token = lexer.nextToken();
     EXPECT_EQ(token.type, TokenType::IDENTIFIER);
-    auto idValue = std::get<std::string>(token.value);
-    EXPECT_EQ(idValue, "token");
+    auto idValue = std::get<Atom>(token.value);
+    EXPECT_EQ(idValue.str(), "token");
 
     token = lexer.nextToken();
     EXPECT_EQ(token.type, TokenType::NUMBER);
@@ -109,8 +109,8 @@ TEST(LexerTest, PeekTokenDoesNotAdvance) {
     // After consuming the '$' token, the next token should be the identifier "token".
     Token second = lexer.nextToken();
     EXPECT_EQ(second.type, TokenType::IDENTIFIER);
-    auto idValue = std::get<std::string>(second.value);
-    EXPECT_EQ(idValue, "token");
+    auto idValue = std::get<Atom>(second.value);
+    EXPECT_EQ(idValue.str(), "token");
 
     // Finally, the lexer should return EOF after consuming all tokens.
     Token third = lexer.nextToken();
@@ -138,3 +138,94 @@ TEST(LexerTest, EmptyInput) {
     Token token = lexer.nextToken();
     EXPECT_EQ(token.type, TokenType::EOF_);
 }
+
+TEST(LexerTest, TokenizeProducesFlatArray) {
+    string input = "$x = @[1, foo,]";
+    Lexer lexer(input);
+
+    const auto tokens = lexer.tokenize();
+    const std::vector<TokenType> expected = {
+        TokenType::DOLLAR, TokenType::IDENTIFIER, TokenType::EQ, TokenType::AT,
+        TokenType::LEFT_SQUARE, TokenType::NUMBER, TokenType::COMMA, TokenType::IDENTIFIER,
+        TokenType::COMMA, TokenType::RIGHT_SQUARE, TokenType::EOF_,
+    };
+    ASSERT_EQ(tokens.size(), expected.size());
+    for (size_t i = 0; i < expected.size(); i++) {
+        EXPECT_EQ(tokens[i].type, expected[i]);
+    }
+    EXPECT_EQ(std::get<int>(tokens[5].value), 1);
+    EXPECT_EQ(std::get<Atom>(tokens[7].value).str(), "foo");
+}
+
+TEST(LexerTest, LongRunsCrossVectorBoundaries) {
+    // runs longer than one SIMD register, ending at every offset inside one
+    for (size_t length = 1; length < 80; length++) {
+        const string spaces(length, ' ');
+        const string name = "a" + string(length, 'Z') + "9";
+        const string digits(length % 9 + 1, '7');
+        string input = spaces + name + "\t\r\n" + spaces + digits + spaces;
+        Lexer lexer(input);
+
+        Token token = lexer.nextToken();
+        ASSERT_EQ(token.type, TokenType::IDENTIFIER);
+        EXPECT_EQ(std::get<Atom>(token.value).str(), name);
+
+        EXPECT_EQ(lexer.nextToken().type, TokenType::NEWLINE);
+
+        token = lexer.nextToken();
+        ASSERT_EQ(token.type, TokenType::NUMBER);
+        EXPECT_EQ(std::get<int>(token.value), std::stoi(digits));
+
+        EXPECT_EQ(lexer.nextToken().type, TokenType::EOF_);
+    }
+}
+
+TEST(LexerTest, IdentifiersAreInternedAtLexTime) {
+    string input = "first.second first";
+    Lexer lexer(input);
+
+    const auto tokens = lexer.tokenize();
+    const auto first = std::get<Atom>(tokens[0].value);
+    const auto second = std::get<Atom>(tokens[2].value);
+    EXPECT_EQ(first, std::get<Atom>(tokens[3].value));
+    EXPECT_NE(first, second);
+    EXPECT_EQ(first, Atom("first"));
+}
+
+TEST(LexerTest, UnexpectedCharacterIsInvalid) {
+    string input = "a # b";
+    Lexer lexer(input);
+
+    EXPECT_EQ(lexer.nextToken().type, TokenType::IDENTIFIER);
+    const Token token = lexer.nextToken();
+    EXPECT_EQ(token.type, TokenType::INVALID);
+    EXPECT_EQ(token.offset, 2);
+    EXPECT_EQ(lexer.nextToken().type, TokenType::IDENTIFIER);
+}
+
+TEST(LexerTest, SeparatorsAndOffsets) {
+    string input = "a;\n  $b";
+    Lexer lexer(input);
+
+    const TokenType types[] = {
+        TokenType::IDENTIFIER, TokenType::SEMICOLON, TokenType::NEWLINE, TokenType::DOLLAR,
+        TokenType::IDENTIFIER, TokenType::EOF_,
+    };
+    const std::size_t offsets[] = {0, 1, 2, 5, 6, 7};
+    for (std::size_t i = 0; i < std::size(types); i++) {
+        const Token token = lexer.nextToken();
+        EXPECT_EQ(token.type, types[i]);
+        EXPECT_EQ(token.offset, offsets[i]);
+    }
+}
+
+TEST(LexerTest, Parentheses) {
+    string input = "sum(a)";
+    Lexer lexer(input);
+
+    EXPECT_EQ(lexer.nextToken().type, TokenType::IDENTIFIER);
+    EXPECT_EQ(lexer.nextToken().type, TokenType::LEFT_PAREN);
+    EXPECT_EQ(lexer.nextToken().type, TokenType::IDENTIFIER);
+    EXPECT_EQ(lexer.nextToken().type, TokenType::RIGHT_PAREN);
+    EXPECT_EQ(lexer.nextToken().type, TokenType::EOF_);
+}
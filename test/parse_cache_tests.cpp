@@ -0,0 +1,104 @@
+#include <gtest/gtest.h>
+#include <string>
+#include <repl/interpreter.h>
+#include <repl/parse_cache.h>
+
+class ParseCacheTest : public ::testing::Test {
+protected:
+    Globals globals;
+};
+
+TEST_F(ParseCacheTest, RepeatedTextHits) {
+    ParseCache cache(globals, 8);
+
+    const auto first = cache.get("orders[0].status");
+    const auto second = cache.get("orders[0].status");
+
+    EXPECT_EQ(first, second);
+    EXPECT_EQ(cache.hits(), 1);
+    EXPECT_EQ(cache.misses(), 1);
+    EXPECT_EQ(cache.size(), 1);
+    EXPECT_EQ(first->ast.kind(first->ast.root()), NodeKind::PROGRAM);
+}
+
+TEST_F(ParseCacheTest, EvictsLeastRecentlyUsed) {
+    ParseCache cache(globals, 2);
+
+    cache.get("a");
+    cache.get("b");
+    cache.get("a");
+    cache.get("c"); // evicts b, the least recently used
+
+    EXPECT_EQ(cache.size(), 2);
+    cache.get("a");
+    cache.get("c");
+    EXPECT_EQ(cache.hits(), 3);
+    cache.get("b");
+    EXPECT_EQ(cache.misses(), 4);
+}
+
+TEST_F(ParseCacheTest, EquivalentTextsShareOneAst) {
+    ParseCache cache(globals, 8);
+
+    const auto tight = cache.get("cfg.limits.max");
+    const auto spaced = cache.get("cfg . limits . max ");
+    const auto other = cache.get("cfg.limits.min");
+
+    EXPECT_EQ(tight, spaced);
+    EXPECT_NE(tight, other);
+    EXPECT_EQ(cache.misses(), 3);
+    EXPECT_EQ(cache.shared(), 1);
+    EXPECT_EQ(cache.size(), 3);
+}
+
+TEST_F(ParseCacheTest, SharedAstSurvivesEviction) {
+    ParseCache cache(globals, 1);
+
+    const auto held = cache.get("$x = @[1, 2,]");
+    cache.get("y");
+    EXPECT_EQ(cache.size(), 1);
+    EXPECT_EQ(held->ast.kind(held->ast.child(held->ast.root(), 0)), NodeKind::DECLARATION);
+
+    // evicted but still alive through `held`, so it is found by structure
+    const auto again = cache.get("$x  =  @[1,2,]");
+    EXPECT_EQ(again, held);
+    EXPECT_EQ(cache.shared(), 1);
+}
+
+TEST_F(ParseCacheTest, CachesDiagnosticsWithoutSharing) {
+    ParseCache cache(globals, 8);
+
+    const auto bad = cache.get("$x = ");
+    ASSERT_EQ(bad->diagnostics.size(), 1);
+    EXPECT_EQ(bad->diagnostics[0].column, 6);
+
+    EXPECT_EQ(cache.get("$x = "), bad);
+    EXPECT_EQ(cache.hits(), 1);
+
+    const auto shifted = cache.get(" $x = ");
+    EXPECT_NE(shifted, bad);
+    EXPECT_EQ(shifted->diagnostics[0].column, 7);
+    EXPECT_EQ(cache.shared(), 0);
+}
+
+TEST_F(ParseCacheTest, ZeroCapacityAlwaysParses) {
+    ParseCache cache(globals, 0);
+
+    cache.get("a.b");
+    cache.get("a.b");
+
+    EXPECT_EQ(cache.size(), 0);
+    EXPECT_EQ(cache.hits(), 0);
+    EXPECT_EQ(cache.misses(), 2);
+}
+
+TEST_F(ParseCacheTest, KeysOutliveCallerBuffers) {
+    ParseCache cache(globals, 4);
+    {
+        std::string line = "scratch.value";
+        cache.get(line);
+        line.assign(line.size(), '#');
+    }
+    EXPECT_TRUE(cache.get("scratch.value")->diagnostics.empty());
+    EXPECT_EQ(cache.hits(), 1);
+}
@@ -45,11 +45,8 @@ TEST_F(ParserTest, ParsesDeclaration) {
 TEST_F(ParserTest, ParsesPropertyAccess) {
     auto expr = parse("a.b.c");
 
-    std::unique_ptr<Expr> a = std::make_unique<Variable>("a");
-    std::unique_ptr<Expr> b = std::make_unique<Symbol>("b");
-    std::unique_ptr<Expr> a_b = std::make_unique<GetterExpr>(a, b);
-    std::unique_ptr<Expr> c = std::make_unique<Symbol>("c");
-    auto expected = std::make_unique<GetterExpr>(a_b, c);
+    auto a = std::make_unique<Variable>("a");
+    auto expected = std::make_unique<AccessPath>(a, std::vector<Identifier>{Atom("b"), Atom("c")});
 
     EXPECT_TRUE(*expr == *expected);
 }
@@ -114,11 +111,8 @@ TEST_F(ParserTest, ParsesEmptyStatement) {
 TEST_F(ParserTest, ParsesArrayAccess) {
     auto expr = parse("a[1][2]");
 
-    std::unique_ptr<Expr> a = std::make_unique<Variable>("a");
-    std::unique_ptr<Expr> one = std::make_unique<NumberLiteral>(1);
-    std::unique_ptr<Expr> a_1 = std::make_unique<GetterExpr>(a, one);
-    std::unique_ptr<Expr> two = std::make_unique<NumberLiteral>(2);
-    auto expected = std::make_unique<GetterExpr>(a_1, two);
+    auto a = std::make_unique<Variable>("a");
+    auto expected = std::make_unique<AccessPath>(a, std::vector<Identifier>{1, 2});
 
     EXPECT_TRUE(*expr == *expected);
 }
@@ -126,17 +120,9 @@ TEST_F(ParserTest, ParsesArrayAccess) {
 TEST_F(ParserTest, ParsesMixedPropertyAndArrayAccess) {
     auto expr = parse("a.b[1].c.d[2]");
 
-    std::unique_ptr<Expr> a = std::make_unique<Variable>("a");
-    std::unique_ptr<Expr> b = std::make_unique<Symbol>("b");
-    std::unique_ptr<Expr> a_b = std::make_unique<GetterExpr>(a, b);
-    std::unique_ptr<Expr> one = std::make_unique<NumberLiteral>(1);
-    std::unique_ptr<Expr> a_b_1 = std::make_unique<GetterExpr>(a_b, one);
-    std::unique_ptr<Expr> c = std::make_unique<Symbol>("c");
-    std::unique_ptr<Expr> a_b_1_c = std::make_unique<GetterExpr>(a_b_1, c);
-    std::unique_ptr<Expr> d = std::make_unique<Symbol>("d");
-    std::unique_ptr<Expr> a_b_1_c_d = std::make_unique<GetterExpr>(a_b_1_c, d);
-    std::unique_ptr<Expr> two = std::make_unique<NumberLiteral>(2);
-    auto expected = std::make_unique<GetterExpr>(a_b_1_c_d, two);
+    auto a = std::make_unique<Variable>("a");
+    auto expected = std::make_unique<AccessPath>(
+        a, std::vector<Identifier>{Atom("b"), 1, Atom("c"), Atom("d"), 2});
 
     EXPECT_TRUE(*expr == *expected);
 }
@@ -166,39 +152,148 @@ TEST_F(ParserTest, ParsesChainedAccessorAssignments) {
     auto expr = parse("a.b = c.d = e[0] = 1");
 
     // Build the expected AST from inside out
-    // First create e[0]
-    std::unique_ptr<Expr> e_var = std::make_unique<Variable>("e");
-    std::unique_ptr<Expr> zero = std::make_unique<NumberLiteral>(0);
-    auto e_accessor = std::make_unique<AccessorExpr>(e_var, zero);
-
-    // Create e[0] = 1
+    // First e[0] = 1
+    auto e_var = std::make_unique<Variable>("e");
     std::unique_ptr<Expr> one = std::make_unique<NumberLiteral>(1);
-    std::unique_ptr<Expr> e_setter = std::make_unique<SetterExpr>(e_accessor->instance,
-                                                                  e_accessor->accessor,
-                                                                  one);
+    std::unique_ptr<Expr> e_setter = std::make_unique<AccessPath>(e_var, std::vector<Identifier>{0}, one);
 
+    // Then c.d = e[0] = 1
+    auto c_var = std::make_unique<Variable>("c");
+    std::unique_ptr<Expr> c_setter = std::make_unique<AccessPath>(c_var, std::vector<Identifier>{Atom("d")},
+                                                                  e_setter);
 
-    // Create c.d
-    std::unique_ptr<Expr> c_var = std::make_unique<Variable>("c");
-    std::unique_ptr<Expr> d_sym = std::make_unique<Symbol>("d");
-    auto c_accessor = std::make_unique<AccessorExpr>(c_var, d_sym);
+    // Finally a.b = c.d = e[0] = 1
+    auto a_var = std::make_unique<Variable>("a");
+    auto expected = std::make_unique<AccessPath>(a_var, std::vector<Identifier>{Atom("b")}, c_setter);
 
-    // Create c.d = e[0] = 1
-    std::unique_ptr<Expr> c_setter = std::make_unique<SetterExpr>(c_accessor->instance,
-                                                                  c_accessor->accessor,
-                                                                  e_setter);
+    EXPECT_TRUE(*expr == *expected);
+}
 
+TEST_F(ParserTest, GetAndStoreOfSamePathDiffer) {
+    auto get = parse("a.b");
+    auto store = parse("a.b = 1");
 
-    // Create a.b
-    std::unique_ptr<Expr> a_var = std::make_unique<Variable>("a");
-    std::unique_ptr<Expr> b_sym = std::make_unique<Symbol>("b");
-    auto a_accessor = std::make_unique<AccessorExpr>(a_var, b_sym);
+    EXPECT_FALSE(*get == *store);
+    EXPECT_FALSE(*store == *get);
+}
 
-    // Finally create a.b = c.d = e[0] = 1
-    auto expected = std::make_unique<SetterExpr>(a_accessor->instance,
-                                                 a_accessor->accessor,
-                                                 c_setter);
+TEST_F(ParserTest, ParsesDeepPathIntoOneNode) {
+    std::string input = "a";
+    for (int i = 0; i < 1000; i++) {
+        input += i % 2 == 0 ? ".k" : "[0]";
+    }
+    auto expr = parse(input);
 
+    const auto *path = dynamic_cast<AccessPath *>(expr.get());
+    ASSERT_NE(path, nullptr);
+    ASSERT_EQ(path->steps.size(), 1000);
+    EXPECT_EQ(path->steps.front(), Identifier(Atom("k")));
+    EXPECT_EQ(path->steps.back(), Identifier(0));
+}
+
+TEST_F(ParserTest, ParsesCall) {
+    auto expr = parse("find(a, 3,)");
 
+    auto arguments = std::vector<std::unique_ptr<Expr> >();
+    arguments.push_back(std::make_unique<Variable>("a"));
+    arguments.push_back(std::make_unique<NumberLiteral>(3));
+    auto expected = std::make_unique<Call>(Atom("find"), std::move(arguments));
     EXPECT_TRUE(*expr == *expected);
+
+    const auto call = parse("len()");
+    const auto *empty = dynamic_cast<Call *>(call.get());
+    ASSERT_NE(empty, nullptr);
+    EXPECT_TRUE(empty->arguments.empty());
+    EXPECT_THROW(parse("sum(a"), ParserError);
+}
+
+TEST(ParserLookaheadTest, PeekIndexesAnyDistance) {
+    // parse() stops after `x`, leaving the cursor on `@`
+    auto lexer = std::make_unique<Lexer>("x @[1,]");
+    Parser parser(lexer);
+    parser.parse();
+
+    EXPECT_EQ(parser.peek(0).type, TokenType::AT);
+    EXPECT_EQ(&parser.peek(0), &parser.current());
+    EXPECT_EQ(parser.peek().type, TokenType::LEFT_SQUARE);
+    EXPECT_EQ(parser.peek(1).type, TokenType::LEFT_SQUARE);
+    EXPECT_EQ(parser.peek(2).type, TokenType::NUMBER);
+    EXPECT_EQ(std::get<int>(parser.peek(2).value), 1);
+    EXPECT_EQ(parser.peek(3).type, TokenType::COMMA);
+    EXPECT_EQ(parser.peek(4).type, TokenType::RIGHT_SQUARE);
+    // past the end, every lookahead is clamped to EOF_
+    EXPECT_EQ(parser.peek(5).type, TokenType::EOF_);
+    EXPECT_EQ(parser.peek(6).type, TokenType::EOF_);
+    EXPECT_EQ(parser.peek(100).type, TokenType::EOF_);
+}
+
+TEST(ParserProgramTest, SplitsStatementsOnNewlinesAndSemicolons) {
+    auto lexer = std::make_unique<Lexer>("$x = 1; x\n\nprint x;\n");
+    Parser parser(lexer);
+    const auto program = parser.parse_program();
+
+    EXPECT_TRUE(parser.diagnostics().empty());
+    ASSERT_EQ(program->statements.size(), 3);
+
+    std::unique_ptr<Variable> x = std::make_unique<Variable>("x");
+    std::unique_ptr<Expr> one = std::make_unique<NumberLiteral>(1);
+    EXPECT_TRUE(*program->statements[0] == Declaration(x, one));
+    EXPECT_TRUE(*program->statements[1] == Variable("x"));
+    EXPECT_TRUE(*program->statements[2] == PrintStatement(std::make_unique<Variable>("x")));
+}
+
+TEST(ParserProgramTest, RecoversAtStatementBoundaries) {
+    auto lexer = std::make_unique<Lexer>("$x = ; y\n"
+                                         "@[1, 2\n"
+                                         "a.b = 1 2; z\n"
+                                         "  # 3");
+    Parser parser(lexer);
+    const auto program = parser.parse_program();
+
+    ASSERT_EQ(program->statements.size(), 2);
+    EXPECT_TRUE(*program->statements[0] == Variable("y"));
+    EXPECT_TRUE(*program->statements[1] == Variable("z"));
+
+    const auto &diagnostics = parser.diagnostics();
+    ASSERT_EQ(diagnostics.size(), 4);
+
+    EXPECT_EQ(diagnostics[0].line, 1);
+    EXPECT_EQ(diagnostics[0].column, 6);
+    EXPECT_EQ(diagnostics[0].type, ParseErrorType::UNKNOWN_RHS);
+    EXPECT_EQ(diagnostics[0].message, "expected a value but found ';'");
+
+    EXPECT_EQ(diagnostics[1].line, 2);
+    EXPECT_EQ(diagnostics[1].column, 7);
+    EXPECT_EQ(diagnostics[1].type, ParseErrorType::UNEXPECTED_TOKEN);
+
+    EXPECT_EQ(diagnostics[2].line, 3);
+    EXPECT_EQ(diagnostics[2].column, 9);
+    EXPECT_EQ(diagnostics[2].message, "expected newline or ';' but found number");
+
+    EXPECT_EQ(diagnostics[3].line, 4);
+    EXPECT_EQ(diagnostics[3].column, 3);
+    EXPECT_EQ(diagnostics[3].type, ParseErrorType::INVALID_TOKEN);
+}
+
+TEST(ParserProgramTest, ManyBadLinesDoNotThrow) {
+    std::string script;
+    for (int i = 0; i < 100000; i++) {
+        script += i % 2 == 0 ? "$v = @{k = 1,}\n" : "$v = @{k = }\n";
+    }
+    auto lexer = std::make_unique<Lexer>(std::move(script));
+    AstArena arena;
+    Parser parser(lexer, arena);
+
+    std::size_t statements = 0;
+    EXPECT_NO_THROW(statements = parser.parse_program()->statements.size());
+    EXPECT_EQ(statements, 50000);
+    ASSERT_EQ(parser.diagnostics().size(), 50000);
+    EXPECT_EQ(parser.diagnostics().back().line, 100000);
+    EXPECT_EQ(parser.diagnostics().back().column, 12);
+}
+
+TEST(ParserProgramTest, ParseStillThrows) {
+    auto lexer = std::make_unique<Lexer>("$x = ");
+    Parser parser(lexer);
+    EXPECT_THROW(parser.parse(), ParserError);
 }
@@ -0,0 +1,66 @@
+#include <gtest/gtest.h>
+#include <cstdint>
+#include <set>
+#include <vector>
+#include <repl/heap.h>
+#include <repl/object.h>
+#include <repl/pool.h>
+
+TEST(SlabPoolTest, ReusesTheLastFreedBlock) {
+    SlabPool pool(48);
+    auto *first = pool.allocate();
+    auto *second = pool.allocate();
+    EXPECT_EQ(static_cast<std::byte *>(second) - static_cast<std::byte *>(first), 48);
+    EXPECT_EQ(pool.blocks_in_use(), 2);
+
+    pool.deallocate(first);
+    EXPECT_EQ(pool.allocate(), first);
+    pool.deallocate(first);
+    pool.deallocate(second);
+    EXPECT_EQ(pool.blocks_in_use(), 0);
+    EXPECT_EQ(pool.slab_count(), 1);
+}
+
+TEST(SlabPoolTest, GrowsBySlabs) {
+    SlabPool pool(80);
+    const auto per_slab = SlabPool::SLAB_SIZE / 80;
+    auto blocks = std::set<void *>();
+    for (std::size_t i = 0; i < per_slab + 1; i++) {
+        auto *block = pool.allocate();
+        EXPECT_EQ(reinterpret_cast<std::uintptr_t>(block) % 16, 0);
+        blocks.insert(block);
+    }
+    EXPECT_EQ(blocks.size(), per_slab + 1);
+    EXPECT_EQ(pool.slab_count(), 2);
+    EXPECT_EQ(pool.capacity(), 2 * per_slab);
+    for (auto *block: blocks) {
+        pool.deallocate(block);
+    }
+    EXPECT_EQ(pool.blocks_in_use(), 0);
+}
+
+TEST(SlabPoolTest, RejectsMisalignedSizes) {
+    EXPECT_THROW(SlabPool(0), std::invalid_argument);
+    EXPECT_THROW(SlabPool(40), std::invalid_argument);
+}
+
+TEST(SlabPoolTest, ObjectsComeFromTheirSizeClass) {
+    const auto &pools = Heap::local().slabPools();
+    const auto &arrays = pools[(sizeof(Array) - 1) / 16];
+    const auto &maps = pools[(sizeof(Map) - 1) / 16];
+    const auto arrays_before = arrays.blocks_in_use();
+    const auto maps_before = maps.blocks_in_use();
+
+    auto values = std::vector<Value>();
+    for (int i = 0; i < 100; i++) {
+        values.push_back(Value::make<Array>(std::vector<std::int32_t>{i}));
+        values.push_back(Value::make<Map>(Shape::empty(), std::vector<Value>()));
+    }
+    EXPECT_EQ(arrays.blocks_in_use(), arrays_before + 100);
+    EXPECT_EQ(maps.blocks_in_use(), maps_before + 100);
+    EXPECT_NE(Heap::local().describePools().find("100 of"), std::string::npos);
+
+    values.clear();
+    EXPECT_EQ(arrays.blocks_in_use(), arrays_before);
+    EXPECT_EQ(maps.blocks_in_use(), maps_before);
+}
@@ -0,0 +1,121 @@
+#include <gtest/gtest.h>
+#include <cstdint>
+#include <functional>
+#include <span>
+#include <vector>
+#include <repl/heap.h>
+#include <repl/pvector.h>
+
+namespace {
+    using Numbers = PVector<std::int32_t, 2, std::identity>;
+
+    // counts the items copied out of shared leaves
+    struct CountingCopy {
+        static inline int copies = 0;
+
+        std::int32_t operator()(const std::int32_t number) const {
+            copies++;
+            return number;
+        }
+    };
+
+    Numbers iota(const std::size_t size) {
+        return Numbers::generate(size, [](const std::size_t i) {
+            return static_cast<std::int32_t>(i);
+        });
+    }
+}
+
+TEST(PVectorTest, IndexesAcrossLevels) {
+    // leaves of 4 and branches of 32: three levels of branches
+    constexpr std::size_t size = 4 * 32 * 32 + 5;
+    const auto vector = iota(size);
+    EXPECT_EQ(vector.size(), size);
+    for (std::size_t i = 0; i < size; i++) {
+        ASSERT_EQ(vector[i], static_cast<std::int32_t>(i));
+    }
+    EXPECT_EQ(Numbers().size(), 0);
+}
+
+TEST(PVectorTest, CopiesShareUntilStoredInto) {
+    auto original = iota(1000);
+    auto copy = original;
+    EXPECT_TRUE(original.shared());
+    EXPECT_TRUE(copy.shared());
+
+    copy.unique(500) = -1;
+    EXPECT_EQ(copy[500], -1);
+    EXPECT_EQ(original[500], 500);
+    // the roots differ now, though most of the nodes below are still shared
+    EXPECT_FALSE(original.shared());
+    EXPECT_FALSE(copy.shared());
+
+    original.unique(0) = 7;
+    EXPECT_EQ(copy[0], 0);
+    EXPECT_EQ(original[0], 7);
+}
+
+TEST(PVectorTest, CopiesOnlyTheStoredPath) {
+    using Counted = PVector<std::int32_t, 2, CountingCopy>;
+    const auto original = Counted::generate(1000, [](const std::size_t i) {
+        return static_cast<std::int32_t>(i);
+    });
+    auto copy = original;
+    CountingCopy::copies = 0;
+    copy.unique(999) = 0;
+    // one leaf of 4 copied
+    EXPECT_EQ(CountingCopy::copies, 4);
+    copy.unique(998) = 0;
+    EXPECT_EQ(CountingCopy::copies, 4);
+}
+
+TEST(PVectorTest, UpdatesEveryLeaf) {
+    const auto original = iota(10);
+    auto copy = original;
+    auto leaves = 0;
+    copy.updateEachLeaf([&](const std::span<std::int32_t> numbers) {
+        for (auto &number: numbers) {
+            number *= 2;
+        }
+        leaves++;
+    });
+    EXPECT_EQ(leaves, 3);
+    EXPECT_EQ(copy[9], 18);
+    EXPECT_EQ(original[9], 9);
+
+    auto seen = std::vector<std::int32_t>();
+    original.forEachLeaf([&](const std::span<const std::int32_t> numbers) {
+        seen.insert(seen.end(), numbers.begin(), numbers.end());
+    });
+    EXPECT_EQ(seen, (std::vector<std::int32_t>{0, 1, 2, 3, 4, 5, 6, 7, 8, 9}));
+}
+
+TEST(PVectorTest, TracesSharedNodesOnce) {
+    const auto original = iota(100);
+    const auto copy = original;
+    auto children = std::vector<Object *>();
+    auto tracer = Tracer(children);
+    auto visited = 0;
+    original.trace(tracer, [&](std::int32_t) { visited++; });
+    copy.trace(tracer, [&](std::int32_t) { visited++; });
+    EXPECT_EQ(visited, 100);
+}
+
+TEST(PVectorTest, ReturnsNodesToThePools) {
+    const auto &pools = Heap::local().slabPools();
+    const auto in_use = [&] {
+        std::size_t blocks = 0;
+        for (const auto &pool: pools) {
+            blocks += pool.blocks_in_use();
+        }
+        return blocks;
+    };
+    const auto before = in_use();
+    {
+        auto vector = iota(5000);
+        auto copy = vector;
+        copy.unique(1234) = 0;
+        EXPECT_GT(in_use(), before);
+    }
+    EXPECT_EQ(in_use(), before);
+}
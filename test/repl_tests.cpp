@@ -0,0 +1,156 @@
+#include <gtest/gtest.h>
+#include <filesystem>
+#include <fstream>
+#include <string>
+#include <repl/mapped_file.h>
+#include <repl/parse_cache.h>
+#include <repl/repl.h>
+
+class ScriptFileTest : public ::testing::Test {
+protected:
+    std::filesystem::path path;
+
+    void SetUp() override {
+        const auto *info = ::testing::UnitTest::GetInstance()->current_test_info();
+        path = std::filesystem::temp_directory_path() / (std::string("repl_") + info->name() + ".repl");
+    }
+
+    void TearDown() override {
+        std::filesystem::remove(path);
+    }
+
+    void write(const std::string &script) const {
+        std::ofstream(path, std::ios::binary) << script;
+    }
+
+    [[nodiscard]] std::string run(const std::size_t cache_capacity = ParseCache::DEFAULT_CAPACITY,
+                                  const std::size_t jobs = 1) const {
+        ::testing::internal::CaptureStdout();
+        REPL::RunFile(path.string(), cache_capacity, jobs);
+        return ::testing::internal::GetCapturedStdout();
+    }
+};
+
+TEST_F(ScriptFileTest, MapsWholeFile) {
+    write("$x = 1\n");
+    const MappedFile file(path.string());
+    EXPECT_EQ(file.contents(), "$x = 1\n");
+}
+
+TEST_F(ScriptFileTest, MapsEmptyFile) {
+    write("");
+    const MappedFile file(path.string());
+    EXPECT_TRUE(file.contents().empty());
+}
+
+TEST_F(ScriptFileTest, ThrowsOnMissingFile) {
+    EXPECT_THROW(MappedFile("/nonexistent/script.repl"), std::system_error);
+}
+
+TEST_F(ScriptFileTest, RunsEachLineLikeThePrompt) {
+    write("$a = @[1, 2,]\n"
+          "a[1]\n"
+          "a[0] = 5\n"
+          "print a\n"
+          "a[9]\n"
+          "a[0]");
+
+    EXPECT_EQ(run(),
+              "Nil()\n"
+              "Number(2)\n"
+              "Number(5)\n"
+              "Array(Number(5), Number(2))\n"
+              "Nil()\n"
+              "ERROR\n"
+              "Number(5)\n");
+}
+
+TEST_F(ScriptFileTest, ReportsDiagnosticsAndKeepsGoing) {
+    write("$a = 1; $b = 2\n"
+          "$c = @[1\n"
+          "a; b");
+
+    EXPECT_EQ(run(),
+              "Nil()\n"
+              "Nil()\n"
+              "ERROR: 2:9: expected ',' but found end of input\n"
+              "Number(1)\n"
+              "Number(2)\n");
+}
+
+TEST_F(ScriptFileTest, ChecksWholeFileWithoutRunning) {
+    write("$a = 1\n"
+          "print ]\n"
+          "$b = @{x = 1,}\n"
+          "$ = 2\n");
+
+    ::testing::internal::CaptureStdout();
+    const auto count = REPL::CheckFile(path.string());
+    const auto output = ::testing::internal::GetCapturedStdout();
+
+    EXPECT_EQ(count, 2);
+    EXPECT_EQ(output,
+              path.string() + ":2:7: expected a value but found ']'\n" +
+              path.string() + ":4:3: expected identifier but found '='\n");
+}
+
+TEST_F(ScriptFileTest, CachedLinesBehaveLikeFreshOnes) {
+    const std::string script = "$a = @{n = 1,}\n"
+                               "a.n\n"
+                               "a.n = 2; a.n\n"
+                               "a.n = 2; a.n\n"
+                               "a.m\n"
+                               "a.m\n"
+                               "a.\n"
+                               "a.\n";
+    write(script);
+
+    const auto expected = "Nil()\n"
+                          "Number(1)\n"
+                          "Number(2)\nNumber(2)\n"
+                          "Number(2)\nNumber(2)\n"
+                          "ERROR\n"
+                          "ERROR\n"
+                          "ERROR: 7:3: expected identifier but found end of input\n"
+                          "ERROR: 8:3: expected identifier but found end of input\n";
+    EXPECT_EQ(run(), expected);
+    EXPECT_EQ(run(0), expected);
+}
+
+TEST_F(ScriptFileTest, PipelinedRunsMatchSerialOnes) {
+    // more lines than the pipeline holds, repeats that hit and miss a small
+    // cache, and errors of both kinds in between
+    std::string script = "$a = @[0, @{k = 1,},]\n";
+    for (int i = 0; i < 1000; i++) {
+        script += "a[0] = " + std::to_string(i % 7) + "; a[0]\n";
+        script += i % 10 == 0 ? "a[1].k = @[" + std::to_string(i) + "\n" : "a[1].k\n";
+        script += i % 13 == 0 ? "a[5]\n" : "$v" + std::to_string(i) + " = @{x = " + std::to_string(i) + ",}\n";
+    }
+    script += "a";
+    write(script);
+
+    for (const std::size_t capacity: {std::size_t{0}, std::size_t{4}, ParseCache::DEFAULT_CAPACITY}) {
+        const auto serial = run(capacity, 0);
+        EXPECT_EQ(run(capacity, 1), serial) << capacity;
+        EXPECT_NE(serial.find("ERROR: 3:13: expected ',' but found end of input\n"), std::string::npos);
+    }
+}
+
+TEST_F(ScriptFileTest, ParallelRunsMatchSerialOnes) {
+    // enough to cut into many chunks, most of them not ending where a line
+    // does; one line has no newline, and one is empty
+    std::string script = "$a = @[0, @{k = 1,},]\n\n";
+    for (int i = 0; i < 20000; i++) {
+        script += "a[0] = " + std::to_string(i % 7) + "; a[0]\n";
+        script += i % 10 == 0 ? "a[1].k = @[" + std::to_string(i) + "\n" : "a[1].k\n";
+        script += i % 13 == 0 ? "a[5]\n" : "$v" + std::to_string(i) + " = @{x = " + std::to_string(i) + ",}\n";
+    }
+    script += "a";
+    write(script);
+
+    const auto serial = run(4, 0);
+    for (const std::size_t jobs: {2, 3, 8}) {
+        EXPECT_EQ(run(4, jobs), serial) << jobs;
+    }
+    EXPECT_EQ(run(ParseCache::DEFAULT_CAPACITY, 4), run(ParseCache::DEFAULT_CAPACITY, 0));
+}
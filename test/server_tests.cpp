@@ -0,0 +1,206 @@
+#ifdef __linux__
+#include <gtest/gtest.h>
+#include <atomic>
+#include <filesystem>
+#include <fstream>
+#include <memory>
+#include <string>
+#include <thread>
+#include <vector>
+#include <sys/socket.h>
+#include <sys/un.h>
+#include <unistd.h>
+#include <repl/server.h>
+
+class ServerTest : public ::testing::Test {
+protected:
+    std::string path;
+    std::unique_ptr<Server> server;
+    std::thread loop;
+
+    void SetUp() override {
+        const auto *info = ::testing::UnitTest::GetInstance()->current_test_info();
+        path = (std::filesystem::temp_directory_path() /
+                (std::string("repl_") + info->name() + "_" + std::to_string(getpid()) + ".sock")).string();
+    }
+
+    void TearDown() override {
+        stop();
+    }
+
+    void start(const std::size_t workers = 4, const std::string &preload = {}) {
+        server = std::make_unique<Server>(path, workers, 64, preload);
+        loop = std::thread([this] { server->run(); });
+    }
+
+    void stop() {
+        if (server) {
+            server->stop();
+            loop.join();
+            server.reset();
+        }
+    }
+
+    // a bare socket at `path`, for what Client will not send
+    [[nodiscard]] int socketAt(const bool connected) const {
+        sockaddr_un address{};
+        address.sun_family = AF_UNIX;
+        path.copy(address.sun_path, sizeof(address.sun_path) - 1);
+        const auto fd = socket(AF_UNIX, SOCK_STREAM, 0);
+        const auto *name = reinterpret_cast<const sockaddr *>(&address);
+        EXPECT_EQ(connected ? connect(fd, name, sizeof(address)) : bind(fd, name, sizeof(address)), 0);
+        return fd;
+    }
+};
+
+TEST_F(ServerTest, AnswersLikeThePrompt) {
+    start();
+    const Client client(path);
+    EXPECT_EQ(client.request("$a = @[1, 2, @{k = 3,},]"), "Nil()");
+    EXPECT_EQ(client.request("a[1]"), "Number(2)");
+    EXPECT_EQ(client.request("a[2].k"), "Number(3)");
+    EXPECT_EQ(client.request("a[2].k = 4"), "Number(4)");
+    EXPECT_EQ(client.request("a[2]"), "Map(k = Number(4))");
+    EXPECT_EQ(client.request("len(a)"), "Number(3)");
+    EXPECT_EQ(client.request("a; a[0]"), "Array(Number(1), Number(2), Map(k = Number(4)))\nNumber(1)");
+    EXPECT_EQ(client.request("a[9]"), "ERROR");
+    EXPECT_EQ(client.request("nope"), "ERROR");
+    EXPECT_EQ(client.request("$c = @[1"), "ERROR: 1:9: expected ',' but found end of input");
+    EXPECT_EQ(client.request(""), "");
+}
+
+TEST_F(ServerTest, AnswersWithWhatPrintPrints) {
+    start();
+    const Client client(path);
+    EXPECT_EQ(client.request("$x = @[1, 2,]"), "Nil()");
+    EXPECT_EQ(client.request("print x"), "Array(Number(1), Number(2))\nNil()");
+    EXPECT_EQ(client.request("print x[0]; x[1]; print nope"), "Number(1)\nNil()\nNumber(2)\nERROR");
+    // and nothing of it is left for the next request
+    EXPECT_EQ(client.request("x[1] = 3"), "Number(3)");
+}
+
+TEST_F(ServerTest, PipelinedRequestsAreAnsweredInOrder) {
+    start();
+    const Client client(path);
+    client.send("$n = 0");
+    for (int i = 1; i <= 50; i++) {
+        client.send("n = " + std::to_string(i));
+        client.send("n");
+    }
+    EXPECT_EQ(client.receive(), "Nil()");
+    for (int i = 1; i <= 50; i++) {
+        // the read is answered from the version the write before it committed
+        EXPECT_EQ(client.receive(), "Number(" + std::to_string(i) + ")");
+        EXPECT_EQ(client.receive(), "Number(" + std::to_string(i) + ")");
+    }
+}
+
+TEST_F(ServerTest, ClientsShareOnePreloadedDataset) {
+    const auto script = path + ".repl";
+    std::ofstream(script) << "$cfg = @{limits = @[10, 20,],}\n";
+    ::testing::internal::CaptureStdout();
+    start(2, script);
+    ::testing::internal::GetCapturedStdout();
+    std::filesystem::remove(script);
+
+    const Client writer(path);
+    const Client reader(path);
+    EXPECT_EQ(reader.request("cfg.limits[1]"), "Number(20)");
+    EXPECT_EQ(writer.request("cfg.limits[1] = 30"), "Number(30)");
+    EXPECT_EQ(reader.request("cfg.limits[1]"), "Number(30)");
+}
+
+TEST_F(ServerTest, FailsToStartWithoutItsPreload) {
+    EXPECT_THROW(start(2, path + ".missing"), std::system_error);
+    EXPECT_FALSE(std::filesystem::exists(path));
+}
+
+TEST_F(ServerTest, ManyClientsReadWhileOneWrites) {
+    start();
+    EXPECT_EQ(Client(path).request("$pair = @{left = @[0,], right = @[0,],}"), "Nil()");
+
+    std::atomic<bool> done{false};
+    std::atomic<int> torn{0};
+    std::atomic<int> reads{0};
+    auto readers = std::vector<std::thread>();
+    for (int i = 0; i < 8; i++) {
+        readers.emplace_back([&] {
+            const Client client(path);
+            while (!done.load()) {
+                // both halves in one read, so from a single version
+                const auto pair = client.request("pair");
+                const auto n = std::to_string(std::stoi(pair.substr(pair.find("Number(") + 7)));
+                if (pair != "Map(left = Array(Number(" + n + ")), right = Array(Number(" + n + ")))") {
+                    ++torn;
+                }
+                ++reads;
+            }
+        });
+    }
+    const Client writer(path);
+    for (int i = 1; i <= 200; i++) {
+        const auto n = std::to_string(i);
+        EXPECT_EQ(writer.request("pair.left[0] = " + n + "; pair.right[0] = " + n),
+                  "Number(" + n + ")\nNumber(" + n + ")");
+    }
+    done = true;
+    for (auto &reader: readers) {
+        reader.join();
+    }
+    EXPECT_EQ(torn.load(), 0);
+    EXPECT_GT(reads.load(), 0);
+    EXPECT_EQ(writer.request("pair.right[0]"), "Number(200)");
+}
+
+TEST_F(ServerTest, HangsUpOnAnOversizedFrame) {
+    start();
+    const auto fd = socketAt(true);
+    // announces one byte more than MAX_FRAME
+    const auto length = Server::MAX_FRAME + 1;
+    const char header[] = {
+        static_cast<char>(length & 0xff), static_cast<char>(length >> 8 & 0xff),
+        static_cast<char>(length >> 16 & 0xff), static_cast<char>(length >> 24 & 0xff)
+    };
+    ASSERT_EQ(write(fd, header, sizeof(header)), 4);
+    char byte;
+    EXPECT_EQ(read(fd, &byte, 1), 0);
+    close(fd);
+
+    EXPECT_EQ(Client(path).request("1"), "Number(1)");
+}
+
+TEST_F(ServerTest, AnswersAfterTheClientShutsDownItsSide) {
+    start();
+    const auto fd = socketAt(true);
+    const char request[] = "\x01\x00\x00\x00" "7";
+    ASSERT_EQ(write(fd, request, 5), 5);
+    shutdown(fd, SHUT_WR);
+    char response[16];
+    EXPECT_EQ(read(fd, response, sizeof(response)), 13);
+    EXPECT_EQ(std::string(response + 4, 9), "Number(7)");
+    EXPECT_EQ(read(fd, response, sizeof(response)), 0);
+    close(fd);
+}
+
+TEST_F(ServerTest, OthersAreServedAfterAClientVanishes) {
+    start();
+    for (int i = 0; i < 10; i++) {
+        const Client client(path);
+        client.send("$v" + std::to_string(i) + " = @[1, 2, 3,]");
+    }
+    EXPECT_EQ(Client(path).request("1"), "Number(1)");
+}
+
+TEST_F(ServerTest, ReplacesAStaleSocketButNotAFile) {
+    close(socketAt(false));
+    start(1);
+    EXPECT_EQ(Client(path).request("2"), "Number(2)");
+    stop();
+    EXPECT_FALSE(std::filesystem::exists(path));
+
+    std::ofstream(path) << "not a socket";
+    EXPECT_THROW(start(1), std::system_error);
+    EXPECT_TRUE(std::filesystem::exists(path));
+    std::filesystem::remove(path);
+}
+#endif
@@ -0,0 +1,158 @@
+#include <gtest/gtest.h>
+#include <memory>
+#include <string>
+#include <vector>
+#include <fmt/format.h>
+#include <repl/interpreter.h>
+#include <repl/lexer.h>
+#include <repl/object.h>
+#include <repl/parser.h>
+#include <repl/shape.h>
+
+TEST(ShapeTest, TransitionsAreShared) {
+    const auto *empty = Shape::empty();
+    EXPECT_EQ(empty->size(), 0);
+
+    const auto *x = empty->with("shape_x");
+    const auto *xy = x->with("shape_y");
+    EXPECT_EQ(empty->with("shape_x"), x);
+    EXPECT_EQ(x->with("shape_y"), xy);
+    EXPECT_EQ(xy->parentShape(), x);
+    EXPECT_EQ(xy->with("shape_x"), xy);
+
+    const std::vector<Atom> keys = {"shape_x", "shape_y"};
+    EXPECT_EQ(Shape::of(keys), xy);
+}
+
+TEST(ShapeTest, OffsetsFollowInsertionOrder) {
+    const std::vector<Atom> keys = {"shape_b", "shape_a", "shape_b", "shape_c"};
+    const auto *shape = Shape::of(keys);
+    EXPECT_EQ(shape->size(), 3);
+    EXPECT_EQ(shape->offset("shape_b"), 0);
+    EXPECT_EQ(shape->offset("shape_a"), 1);
+    EXPECT_EQ(shape->offset("shape_c"), 2);
+    EXPECT_EQ(shape->offset("shape_d"), std::nullopt);
+}
+
+TEST(ShapeTest, KeyOrderMakesADifferentShape) {
+    const std::vector<Atom> forward = {"shape_p", "shape_q"};
+    const std::vector<Atom> backward = {"shape_q", "shape_p"};
+    EXPECT_NE(Shape::of(forward), Shape::of(backward));
+}
+
+static Value evaluate(Interpreter &interpreter, const std::string &text) {
+    auto lexer = std::make_unique<Lexer>(text);
+    return interpreter.execute(Parser(lexer).parse_flat());
+}
+
+TEST(ShapeTest, MapsFromOneLiteralShareAShape) {
+    Interpreter interpreter;
+    const auto first = evaluate(interpreter, "@{name = 1, age = 2,}");
+    const auto second = evaluate(interpreter, "@{name = 3, age = 4,}");
+    const auto other = evaluate(interpreter, "@{age = 3, name = 4,}");
+
+    const auto *left = first.as<Map>();
+    const auto *right = second.as<Map>();
+    ASSERT_NE(left, nullptr);
+    ASSERT_NE(right, nullptr);
+    EXPECT_EQ(left->shape, right->shape);
+    EXPECT_NE(left->shape, other.as<Map>()->shape);
+    EXPECT_EQ(right->size(), 2);
+}
+
+TEST(ShapeTest, RepeatedKeyKeepsFirstValue) {
+    Interpreter interpreter;
+    const auto result = evaluate(interpreter, "@{k = 1, j = 2, k = 3,}");
+    EXPECT_EQ(result.toString(), "Map(j = Number(2), k = Number(1))");
+}
+
+static std::vector<Atom> numberedKeys(const std::string &prefix, const std::size_t count) {
+    auto keys = std::vector<Atom>();
+    for (std::size_t i = 0; i < count; i++) {
+        keys.emplace_back(prefix + std::to_string(i));
+    }
+    return keys;
+}
+
+TEST(ShapeTest, LongChainsFindEveryOffset) {
+    const auto keys = numberedKeys("shape_long_", Shape::MAX_SHARED_KEYS);
+    const auto *shape = Shape::shared(keys);
+    ASSERT_NE(shape, nullptr);
+    EXPECT_FALSE(shape->dictionary());
+    EXPECT_EQ(shape->size(), Shape::MAX_SHARED_KEYS);
+    // each prefix, whether it walks its chain or builds a table
+    for (auto *prefix = shape; prefix != Shape::empty(); prefix = prefix->parentShape()) {
+        const auto last = prefix->size() - 1;
+        EXPECT_EQ(prefix->offset(keys[last]), last);
+        EXPECT_EQ(prefix->offset(keys[0]), 0);
+        if (prefix->size() < keys.size()) {
+            EXPECT_EQ(prefix->offset(keys[prefix->size()]), std::nullopt);
+        }
+    }
+    EXPECT_EQ(shape->keyList(), keys);
+    EXPECT_EQ(shape->parentShape()->keyList(), std::vector<Atom>(keys.begin(), keys.end() - 1));
+}
+
+TEST(ShapeTest, ManyKeysMakeADictionary) {
+    auto keys = numberedKeys("shape_many_", Shape::MAX_SHARED_KEYS + 1);
+    keys.insert(keys.begin() + 3, keys[1]);
+    EXPECT_EQ(Shape::shared(keys), nullptr);
+
+    const auto *shape = Shape::of(keys);
+    shape->retain();
+    EXPECT_TRUE(shape->dictionary());
+    EXPECT_EQ(shape->size(), Shape::MAX_SHARED_KEYS + 1);
+    EXPECT_EQ(shape->offset(keys[1]), 1);
+    EXPECT_EQ(shape->offset(keys[4]), 3);
+    EXPECT_EQ(shape->offset("shape_many_none"), std::nullopt);
+    // not shared: each is its map's own
+    const auto *other = Shape::of(keys);
+    other->retain();
+    EXPECT_NE(other, shape);
+
+    const auto *wider = shape->with("shape_many_more");
+    wider->retain();
+    EXPECT_TRUE(wider->dictionary());
+    EXPECT_EQ(wider->offset("shape_many_more"), Shape::MAX_SHARED_KEYS + 1);
+    EXPECT_EQ(shape->with(keys[0]), shape);
+    wider->release();
+    other->release();
+    shape->release();
+
+    // the tree goes up to the limit and no further
+    const auto *full = Shape::shared(numberedKeys("shape_many_", Shape::MAX_SHARED_KEYS));
+    EXPECT_FALSE(full->dictionary());
+    const auto *past = full->with("shape_many_last");
+    past->retain();
+    EXPECT_TRUE(past->dictionary());
+    past->release();
+}
+
+TEST(ShapeTest, MapsWithManyKeysWorkLikeOthers) {
+    Interpreter interpreter;
+    std::string literal = "@{";
+    for (std::size_t i = 0; i < Shape::MAX_SHARED_KEYS + 10; i++) {
+        literal += fmt::format("shapebig{} = {}, ", i, i);
+    }
+    literal += "shapebig0 = 99,}";
+    evaluate(interpreter, "$big = " + literal);
+    evaluate(interpreter, "$twin = " + literal);
+    const auto big = interpreter.global_scope().global_get("big");
+    const auto twin = interpreter.global_scope().global_get("twin");
+    EXPECT_TRUE(big.as<Map>()->shape->dictionary());
+    EXPECT_NE(big.as<Map>()->shape, twin.as<Map>()->shape);
+
+    EXPECT_EQ(evaluate(interpreter, "big.shapebig0").toString(), "Number(0)");
+    EXPECT_EQ(evaluate(interpreter, "big.shapebig130 = 7").toString(), "Number(7)");
+    EXPECT_EQ(evaluate(interpreter, "big.shapebig130").toString(), "Number(7)");
+    EXPECT_EQ(evaluate(interpreter, "twin.shapebig130").toString(), "Number(130)");
+    evaluate(interpreter, "$copy = clone(big)");
+    EXPECT_EQ(evaluate(interpreter, "copy.shapebig137").toString(), "Number(137)");
+    EXPECT_THROW(evaluate(interpreter, "big.shapebignope"), std::out_of_range);
+
+    // and through the tree walker
+    auto lexer = std::make_unique<Lexer>(literal);
+    const auto walked = interpreter.visit(*Parser(lexer).parse());
+    EXPECT_TRUE(walked.as<Map>()->shape->dictionary());
+    EXPECT_EQ(walked.toString(), twin.toString());
+}
@@ -0,0 +1,45 @@
+#include <gtest/gtest.h>
+#include <memory>
+#include <string>
+#include <thread>
+#include <repl/spsc_ring.h>
+
+TEST(SpscRingTest, PopsInPushOrder) {
+    SpscRing<std::string, 4> ring;
+    std::string item;
+    EXPECT_FALSE(ring.try_pop(item));
+    for (int round = 0; round < 3; round++) {
+        for (int i = 0; i < 4; i++) {
+            auto pushed = std::to_string(round * 4 + i);
+            EXPECT_TRUE(ring.try_push(pushed));
+        }
+        auto extra = std::string("full");
+        EXPECT_FALSE(ring.try_push(extra));
+        EXPECT_EQ(extra, "full");
+        for (int i = 0; i < 4; i++) {
+            EXPECT_EQ(ring.pop(), std::to_string(round * 4 + i));
+        }
+        EXPECT_FALSE(ring.try_pop(item));
+    }
+}
+
+TEST(SpscRingTest, MovesItemsAcrossThreads) {
+    // small enough that both sides keep waiting for each other
+    const auto ring = std::make_unique<SpscRing<std::unique_ptr<int>, 8> >();
+    constexpr int COUNT = 200000;
+    std::thread producer([&] {
+        for (int i = 1; i <= COUNT; i++) {
+            ring->push(std::make_unique<int>(i));
+        }
+    });
+    long long sum = 0;
+    bool ordered = true;
+    for (int i = 1; i <= COUNT; i++) {
+        const auto item = ring->pop();
+        ordered = ordered && *item == i;
+        sum += *item;
+    }
+    producer.join();
+    EXPECT_TRUE(ordered);
+    EXPECT_EQ(sum, static_cast<long long>(COUNT) * (COUNT + 1) / 2);
+}
@@ -0,0 +1,217 @@
+#include <gtest/gtest.h>
+#include <atomic>
+#include <memory>
+#include <string>
+#include <thread>
+#include <vector>
+#include <repl/bytecode.h>
+#include <repl/heap.h>
+#include <repl/interpreter.h>
+#include <repl/lexer.h>
+#include <repl/object.h>
+#include <repl/parser.h>
+#include <repl/versions.h>
+#include "vm_fixture.h"
+
+class VersionsTest : public VmTest {
+};
+
+TEST_F(VersionsTest, NothingIsVisibleBeforeTheFirstCommit) {
+    run("$a = 1");
+    const auto snapshot = interpreter.versions().pin();
+    EXPECT_EQ(snapshot.epoch(), 0);
+    EXPECT_EQ(snapshot.get(Atom("a")), nullptr);
+    EXPECT_THROW(static_cast<void>(snapshot.read("a")), InterpreterError);
+}
+
+TEST_F(VersionsTest, SnapshotsKeepTheirVersion) {
+    run("$cfg = @{limits = @{max = 10, min = 1,}, names = @[1, 2, 3,], tags = @[nil, @[4,],],}");
+    EXPECT_EQ(interpreter.commit(), 1);
+    const auto first = interpreter.versions().pin();
+
+    // stores at every depth, and through a second name for the same object
+    run("cfg.limits.max = 20");
+    run("cfg.names[0] = 7");
+    run("$inner = cfg.tags[1]");
+    run("inner[0] = 5");
+    run("$b = 2");
+    EXPECT_EQ(first.read("cfg.limits.max"), "Number(10)");
+    EXPECT_EQ(first.read("cfg.names"), "Array(Number(1), Number(2), Number(3))");
+    EXPECT_EQ(first.read("cfg.tags[1][0]"), "Number(4)");
+    EXPECT_EQ(first.get(Atom("b")), nullptr);
+
+    EXPECT_EQ(interpreter.commit(), 2);
+    const auto second = interpreter.versions().pin();
+    EXPECT_EQ(second.epoch(), 2);
+    EXPECT_EQ(second.read("cfg.limits.max"), "Number(20)");
+    EXPECT_EQ(second.read("cfg.names[0]"), "Number(7)");
+    EXPECT_EQ(second.read("inner"), "Array(Number(5))");
+    EXPECT_EQ(second.read("b"), "Number(2)");
+    EXPECT_EQ(first.read("cfg.tags[1]"), "Array(Number(4))");
+
+    EXPECT_THROW(static_cast<void>(second.read("cfg.nope")), std::out_of_range);
+    EXPECT_THROW(static_cast<void>(second.read("cfg.names[3]")), std::out_of_range);
+    EXPECT_THROW(static_cast<void>(second.read("cfg.names = 1")), std::invalid_argument);
+}
+
+TEST_F(VersionsTest, FrozenCopiesKeepSharingAndCycles) {
+    run("$a = @[nil, @{k = 1,},]");
+    run("a[0] = a");
+    run("$m = a[1]");
+    interpreter.commit();
+    const auto snapshot = interpreter.versions().pin();
+    EXPECT_EQ(snapshot.read("a"), "Array(Array(...), Map(k = Number(1)))");
+
+    const auto *array = snapshot.get(Atom("a"))->as<Array>();
+    EXPECT_EQ(array->element(0).object(), array);
+    EXPECT_EQ(array->element(1).object(), snapshot.get(Atom("m"))->object());
+    // a frozen copy, not the writer's
+    EXPECT_NE(array, interpreter.global_scope().global_get("a").object());
+}
+
+TEST_F(VersionsTest, ReclaimsVersionsNoReaderCanReach) {
+    run("$a = @[1, 2,]");
+    interpreter.commit();
+    {
+        const auto pinned = interpreter.versions().pin();
+        interpreter.commit();
+        interpreter.commit();
+        // the pinned one, and those published after it
+        EXPECT_EQ(interpreter.versions().retained(), 3);
+        EXPECT_EQ(pinned.read("a[1]"), "Number(2)");
+    }
+    interpreter.commit();
+    EXPECT_EQ(interpreter.versions().retained(), 1);
+}
+
+TEST_F(VersionsTest, ReadersNeverSeeAHalfCommittedBatch) {
+    // the writer keeps both halves equal, and commits only between batches
+    run("$pair = @{left = @[0,], right = @[0,],}");
+    interpreter.commit();
+
+    std::atomic<bool> done{false};
+    std::atomic<int> torn{0};
+    std::atomic<int> reads{0};
+    auto readers = std::vector<std::thread>();
+    for (int i = 0; i < 4; i++) {
+        readers.emplace_back([&] {
+            std::uint64_t last_epoch = 0;
+            while (!done.load()) {
+                const auto snapshot = interpreter.versions().pin();
+                if (snapshot.epoch() < last_epoch || snapshot.read("pair.left") != snapshot.read("pair.right")) {
+                    ++torn;
+                }
+                last_epoch = snapshot.epoch();
+                ++reads;
+            }
+        });
+    }
+    for (int i = 1; i <= 300; i++) {
+        run("pair.left[0] = " + std::to_string(i));
+        run("pair.right[0] = " + std::to_string(i));
+        interpreter.commit();
+        std::this_thread::yield();
+    }
+    done = true;
+    for (auto &reader: readers) {
+        reader.join();
+    }
+    EXPECT_EQ(torn.load(), 0);
+    EXPECT_GT(reads.load(), 0);
+    EXPECT_EQ(interpreter.versions().pin().read("pair.left[0]"), "Number(300)");
+}
+
+// the frozen object at `key` of the frozen map `map`
+static const Object *at(const Value &map, const char *key) {
+    const auto *frozen = map.as<Map>();
+    return frozen->value(*frozen->shape->offset(Atom(key))).object();
+}
+
+TEST_F(VersionsTest, CommitsCopyOnlyWhatWasStoredInto) {
+    run("$cfg = @{limits = @{max = 10,}, names = @[1, 2,],}");
+    run("$rows = @[@{k = 1,}, @{k = 2,},]");
+    interpreter.commit();
+    const auto first = interpreter.versions().pin();
+
+    // an unrelated global leaves every frozen copy as it was
+    run("$z = 2");
+    interpreter.commit();
+    const auto second = interpreter.versions().pin();
+    EXPECT_EQ(second.get(Atom("cfg"))->object(), first.get(Atom("cfg"))->object());
+    EXPECT_EQ(second.get(Atom("rows"))->object(), first.get(Atom("rows"))->object());
+    EXPECT_EQ(second.read("z"), "Number(2)");
+
+    // a nested store copies the object and those holding it, nothing beside
+    run("cfg.limits.max = 20");
+    interpreter.commit();
+    const auto third = interpreter.versions().pin();
+    const auto &cfg = *third.get(Atom("cfg"));
+    EXPECT_NE(cfg.object(), second.get(Atom("cfg"))->object());
+    EXPECT_NE(at(cfg, "limits"), at(*second.get(Atom("cfg")), "limits"));
+    EXPECT_EQ(at(cfg, "names"), at(*second.get(Atom("cfg")), "names"));
+    EXPECT_EQ(third.get(Atom("rows"))->object(), first.get(Atom("rows"))->object());
+    EXPECT_EQ(third.read("cfg.limits.max"), "Number(20)");
+    EXPECT_EQ(first.read("cfg.limits.max"), "Number(10)");
+
+    // of an array, only the element stored into
+    run("rows[1].k = 3");
+    interpreter.commit();
+    const auto fourth = interpreter.versions().pin();
+    const auto *rows = fourth.get(Atom("rows"))->as<Array>();
+    const auto *before = third.get(Atom("rows"))->as<Array>();
+    EXPECT_NE(rows, before);
+    EXPECT_EQ(rows->element(0).object(), before->element(0).object());
+    EXPECT_NE(rows->element(1).object(), before->element(1).object());
+    EXPECT_EQ(fourth.read("rows"), "Array(Map(k = Number(1)), Map(k = Number(3)))");
+    EXPECT_EQ(third.read("rows[1].k"), "Number(2)");
+}
+
+TEST_F(VersionsTest, StoresThroughAnyHolderReachTheNextCommit) {
+    run("$a = @[@[1,], 0,]");
+    run("$b = @[nil,]");
+    run("$c = @[0, nil,]");
+    run("c[1] = c");
+    interpreter.commit();
+
+    // held from two arrays once committed, and stored into by a third name
+    run("b[0] = a[0]");
+    interpreter.commit();
+    run("$inner = a[0]");
+    run("inner[0] = 2");
+    run("a[1] = 5");
+    run("c[0] = 1");
+    run("fill(b, @[3,])");
+    interpreter.commit();
+    const auto snapshot = interpreter.versions().pin();
+    EXPECT_EQ(snapshot.read("a"), "Array(Array(Number(2)), Number(5))");
+    EXPECT_EQ(snapshot.read("inner"), "Array(Number(2))");
+    EXPECT_EQ(snapshot.get(Atom("inner"))->object(), snapshot.get(Atom("a"))->as<Array>()->element(0).object());
+    EXPECT_EQ(snapshot.read("b"), "Array(Array(Number(3)))");
+    EXPECT_EQ(snapshot.read("c[1][1][0]"), "Number(1)");
+    const auto *c = snapshot.get(Atom("c"))->as<Array>();
+    EXPECT_EQ(c->element(1).object(), c);
+
+    // what fill() left behind no longer holds the old element
+    run("inner[0] = 4");
+    interpreter.commit();
+    EXPECT_EQ(interpreter.versions().pin().read("b"), "Array(Array(Number(3)))");
+    EXPECT_EQ(interpreter.versions().pin().read("a[0][0]"), "Number(4)");
+}
+
+TEST_F(VersionsTest, CommittedObjectsMayBeCollected) {
+    run("$d = @[nil, @[1,],]");
+    run("d[0] = d");
+    run("$e = d[1]");
+    interpreter.commit();
+    const auto pinned = interpreter.versions().pin();
+
+    // collecting the cycle d was forgets what was committed of it
+    run("d = 1");
+    EXPECT_GT(Heap::local().collect(), 0);
+    run("e[0] = 2");
+    interpreter.commit();
+    const auto snapshot = interpreter.versions().pin();
+    EXPECT_EQ(snapshot.read("d"), "Number(1)");
+    EXPECT_EQ(snapshot.read("e"), "Array(Number(2))");
+    EXPECT_EQ(pinned.read("d[0][1][0]"), "Number(1)");
+}
@@ -0,0 +1,28 @@
+#ifndef VM_FIXTURE_H
+#define VM_FIXTURE_H
+#include <gtest/gtest.h>
+#include <memory>
+#include <string>
+#include <repl/bytecode.h>
+#include <repl/interpreter.h>
+#include <repl/lexer.h>
+#include <repl/object.h>
+#include <repl/parser.h>
+
+// An interpreter, and lines compiled and run on its VM as the prompt would.
+class VmTest : public ::testing::Test {
+protected:
+    Interpreter interpreter;
+
+    Chunk compile(const std::string &input) {
+        auto lexer = std::make_unique<Lexer>(input);
+        const auto ast = Parser(lexer).parse_flat();
+        return Compiler::compile(ast, ast.root(), this->interpreter.global_scope());
+    }
+
+    std::string run(const std::string &input) {
+        return this->interpreter.run(this->compile(input)).toString();
+    }
+};
+
+#endif //VM_FIXTURE_H
@@ -0,0 +1,47 @@
+#include <gtest/gtest.h>
+#include <atomic>
+#include <thread>
+#include <repl/work_pool.h>
+
+TEST(WorkStealingPoolTest, RunsEveryTaskBeforeItIsDestroyed) {
+    std::atomic<int> sum{0};
+    {
+        WorkStealingPool pool(4);
+        EXPECT_EQ(pool.size(), 4);
+        for (int i = 1; i <= 1000; i++) {
+            pool.submit([&sum, i] { sum += i; });
+        }
+    }
+    EXPECT_EQ(sum.load(), 500500);
+}
+
+TEST(WorkStealingPoolTest, IdleThreadsStealWhatABusyOneQueued) {
+    std::atomic<int> done{0};
+    WorkStealingPool pool(3);
+    pool.submit([&] {
+        // queued on this thread, which does not get to them until all have run
+        for (int i = 0; i < 64; i++) {
+            pool.submit([&done] { ++done; });
+        }
+        while (done.load() < 64) {
+            std::this_thread::yield();
+        }
+    });
+    while (done.load() < 64) {
+        std::this_thread::yield();
+    }
+    EXPECT_GE(pool.steals(), 64);
+}
+
+TEST(WorkStealingPoolTest, SleepsUntilThereIsWork) {
+    WorkStealingPool pool(2);
+    std::atomic<int> runs{0};
+    for (int round = 1; round <= 50; round++) {
+        pool.submit([&runs] { ++runs; });
+        // let every thread run out of work and go to sleep
+        while (runs.load() < round) {
+            std::this_thread::yield();
+        }
+    }
+    EXPECT_EQ(runs.load(), 50);
+}